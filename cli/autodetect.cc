@@ -85,6 +85,11 @@ autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &
 
   logDebug() << "Using device " << device.deviceHandle() << ".";
 
+  return detectRadio(device, parser, err);
+}
+
+Radio *
+detectRadio(const USBDeviceDescriptor &device, QCommandLineParser &parser, const ErrorStack &err) {
   // Handle identifiability of radio
   if (parser.isSet("radio")) {
     RadioInfo radio = RadioInfo::byKey(parser.value("radio").toLower());
@@ -119,3 +124,64 @@ autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &
   }
   return rad;
 }
+
+QList<Radio *>
+autoDetectAll(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &err) {
+  Q_UNUSED(app)
+
+  QList<Radio *> radios;
+  QList<USBDeviceDescriptor> interfaces = USBDeviceDescriptor::detect();
+  if (interfaces.isEmpty()) {
+    errMsg(err) << "No matching USB devices are found. Check connection?";
+    return radios;
+  }
+
+  // Select devices, either all or those passed by the --device options
+  QList<USBDeviceDescriptor> devices;
+  if (parser.isSet("all")) {
+    foreach (USBDeviceDescriptor dev, interfaces) {
+      if ((! dev.isSave()) && (! parser.isSet("radio"))) {
+        logWarn() << "Skip device " << dev.deviceHandle() << " (" << dev.description()
+                  << "): It is not save to assume, that it is a DMR radio. Specify it explicitly.";
+        continue;
+      }
+      devices.append(dev);
+    }
+  } else {
+    foreach (QString handle, parser.values("device").join(",").split(",", QString::SkipEmptyParts)) {
+      QVariant devHandle = parseDeviceHandle(handle);
+      USBDeviceDescriptor device;
+      foreach (USBDeviceDescriptor dev, interfaces) {
+        if (dev.device() == devHandle) {
+          device = dev;
+          break;
+        }
+      }
+      if (! device.isValid()) {
+        ErrorStack::MessageStream msg(err, __FILE__, __LINE__);
+        msg << "Device handle '" << handle << "' not found in:\n";
+        printDevices(msg, interfaces);
+        return radios;
+      }
+      devices.append(device);
+    }
+  }
+
+  // Detect radios, failing devices are skipped
+  foreach (USBDeviceDescriptor device, devices) {
+    ErrorStack deviceErr;
+    Radio *radio = detectRadio(device, parser, deviceErr);
+    if (nullptr == radio) {
+      logError() << "Cannot detect radio at " << device.deviceHandle() << ": "
+                 << deviceErr.format();
+      continue;
+    }
+    logDebug() << "Found " << radio->name() << " at " << device.deviceHandle() << ".";
+    radios.append(radio);
+  }
+
+  if (radios.isEmpty())
+    errMsg(err) << "No radios detected.";
+
+  return radios;
+}
@@ -9,5 +9,7 @@
 QVariant parseDeviceHandle(const QString &device);
 void printDevices(QTextStream &out, const QList<USBDeviceDescriptor> &devices);
 Radio *autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &err=ErrorStack());
+Radio *detectRadio(const USBDeviceDescriptor &device, QCommandLineParser &parser, const ErrorStack &err=ErrorStack());
+QList<Radio *> autoDetectAll(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &err=ErrorStack());
 
 #endif // AUTODETECT_HH
@@ -54,6 +54,8 @@ int encodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
     flags.autoEnableGPS = true;
   if (parser.isSet("auto-enable-roaming"))
     flags.autoEnableRoaming = true;
+  if (parser.isSet("parallel-encode"))
+    flags.parallelEncode = true;
 
   Config config;
   ErrorStack err;
@@ -0,0 +1,32 @@
+#include "interrupt.hh"
+#include "radio.hh"
+#include <csignal>
+
+/** Maximum number of radios cancelled on interrupt. */
+#define MAX_RADIOS 64
+
+/* The radios are kept in a plain array, as the signal handler must not touch any Qt containers. */
+static Radio *_radios[MAX_RADIOS];
+static volatile sig_atomic_t _numRadios = 0;
+
+static void
+onInterrupt(int sig) {
+  // A second interrupt terminates the process
+  std::signal(sig, SIG_DFL);
+  for (int i=0; i<_numRadios; i++)
+    _radios[i]->cancel();
+}
+
+void
+cancelOnInterrupt(const QList<Radio *> &radios) {
+  _numRadios = 0;
+  if (radios.isEmpty()) {
+    std::signal(SIGINT, SIG_DFL);
+    return;
+  }
+  int n = 0;
+  for (; (n<radios.size()) && (n<MAX_RADIOS); n++)
+    _radios[n] = radios[n];
+  _numRadios = n;
+  std::signal(SIGINT, onInterrupt);
+}
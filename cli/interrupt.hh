@@ -0,0 +1,13 @@
+#ifndef INTERRUPT_HH
+#define INTERRUPT_HH
+
+#include <QList>
+
+class Radio;
+
+/** Cancels the transfers of the given radios on Ctrl-C (SIGINT). The transfers stop at the next
+ * block and the radios get rebooted. A second Ctrl-C terminates the process. Pass an empty list
+ * to restore the default behavior. */
+void cancelOnInterrupt(const QList<Radio *> &radios);
+
+#endif // INTERRUPT_HH
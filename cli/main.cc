@@ -14,6 +14,7 @@
 #include "encodecallsigndb.hh"
 #include "decodecodeplug.hh"
 #include "infofile.hh"
+#include "anytone_interface.hh"
 
 #include "uv390_codeplug.hh"
 
@@ -23,6 +24,8 @@ int main(int argc, char *argv[])
   QTextStream out(stderr);
   StreamLogHandler *handler = new StreamLogHandler(out, LogMessage::WARNING, true);
   Logger::get().addHandler(handler);
+  // Write debug and info messages in the background, until the stream goes out of scope
+  AsyncLogging asyncLogging;
 
   // Instantiate core application
   QCoreApplication app(argc, argv);
@@ -63,9 +66,15 @@ int main(int argc, char *argv[])
                      {"D","device"},
                      QCoreApplication::translate("main", "Specifies the device to use to talk to "
                      "the radio. If not specified, the dmrconf will try to detect the radio "
-                     "automatically. Please note, that for some radios the device must be specified."),
+                     "automatically. Please note, that for some radios the device must be specified. "
+                     "When writing a codeplug, several devices may be given to program them at once."),
                      QCoreApplication::translate("main", "DEVICE")
                    });
+  parser.addOption({
+                     "all",
+                     QCoreApplication::translate("main", "Writes the codeplug to all connected "
+                     "radios at once.")
+                   });
   parser.addOption({
                      {"R", "radio"},
                      QCoreApplication::translate("main", "Specifies the radio. This option can also "
@@ -96,6 +105,35 @@ int main(int argc, char *argv[])
                      QCoreApplication::translate(
                        "main", "Initializes the code-plug in the radio. If not present (default) "
                                "the code-plug gets updated, maintining all settings made earlier.")));
+  parser.addOption(QCommandLineOption(
+                     "delta",
+                     QCoreApplication::translate(
+                       "main", "Only writes those parts of the code-plug to the radio, that have "
+                               "changed. Requires the code-plug to be updated.")));
+  parser.addOption(QCommandLineOption(
+                     "cache",
+                     QCoreApplication::translate(
+                       "main", "Uses the locally cached code-plug, last written to the radio, "
+                               "instead of reading it back from the radio, if it can be verified "
+                               "against the radio. Currently without effect.")));
+  parser.addOption(QCommandLineOption(
+                     "resume",
+                     QCoreApplication::translate(
+                       "main", "Resumes an interrupted upload of the same code-plug or call-sign "
+                               "DB to the same radio from the first block not confirmed written. "
+                               "Currently supported by the call-sign DB of AnyTone devices and the "
+                               "code-plug of TyT devices.")));
+  parser.addOption(QCommandLineOption(
+                     "parallel-encode",
+                     QCoreApplication::translate(
+                       "main", "Encodes independent parts of the code-plug concurrently. "
+                               "Currently only supported by AnyTone devices.")));
+  parser.addOption(QCommandLineOption(
+                     "window",
+                     QCoreApplication::translate(
+                       "main", "Specifies the number of requests kept in flight while talking to "
+                               "AnyTone radios. 0 means automatic tuning. Default 1."),
+                     QCoreApplication::translate("main", "N")));
   parser.addOption(QCommandLineOption(
                      "auto-enable-gps",
                      QCoreApplication::translate("main", "Automatically enables GPS if there is a "
@@ -165,6 +203,15 @@ int main(int argc, char *argv[])
   if (parser.isSet("verbose"))
     handler->setMinLevel(LogMessage::DEBUG);
 
+  if (parser.isSet("window")) {
+    bool ok; unsigned window = parser.value("window").toUInt(&ok);
+    if (! ok) {
+      logError() << "Invalid window size '" << parser.value("window") << "'.";
+      return -1;
+    }
+    AnytoneInterface::setDefaultWindowSize(window);
+  }
+
   int res = -1;
   QString command = parser.positionalArguments().at(0);
 
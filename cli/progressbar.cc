@@ -1,6 +1,13 @@
 #include "progressbar.hh"
+#include <QVector>
 
-void showProgress(unsigned percent) {
+static QStringList _labels;
+static QStringList _infos;
+static QVector<unsigned> _percent;
+static unsigned _lastPercent = 0;
+static QString _info;
+
+static void printProgress(unsigned percent) {
   std::cerr << "[";
   for (unsigned i=0; i<50; i++) {
     if (percent/2 > i)
@@ -8,10 +15,59 @@ void showProgress(unsigned percent) {
     else
       std::cerr << " ";
   }
-  std::cerr << "] " << percent <<"%" << std::endl;
+  std::cerr << "] " << percent <<"%";
+}
+
+void showProgress(unsigned percent) {
+  _lastPercent = percent;
+  printProgress(percent);
+  if (! _info.isEmpty())
+    std::cerr << " " << _info.toStdString();
+  std::cerr << std::endl;
 }
 
 void updateProgress(unsigned percent) {
   std::cerr << "\033[1A\033[K";
   showProgress(percent);
 }
+
+void updateProgressInfo(const QString &info) {
+  _info = info;
+  updateProgress(_lastPercent);
+}
+
+static void printMultiProgress() {
+  std::cerr << "\033[" << _labels.size() << "A";
+  for (int i=0; i<_labels.size(); i++) {
+    std::cerr << "\033[K";
+    printProgress(_percent[i]);
+    std::cerr << " " << _labels[i].toStdString();
+    if (! _infos[i].isEmpty())
+      std::cerr << " " << _infos[i].toStdString();
+    std::cerr << std::endl;
+  }
+}
+
+void showMultiProgress(const QStringList &labels) {
+  _labels = labels;
+  _infos = QVector<QString>(labels.size()).toList();
+  _percent = QVector<unsigned>(labels.size(), 0);
+  for (int i=0; i<_labels.size(); i++) {
+    printProgress(0);
+    std::cerr << " " << _labels[i].toStdString() << std::endl;
+  }
+}
+
+void updateMultiProgress(unsigned idx, unsigned percent) {
+  if (int(idx) >= _percent.size())
+    return;
+  _percent[idx] = percent;
+  printMultiProgress();
+}
+
+void updateMultiProgressInfo(unsigned idx, const QString &info) {
+  if (int(idx) >= _infos.size())
+    return;
+  _infos[idx] = info;
+  printMultiProgress();
+}
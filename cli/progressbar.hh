@@ -3,7 +3,14 @@
 
 #include <iostream>
 
+#include <QStringList>
+
 void showProgress(unsigned percent=0);
 void updateProgress(unsigned percent);
+void updateProgressInfo(const QString &info);
+
+void showMultiProgress(const QStringList &labels);
+void updateMultiProgress(unsigned idx, unsigned percent);
+void updateMultiProgressInfo(unsigned idx, const QString &info);
 
 #endif // PROGRESSBAR_HH
@@ -13,6 +13,7 @@
 #include "codeplug.hh"
 #include "progressbar.hh"
 #include "autodetect.hh"
+#include "interrupt.hh"
 
 
 int readCodeplug(QCommandLineParser &parser, QCoreApplication &app)
@@ -33,9 +34,15 @@ int readCodeplug(QCommandLineParser &parser, QCoreApplication &app)
 
   showProgress();
   QObject::connect(radio, &Radio::downloadProgress, updateProgress);
+  QObject::connect(radio->job(), &TransferJob::progressed, [](const TransferProgress &progress) {
+    updateProgressInfo(progress.format());
+  });
 
   Config config;
-  if (! radio->startDownload(true, err)) {
+  cancelOnInterrupt({radio});
+  bool started = radio->startDownload(true, err);
+  cancelOnInterrupt({});
+  if (! started) {
     logError() << "Codeplug download error: " << err.format();
     return -1;
   }
@@ -9,6 +9,7 @@
 #include "progressbar.hh"
 #include "callsigndb.hh"
 #include "autodetect.hh"
+#include "interrupt.hh"
 
 
 int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
@@ -33,6 +34,7 @@ int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     }
   }
 
+  CallsignDB::Selection selection;
   if (parser.isSet("id")) {
     QStringList prefixes_text = parser.value("id").split(",");
     QSet<unsigned> prefixes;
@@ -50,8 +52,8 @@ int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     foreach (unsigned prefix, prefixes) {
       prefixes_text.append(QString::number(prefix));
     }
-    logDebug() << "Sort call-sign DB w.r.t. DMR ID(s) {" << prefixes_text.join(", ") << "}.";
-    userdb.sortUsers(prefixes);
+    logDebug() << "Select call-signs closest to DMR ID(s) {" << prefixes_text.join(", ") << "}.";
+    selection.setPrefixes(prefixes);
   } else {
     logWarn() << "No ID is specified, a more or less random set of call-signs will be used "
               << "if the radio cannot hold the entire call-sign DB of " << userdb.count()
@@ -59,7 +61,6 @@ int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
               << "select those entries 'closest' to you. I.e., DMR IDs with the same prefix.";
   }
 
-  CallsignDB::Selection selection;
   if (parser.isSet("limit")) {
     bool ok=true;
     selection.setCountLimit(parser.value("limit").toUInt(&ok));
@@ -78,8 +79,17 @@ int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
 
   showProgress();
   QObject::connect(radio, &Radio::uploadProgress, updateProgress);
+  QObject::connect(radio->job(), &TransferJob::progressed, [](const TransferProgress &progress) {
+    updateProgressInfo(progress.format());
+  });
+
+  if (parser.isSet("resume"))
+    radio->job()->setJournal(TransferJob::Journal::Resume);
 
-  if (! radio->startUploadCallsignDB(&userdb, true, selection, err)) {
+  cancelOnInterrupt({radio});
+  bool started = radio->startUploadCallsignDB(&userdb, true, selection, err);
+  cancelOnInterrupt({});
+  if ((! started) || (Radio::StatusError == radio->status())) {
     logError() << "Could not upload call-sign DB to radio: " << err.format();
     return -1;
   }
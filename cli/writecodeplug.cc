@@ -3,15 +3,131 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QFileInfo>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QHash>
 
 #include "logger.hh"
 #include "radio.hh"
 #include "config.hh"
 #include "progressbar.hh"
 #include "autodetect.hh"
+#include "interrupt.hh"
 #include "radiolimits.hh"
 
 
+/** Prints the verification issues of the codeplug for the given radio. */
+static void
+printVerificationIssues(Radio *radio, Config *config, bool ignoreLimits) {
+  RadioLimitContext ctx(ignoreLimits);
+  radio->limits().verifyConfig(config, ctx);
+
+  // Only print warnings
+  for (int i=0; i<ctx.count(); i++) {
+    switch (ctx.message(i).severity()) {
+    case RadioLimitIssue::Warning:
+      logWarn() << "Verification Issue: " << ctx.message(i).format();
+      break;
+    case RadioLimitIssue::Critical:
+      logError() << "Verification Issue: " << ctx.message(i).format();
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+/** Writes the codeplug to several radios concurrently. Every radio runs its transfer in its own
+ * thread, hence the wall time is close to the one of the slowest radio. */
+static int
+writeCodeplugBatch(QCommandLineParser &parser, QCoreApplication &app, Config &config,
+                   Codeplug::Flags flags) {
+  ErrorStack err;
+  QList<Radio *> radios = autoDetectAll(parser, app, err);
+  if (radios.isEmpty()) {
+    logError() << "Cannot detect radios: " << err.format();
+    return -1;
+  }
+
+  if (parser.isSet("resume"))
+    logWarn() << "Option --resume has no effect when writing to several radios.";
+
+  // Verify codeplug only once per radio model
+  QHash<QString, bool> verified;
+  foreach (Radio *radio, radios) {
+    if (verified.contains(radio->name()))
+      continue;
+    logInfo() << "Verify codeplug for " << radio->name() << ".";
+    printVerificationIssues(radio, &config, parser.isSet("ignore-limits"));
+    verified.insert(radio->name(), true);
+  }
+
+  // Every radio gets its own deep copy of the codeplug and its own error stack. In update mode,
+  // the codeplug gets encoded on top of the image read back from each radio, hence the encoding
+  // happens within the radio threads concurrently. The copies do not share any elements, so the
+  // threads do not touch the same objects.
+  QVector<Config *> configs;
+  QVector<ErrorStack> errors(radios.size());
+  QStringList labels;
+  for (int i=0; i<radios.size(); i++) {
+    configs.append(qobject_cast<Config *>(config.clone()));
+    labels.append(QString("%1 (#%2)").arg(radios[i]->name()).arg(i+1));
+  }
+
+  QEventLoop loop;
+  int running = 0;
+  QElapsedTimer timer; timer.start();
+  showMultiProgress(labels);
+  for (int i=0; i<radios.size(); i++) {
+    QObject::connect(radios[i], &Radio::uploadProgress, &loop, [i](int percent) {
+      updateMultiProgress(i, percent);
+    });
+    QObject::connect(radios[i]->job(), &TransferJob::progressed, &loop,
+                     [i](const TransferProgress &progress) {
+      updateMultiProgressInfo(i, progress.format());
+    });
+    QObject::connect(radios[i], &QThread::finished, &loop, [&loop, &running]() {
+      if (0 == (--running))
+        loop.quit();
+    });
+    // Radios of the same kind share their journal, hence uploads to several radios are not
+    // journaled.
+    radios[i]->job()->setJournal(TransferJob::Journal::Off);
+    logDebug() << "Start upload to " << labels[i] << ".";
+    if ((nullptr == configs[i]) || (! radios[i]->startUpload(configs[i], false, flags, errors[i]))) {
+      errMsg(errors[i]) << "Cannot start upload.";
+      continue;
+    }
+    running++;
+  }
+  // Ctrl-C cancels all transfers, the radios get rebooted
+  cancelOnInterrupt(radios);
+  if (running)
+    loop.exec();
+  cancelOnInterrupt({});
+
+  // Summary
+  int failed = 0;
+  for (int i=0; i<radios.size(); i++) {
+    if ((nullptr == configs[i]) || (Radio::StatusError == radios[i]->status()) || (! errors[i].isEmpty())) {
+      logError() << "Codeplug upload to " << labels[i] << " failed: " << errors[i].format();
+      failed++;
+    } else {
+      logInfo() << "Codeplug upload to " << labels[i] << " completed.";
+    }
+  }
+  logInfo() << "Wrote codeplug to " << (radios.size()-failed) << " of " << radios.size()
+            << " radios in " << QString::number(timer.elapsed()/1000., 'f', 1) << "s.";
+
+  for (int i=0; i<radios.size(); i++) {
+    radios[i]->deleteLater();
+    if (configs[i])
+      configs[i]->deleteLater();
+  }
+
+  return failed ? -1 : 0;
+}
+
 int writeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
   if (2 > parser.positionalArguments().size())
     parser.showHelp(-1);
@@ -35,6 +151,30 @@ int writeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
   }
   logDebug() << "Read codeplug from '" << filename << "'.";
 
+  Codeplug::Flags flags;
+  if (parser.isSet("init-codeplug"))
+    flags.updateCodePlug = false;
+  if (parser.isSet("auto-enable-gps"))
+    flags.autoEnableGPS = true;
+  if (parser.isSet("auto-enable-roaming"))
+    flags.autoEnableRoaming = true;
+  if (parser.isSet("parallel-encode"))
+    flags.parallelEncode = true;
+  if (parser.isSet("delta")) {
+    if (! flags.updateCodePlug)
+      logWarn() << "Option --delta has no effect when --init-codeplug is set.";
+    flags.deltaUpload = true;
+  }
+  if (parser.isSet("cache")) {
+    logWarn() << "Option --cache has no effect: None of the supported radios can verify a "
+                 "cached code-plug without reading it back.";
+    flags.useImageCache = true;
+  }
+
+  // Write to several radios at once
+  if (parser.isSet("all") || (1 < parser.values("device").join(",").split(",", QString::SkipEmptyParts).size()))
+    return writeCodeplugBatch(parser, app, config, flags);
+
   ErrorStack err;
   Radio *radio = autoDetect(parser, app, err);
   if (nullptr == radio) {
@@ -42,43 +182,22 @@ int writeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
     return -1;
   }
 
-  RadioLimitContext ctx(parser.isSet("ignore-limits"));
-
-  bool verified = true;
-  radio->limits().verifyConfig(&config, ctx);
-
-  // Only print warnings
-  for (int i=0; i<ctx.count(); i++) {
-    switch (ctx.message(i).severity()) {
-    case RadioLimitIssue::Warning:
-      logWarn() << "Verification Issue: " << ctx.message(i).format();
-      break;
-    case RadioLimitIssue::Critical:
-      logError() << "Verification Issue: " << ctx.message(i).format();
-      break;
-    default:
-      break;
-    }
-  }
-
-  if (! verified) {
-    logError() << "Cannot upload codeplug to device: Codeplug cannot be verified with radio.";
-    return -1;
-  }
+  printVerificationIssues(radio, &config, parser.isSet("ignore-limits"));
 
   showProgress();
   QObject::connect(radio, &Radio::uploadProgress, updateProgress);
+  QObject::connect(radio->job(), &TransferJob::progressed, [](const TransferProgress &progress) {
+    updateProgressInfo(progress.format());
+  });
 
-  Codeplug::Flags flags;
-  if (parser.isSet("init-codeplug"))
-    flags.updateCodePlug = false;
-  if (parser.isSet("auto-enable-gps"))
-    flags.autoEnableGPS = true;
-  if (parser.isSet("auto-enable-roaming"))
-    flags.autoEnableRoaming = true;
+  if (parser.isSet("resume"))
+    radio->job()->setJournal(TransferJob::Journal::Resume);
 
   logDebug() << "Start upload to " << radio->name() << ".";
-  if (! radio->startUpload(&config, true, flags, err)) {
+  cancelOnInterrupt({radio});
+  bool started = radio->startUpload(&config, true, flags, err);
+  cancelOnInterrupt({});
+  if (! started) {
     logError() << "Codeplug upload error: " << err.format();
     return -1;
   }
@@ -2,13 +2,13 @@
 #include <algorithm>
 
 AddressMap::AddressMap()
-  : _items()
+  : _items(), _pages()
 {
   // pass...
 }
 
 AddressMap::AddressMap(const AddressMap &other)
-  : _items(other._items)
+  : _items(other._items), _pages(other._pages)
 {
   // pass...
 }
@@ -16,6 +16,7 @@ AddressMap::AddressMap(const AddressMap &other)
 AddressMap &
 AddressMap::operator =(const AddressMap &other) {
   _items = other._items;
+  _pages = other._pages;
   return *this;
 }
 
@@ -23,35 +24,46 @@ AddressMap::operator =(const AddressMap &other) {
 void
 AddressMap::clear() {
   _items.clear();
+  _pages.clear();
 }
 
 bool
 AddressMap::add(uint32_t addr, uint32_t len, int idx) {
   if (0 > idx)
     idx = _items.size();
-  AddrMapItem item(addr, len, idx);
-
-  std::vector<AddrMapItem>::iterator at = std::lower_bound(_items.begin(), _items.end(), item);
-  if (_items.end() == at)
-    _items.push_back(item);
-  else
-    _items.insert(at, item);
+  _items.push_back(AddrMapItem(addr, len, idx));
+  markPages(_items.size()-1);
   return true;
 }
 
 bool
 AddressMap::rem(uint32_t idx) {
-  std::vector<AddrMapItem>::iterator at = _items.begin();
-  for (; at!=_items.end(); at++) {
-    if (at->index == idx)
+  uint32_t pos = 0;
+  for (; pos<_items.size(); pos++) {
+    if (_items[pos].index == idx)
       break;
   }
-  if (_items.end() == at)
+  if (_items.size() == pos)
     return false;
-  _items.erase(at);
+  // Move the last item into the gap, only the pages of these two items are updated
+  uint32_t last = _items.size()-1;
+  updatePages(pos, -1);
+  if (pos != last) {
+    updatePages(last, pos);
+    _items[pos] = _items[last];
+  }
+  _items.pop_back();
   return true;
 }
 
+void
+AddressMap::shiftIndices(uint32_t idx, int delta) {
+  for (std::vector<AddrMapItem>::iterator item=_items.begin(); item!=_items.end(); item++) {
+    if (item->index >= idx)
+      item->index += delta;
+  }
+}
+
 bool
 AddressMap::contains(uint32_t addr) const {
   return 0 <= find(addr);
@@ -59,13 +71,64 @@ AddressMap::contains(uint32_t addr) const {
 
 int
 AddressMap::find(uint32_t addr) const {
-  std::vector<AddrMapItem>::const_iterator at = std::lower_bound(_items.begin(), _items.end(), addr);
-  if (_items.end() == at)
-    return _items.back().contains(addr) ? _items.back().index : -1;
-  if (at->contains(addr))
-    return at->index;
-  if (_items.begin() == at)
+  const Page *p = page(addr);
+  if ((nullptr == p) || p->empty())
+    return -1;
+  // Items overlapping the page are sorted by their address, find the last one starting at or
+  // before the given address
+  Page::const_iterator pos = std::upper_bound(
+        p->begin(), p->end(), addr, [this](uint32_t addr, uint32_t pos) {
+    return addr < _items[pos].address;
+  });
+  if (p->begin() == pos)
     return -1;
-  --at;
-  return at->contains(addr) ? at->index : -1;
+  const AddrMapItem &item = _items[*(--pos)];
+  return item.contains(addr) ? int(item.index) : -1;
+}
+
+const AddressMap::Page *
+AddressMap::page(uint32_t addr) const {
+  uint32_t table = addr >> (PageBits+TableBits);
+  if ((table >= _pages.size()) || _pages[table].empty())
+    return nullptr;
+  return &_pages[table][(addr >> PageBits) & ((1u<<TableBits)-1)];
+}
+
+void
+AddressMap::markPages(uint32_t pos) {
+  const AddrMapItem &item = _items[pos];
+  if (0 == item.length)
+    return;
+  uint64_t first = item.address >> PageBits, last = (uint64_t(item.address)+item.length-1) >> PageBits;
+  for (uint64_t page=first; page<=last; page++) {
+    uint32_t table = page >> TableBits;
+    if (table >= _pages.size())
+      _pages.resize(table+1);
+    if (_pages[table].empty())
+      _pages[table].resize(1u<<TableBits);
+    // Keep items sorted by address, usually they are added in order
+    Page &entries = _pages[table][page & ((1u<<TableBits)-1)];
+    Page::iterator at = entries.end();
+    while ((entries.begin() != at) && (_items[*(at-1)].address > item.address))
+      at--;
+    entries.insert(at, pos);
+  }
+}
+
+void
+AddressMap::updatePages(uint32_t pos, int64_t newPos) {
+  const AddrMapItem &item = _items[pos];
+  if (0 == item.length)
+    return;
+  uint64_t first = item.address >> PageBits, last = (uint64_t(item.address)+item.length-1) >> PageBits;
+  for (uint64_t page=first; page<=last; page++) {
+    Page &entries = _pages[page >> TableBits][page & ((1u<<TableBits)-1)];
+    Page::iterator at = std::find(entries.begin(), entries.end(), pos);
+    if (entries.end() == at)
+      continue;
+    if (0 > newPos)
+      entries.erase(at);
+    else
+      *at = newPos;
+  }
 }
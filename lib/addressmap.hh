@@ -9,6 +9,12 @@
  * efficiently. This should speedup the generation of codeplugs consisting of many small memory
  * sections.
  *
+ * Additionally to the vector of memory regions, a sparse, two-level page table is maintained. For
+ * every allocated page of 4kb, it holds the positions of all memory regions overlapping that page,
+ * sorted by their address. Hence, the lookup of an address is done in (almost) constant time. The second level of the page table
+ * (covering 4MB each) is only allocated on demand. Adding or removing a memory region only updates
+ * the pages covered by it.
+ *
  * @ingroup util */
 class AddressMap
 {
@@ -25,8 +31,11 @@ public:
   void clear();
   /** Adds an item to the address map. */
   bool add(uint32_t addr, uint32_t len, int idx=-1);
-  /** Removes an item from the address map associated with the given index. */
+  /** Removes an item from the address map associated with the given index. The indices of the
+   * remaining items are kept. */
   bool rem(uint32_t idx);
+  /** Adds @c delta to the indices of all items with an index greater or equal to @c idx. */
+  void shiftIndices(uint32_t idx, int delta);
   /** Returns @c true if the given address is contained in any of the memory regions. */
   bool contains(uint32_t addr) const;
   /** Finds the index of the memory region containing the given address. If no such region is found,
@@ -46,14 +55,6 @@ protected:
       : address(addr), length(len), index(idx) {
       // pass...
     }
-    /** Comparison operator. */
-    inline bool operator<(const AddrMapItem &other) const {
-      return address < other.address;
-    }
-    /** Comparison operator. */
-    inline bool operator<(uint32_t addr) const {
-      return address < addr;
-    }
     /** Returns @c true if the given address is contained within this memory region. */
     inline bool contains(uint32_t addr) const {
       return (address <= addr) && ((address+length) > addr);
@@ -61,8 +62,28 @@ protected:
   };
 
 protected:
-  /** Holds the vector of memory items, the order of these items is maintained. */
+  /** Positions of the items within @c _items overlapping a page, sorted by their address. */
+  typedef std::vector<uint32_t> Page;
+
+  /** Returns the page containing the given address or @c nullptr if the page is not allocated. */
+  const Page *page(uint32_t addr) const;
+  /** Adds the item at the given position within @c _items to all pages covered by it. */
+  void markPages(uint32_t pos);
+  /** Replaces the position @c pos by @c newPos within all pages covered by the item at @c pos. If
+   * @c newPos is negative, the position gets removed. */
+  void updatePages(uint32_t pos, int64_t newPos);
+
+protected:
+  /** Number of address bits addressing a byte within a page. */
+  static const unsigned PageBits = 12;
+  /** Number of address bits addressing a page within a second-level table. */
+  static const unsigned TableBits = 10;
+
+  /** Holds the vector of memory items in no particular order. */
   std::vector<AddrMapItem> _items;
+  /** The page table. For each page, it holds the positions of all items in @c _items overlapping
+   * the page, sorted by their address. Second-level tables are allocated on demand. */
+  std::vector< std::vector<Page> > _pages;
 };
 
 #endif // ADDRESSMAP_HH
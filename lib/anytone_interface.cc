@@ -1,10 +1,17 @@
 #include "anytone_interface.hh"
 #include "logger.hh"
 #include <QtEndian>
+#include <QElapsedTimer>
+#include <algorithm>
 
 #define USB_VID 0x28e9
 #define USB_PID 0x018a
 
+/** Maximum number of requests in flight, if tuned automatically. */
+#define MAX_WINDOW 64
+/** Number of attempts for each failed block. */
+#define MAX_RETRIES 3
+
 /* ********************************************************************************************* *
  * Implementation of AnytoneInterface::ReadRequest
  * ********************************************************************************************* */
@@ -82,11 +89,41 @@ AnytoneInterface::RadioVariant::isValid() const {
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of AnytoneInterface::TransferStatistics
+ * ********************************************************************************************* */
+AnytoneInterface::TransferStatistics::TransferStatistics()
+  : blocks(0), retries(0), timeouts(0), roundTrips(0), elapsed(0), maxLatency(0)
+{
+  // pass...
+}
+
+void
+AnytoneInterface::TransferStatistics::reset() {
+  blocks = retries = timeouts = roundTrips = 0;
+  elapsed = maxLatency = 0;
+}
+
+QString
+AnytoneInterface::TransferStatistics::format() const {
+  double seconds = double(elapsed)/1e9;
+  double throughput = (seconds > 0) ? (blocks*16/1024.)/seconds : 0;
+  double latency = roundTrips ? double(elapsed)/roundTrips/1e6 : 0;
+  return QString("%1 blocks (%2 retries, %3 timeouts) in %4s, %5 kB/s, mean latency %6 ms, "
+                 "max. latency %7 ms")
+      .arg(blocks).arg(retries).arg(timeouts).arg(seconds, 0, 'f', 2).arg(throughput, 0, 'f', 1)
+      .arg(latency, 0, 'f', 2).arg(double(maxLatency)/1e6, 0, 'f', 2);
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of AnytoneInterface
  * ********************************************************************************************* */
+unsigned AnytoneInterface::_defaultWindow = 1;
+
 AnytoneInterface::AnytoneInterface(const USBDeviceDescriptor &descriptor, const ErrorStack &err, QObject *parent)
-  : USBSerial(descriptor, err, parent), _state(STATE_INITIALIZED), _info()
+  : USBSerial(descriptor, err, parent), _state(STATE_INITIALIZED), _info(),
+    _window(_defaultWindow), _currentWindow(std::max(1u, _defaultWindow)), _statistics()
 {
   if (isOpen()) {
     _state = STATE_OPEN;
@@ -192,16 +229,61 @@ AnytoneInterface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes,
 
   //logDebug() << "Anytone: Write " << nbytes << "b to addr 0x" << QString::number(addr, 16) << "...";
 
-  for (int i=0; i<nbytes; i+=16) {
-    uint8_t ack;
-    WriteRequest req(addr+i, (const char *)(data+i));
-    if (! send_receive((const char *)&req, sizeof(WriteRequest),(char *)&ack, 1, err)) {
+  unsigned nblocks = (nbytes+15)/16;
+  QVector<unsigned> failed;
+  QByteArray requests; QByteArray acks;
+  QElapsedTimer timer;
+  for (unsigned b=0; b<nblocks;) {
+    // Assemble batch of write requests
+    unsigned n = nextBatchSize(nblocks-b);
+    requests.resize(n*sizeof(WriteRequest)); acks.resize(n);
+    for (unsigned i=0; i<n; i++) {
+      WriteRequest req(addr+(b+i)*16, (const char *)(data+(b+i)*16));
+      memcpy(requests.data()+i*sizeof(WriteRequest), &req, sizeof(WriteRequest));
+    }
+    // Send all requests at once and wait for all ACKs, they are received in order.
+    timer.start();
+    int received = 0;
+    if (! exchange(requests.constData(), requests.size(), acks.data(), n, received, err)) {
       errMsg(err) << "Anytone: Cannot write data to device.";
       return false;
     }
+    // On a timeout, the ACKs received cannot be assigned to the requests, as they carry no
+    // address. Hence all blocks of that batch are written again, which is harmless.
+    bool timeout = (received < int(n));
+    if (timeout)
+      timedOut(n-received);
+    unsigned nfailed = 0;
+    for (unsigned i=0; i<n; i++) {
+      if (timeout || (0x06 != uint8_t(acks.at(i)))) {
+        failed.append(b+i); nfailed++;
+      }
+    }
+    batchDone(n, nfailed, timer.nsecsElapsed());
+    b += n;
+  }
+
+  // Retry failed blocks individually
+  foreach (unsigned b, failed) {
+    uint8_t ack = 0;
+    for (unsigned attempt=0; (attempt<MAX_RETRIES) && (0x06 != ack); attempt++) {
+      WriteRequest req(addr+b*16, (const char *)(data+b*16));
+      timer.start();
+      int received = 0; ack = 0;
+      if (! exchange((const char *)&req, sizeof(WriteRequest), (char *)&ack, 1, received, err)) {
+        errMsg(err) << "Anytone: Cannot write data to device.";
+        return false;
+      }
+      if (1 > received)
+        timedOut(1);
+      _statistics.retries++;
+      batchDone(1, (0x06 != ack) ? 1 : 0, timer.nsecsElapsed());
+    }
     if (0x06 != ack) {
-      errMsg(err) << "Anytone: Cannot write data to device: Unexpected response "
+      errMsg(err) << "Anytone: Cannot write data to device: No or unexpected response "
                   << (int)ack << ", expected 6.";
+      _state = STATE_ERROR;
+      USBSerial::close();
       return false;
     }
   }
@@ -239,20 +321,86 @@ AnytoneInterface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes,
 
   //logDebug() << "Anytone: Read " << nbytes << "b from addr 0x" << QString::number(addr, 16) << "...";
 
-  for (int i=0; i<nbytes; i+=16) {
-    ReadRequest req(addr + i);
-    ReadResponse resp;
-    if (! send_receive((const char *)&req, sizeof(ReadRequest),
-                       (char *)&resp, sizeof(ReadResponse), err)) {
+  unsigned nblocks = (nbytes+15)/16;
+  QVector<unsigned> failed;
+  QByteArray requests; QVector<ReadResponse> responses;
+  QElapsedTimer timer;
+  QString error_message;
+  for (unsigned b=0; b<nblocks;) {
+    // Assemble batch of read requests
+    unsigned n = nextBatchSize(nblocks-b);
+    requests.resize(n*sizeof(ReadRequest)); responses.resize(n);
+    for (unsigned i=0; i<n; i++) {
+      ReadRequest req(addr+(b+i)*16);
+      memcpy(requests.data()+i*sizeof(ReadRequest), &req, sizeof(ReadRequest));
+    }
+    // Send all requests at once and wait for all responses, they are received in order.
+    timer.start();
+    int received = 0;
+    if (! exchange(requests.constData(), requests.size(),
+                   (char *)responses.data(), n*sizeof(ReadResponse), received, err)) {
       errMsg(err) << "Anytone: Cannot read data from device.";
       return false;
     }
-    QString error_message;
-    if (! resp.check(addr+i, error_message)) {
+    unsigned complete = received/sizeof(ReadResponse);
+    if (complete < n)
+      timedOut(n-complete);
+    // On a timeout, a response may be missing in between. Hence the complete responses are
+    // assigned to the blocks by their address.
+    QVector<bool> done(n, false);
+    for (unsigned i=0; i<complete; i++) {
+      uint32_t raddr = qFromBigEndian(responses[i].addr);
+      unsigned j = (raddr - (addr+b*16))/16;
+      if ((raddr < addr+b*16) || (j >= n) || (raddr != addr+(b+j)*16) || done[j]) {
+        logDebug() << "Anytone: Retry read request: Unexpected response for address "
+                    << QString::number(raddr, 16) << "h.";
+        continue;
+      }
+      if (! responses[i].check(raddr, error_message)) {
+        logDebug() << "Anytone: Retry read request: " << error_message << ".";
+        continue;
+      }
+      memcpy(data+(b+j)*16, responses[i].data, 16);
+      done[j] = true;
+    }
+    unsigned nfailed = 0;
+    for (unsigned i=0; i<n; i++) {
+      if (! done[i]) {
+        failed.append(b+i); nfailed++;
+      }
+    }
+    batchDone(n, nfailed, timer.nsecsElapsed());
+    b += n;
+  }
+
+  // Retry failed blocks individually
+  foreach (unsigned b, failed) {
+    ReadResponse resp; bool ok = false;
+    for (unsigned attempt=0; (attempt<MAX_RETRIES) && (! ok); attempt++) {
+      ReadRequest req(addr+b*16);
+      timer.start();
+      int received = 0;
+      if (! exchange((const char *)&req, sizeof(ReadRequest),
+                     (char *)&resp, sizeof(ReadResponse), received, err)) {
+        errMsg(err) << "Anytone: Cannot read data from device.";
+        return false;
+      }
+      if (int(sizeof(ReadResponse)) > received) {
+        error_message = tr("No response from device: Timeout");
+        timedOut(1);
+      } else {
+        ok = resp.check(addr+b*16, error_message);
+      }
+      _statistics.retries++;
+      batchDone(1, ok ? 0 : 1, timer.nsecsElapsed());
+    }
+    if (! ok) {
       errMsg(err) << "Anytone: Cannot read data from device: " << error_message << ".";
+      _state = STATE_ERROR;
+      USBSerial::close();
       return false;
     }
-    memcpy(data+i, resp.data, 16);
+    memcpy(data+b*16, resp.data, 16);
   }
 
   return true;
@@ -278,6 +426,68 @@ AnytoneInterface::reboot(const ErrorStack &err) {
   return true;
 }
 
+unsigned
+AnytoneInterface::windowSize() const {
+  return _window;
+}
+
+void
+AnytoneInterface::setWindowSize(unsigned size) {
+  _window = size;
+  _currentWindow = std::max(1u, size);
+}
+
+const AnytoneInterface::TransferStatistics &
+AnytoneInterface::statistics() const {
+  return _statistics;
+}
+
+void
+AnytoneInterface::resetStatistics() {
+  _statistics.reset();
+}
+
+unsigned
+AnytoneInterface::defaultWindowSize() {
+  return _defaultWindow;
+}
+
+void
+AnytoneInterface::setDefaultWindowSize(unsigned size) {
+  _defaultWindow = size;
+}
+
+unsigned
+AnytoneInterface::nextBatchSize(unsigned remaining) const {
+  return std::max(1u, std::min(_currentWindow, remaining));
+}
+
+void
+AnytoneInterface::batchDone(unsigned n, unsigned failed, qint64 ns) {
+  _statistics.blocks += n-failed;
+  _statistics.roundTrips++;
+  _statistics.elapsed += ns;
+  _statistics.maxLatency = std::max(_statistics.maxLatency, ns);
+
+  // Auto-tuning: grow window while all requests succeed, shrink it on failures. A fixed window
+  // only grows back to its configured size after a timeout.
+  unsigned limit = (0 == _window) ? MAX_WINDOW : _window;
+  if (failed && (0 == _window))
+    _currentWindow = std::max(1u, _currentWindow/2);
+  else if ((! failed) && (n == _currentWindow))
+    _currentWindow = std::min(limit, 2*_currentWindow);
+}
+
+void
+AnytoneInterface::timedOut(unsigned missing) {
+  logDebug() << "Anytone: Timeout, " << missing << " responses missing. Retry requests "
+             << "individually.";
+  // Discard late responses, they would be taken as responses to the next requests
+  drain();
+  _statistics.timeouts++;
+  _currentWindow = 1;
+}
+
 bool
 AnytoneInterface::enter_program_mode(const ErrorStack &err) {
   if (STATE_PROGRAM == _state) {
@@ -360,36 +570,70 @@ AnytoneInterface::leave_program_mode(const ErrorStack &err) {
 
 bool
 AnytoneInterface::send_receive(const char *cmd, int clen, char *resp, int rlen, const ErrorStack &err) {
+  int received = 0;
+  if (! exchange(cmd, clen, resp, rlen, received, err))
+    return false;
+
+  if (received < rlen) {
+    errMsg(err) << "No response from device: Timeout.";
+    // Do not try to leave the program mode, the device does not respond anyway
+    _state = STATE_ERROR;
+    USBSerial::close();
+    return false;
+  }
+
+  // done
+  return true;
+}
+
+bool
+AnytoneInterface::exchange(const char *cmd, int clen, char *resp, int rlen, int &received,
+                           const ErrorStack &err)
+{
   // Try to write command to device
-  if (clen != QSerialPort::write(cmd, clen)) {
+  if (! transmit(cmd, clen)) {
     errMsg(err) << "Cannot send command to device.";
-    close();
     _state = STATE_ERROR;
+    USBSerial::close();
     return false;
   }
 
-  // Read from device until complete response has been read
-  char *p = resp;
-  int len = rlen;
-  while (len > 0) {
-    if (! waitForReadyRead(1000)) {
-      errMsg(err) << "No response from device: Timeout.";
-      close();
-      _state = STATE_ERROR;
-      return false;
-    }
-
-    int r = QSerialPort::read(p, len);
+  // Read from device until complete response has been read or the device stops responding
+  received = 0;
+  while (received < rlen) {
+    int r = receive(resp+received, rlen-received, 1000);
+    if (0 == r)
+      break;
     if (r < 0) {
       errMsg(err) << "Cannot read response from device.";
-      close();
       _state = STATE_ERROR;
+      USBSerial::close();
       return false;
     }
-    p += r;
-    len-=r;
+    received += r;
   }
 
   // done
   return true;
 }
+
+bool
+AnytoneInterface::transmit(const char *data, int len) {
+  return len == QSerialPort::write(data, len);
+}
+
+int
+AnytoneInterface::receive(char *data, int len, int timeout) {
+  if ((0 == QSerialPort::bytesAvailable()) && (! waitForReadyRead(timeout)))
+    return 0;
+  return QSerialPort::read(data, len);
+}
+
+void
+AnytoneInterface::drain() {
+  // Discard pending responses and wait briefly for late ones
+  do {
+    QSerialPort::readAll();
+  } while (waitForReadyRead(100));
+  QSerialPort::clear(QSerialPort::Input);
+}
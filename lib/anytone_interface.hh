@@ -10,6 +10,14 @@
  * needed to access these devices. The user, however, should be a member of the @c dialout group
  * to get access to the serial interfaces.
  *
+ * Every read and write request transfers 16 bytes only. Hence, the transfer time is dominated by
+ * the round-trip latency of the USB serial link. To this end, the interface may keep several
+ * requests in flight (see @c setWindowSize). The responses are then matched against the requests
+ * in the order they were sent. Only those blocks, that failed, are retried individually
+ * afterwards. If the device stops responding within a batch, late responses are discarded and the
+ * window drops to a single request. Read requests not answered are then retried individually. As
+ * write ACKs carry no address, all write requests of such a batch are retried individually.
+ *
  * @ingroup anytone */
 class AnytoneInterface : public USBSerial
 {
@@ -31,6 +39,31 @@ public:
     bool isValid() const;
   };
 
+  /** Collects some statistics about the transfers to and from the device.
+   * These statistics are collected across all calls to @c read and @c write, until they get reset
+   * using @c resetStatistics. */
+  struct TransferStatistics {
+    /** Number of 16b blocks transferred. */
+    unsigned blocks;
+    /** Number of blocks, that needed to be retransmitted. */
+    unsigned retries;
+    /** Number of batches, the device did not respond to entirely. */
+    unsigned timeouts;
+    /** Number of round-trips, that is batches of requests sent. */
+    unsigned roundTrips;
+    /** Total time spent in transfers in ns. */
+    qint64 elapsed;
+    /** The maximum round-trip time in ns. */
+    qint64 maxLatency;
+
+    /** Empty constructor. */
+    TransferStatistics();
+    /** Resets the statistics. */
+    void reset();
+    /** Formats the statistics as a human readable text (throughput, latency etc.). */
+    QString format() const;
+  };
+
 public:
   /** Constructs a new interface to Anytone radios. If a matching device was found, @c isOpen
    * returns @c true. */
@@ -59,12 +92,30 @@ public:
 
   bool reboot(const ErrorStack &err=ErrorStack());
 
+  /** Returns the configured number of requests kept in flight. If 0, the window size gets
+   * tuned automatically. */
+  unsigned windowSize() const;
+  /** Sets the number of requests kept in flight. A window size of 1 (default) sends a single
+   * request and waits for its response before sending the next. If 0, the window size is tuned
+   * automatically. */
+  void setWindowSize(unsigned size);
+
+  /** Returns the transfer statistics. */
+  const TransferStatistics &statistics() const;
+  /** Resets the transfer statistics. */
+  void resetStatistics();
+
 public:
   /** Returns some information about this interface. */
   static USBDeviceInfo interfaceInfo();
   /** Tries to find all interfaces connected AnyTone radios. */
   static QList<USBDeviceDescriptor> detect();
 
+  /** Returns the window size, new interfaces are configured with. */
+  static unsigned defaultWindowSize();
+  /** Sets the window size, new interfaces are configured with. See @c setWindowSize. */
+  static void setDefaultWindowSize(unsigned size);
+
 protected:
   /** Send command message to radio to ender program state. */
   bool enter_program_mode(const ErrorStack &err=ErrorStack());
@@ -72,8 +123,29 @@ protected:
   bool request_identifier(RadioVariant &info, const ErrorStack &err=ErrorStack());
   /** Sends a command message to radio to leave program state and reboot. */
   bool leave_program_mode(const ErrorStack &err=ErrorStack());
-  /** Internal used method to send messages to and receive responses from radio. */
+  /** Internal used method to send messages to and receive responses from radio. Fails on a
+   * timeout. */
   bool send_receive(const char *cmd, int clen, char *resp, int rlen, const ErrorStack &err=ErrorStack());
+  /** Sends the given message and receives up to @c rlen bytes of responses. On a timeout, the
+   * number of bytes received is less than @c rlen.
+   * @returns @c false on I/O errors only. */
+  bool exchange(const char *cmd, int clen, char *resp, int rlen, int &received,
+                const ErrorStack &err=ErrorStack());
+  /** Sends the given data to the device. */
+  virtual bool transmit(const char *data, int len);
+  /** Receives at most @c len bytes from the device, waits at most @c timeout ms for them.
+   * @returns The number of bytes received, 0 on timeout and -1 on error. */
+  virtual int receive(char *data, int len, int timeout);
+  /** Discards any pending or late responses from the device. */
+  virtual void drain();
+  /** Returns the number of requests to send within the next batch, at most @c remaining. */
+  unsigned nextBatchSize(unsigned remaining) const;
+  /** Updates the transfer statistics and automatic window size after a batch of @c n requests
+   * with @c failed failures and a round-trip time of @c ns nano seconds. */
+  void batchDone(unsigned n, unsigned failed, qint64 ns);
+  /** Handles a batch of requests, @c missing of which were not answered in time. Discards late
+   * responses and drops the window to a single request. */
+  void timedOut(unsigned missing);
 
 protected:
   /** Binary representation of a read request to the radio. */
@@ -137,6 +209,15 @@ protected:
   State _state;
   /** Holds the radio info. */
   RadioVariant _info;
+  /** The configured window size, 0 means auto-tuning. */
+  unsigned _window;
+  /** The current window size, either tuned automatically or dropped after a timeout. */
+  unsigned _currentWindow;
+  /** The transfer statistics. */
+  TransferStatistics _statistics;
+
+  /** The window size new interfaces get configured with. */
+  static unsigned _defaultWindow;
 };
 
 #endif // ANYTONEINTERFACE_HH
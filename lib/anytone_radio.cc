@@ -3,9 +3,12 @@
 #include "d868uv.hh"
 #include "config.hh"
 #include "logger.hh"
+#include "transferjournal.hh"
 
 #define RBSIZE 16
 #define WBSIZE 16
+/** Number of callsign DB blocks written at once. */
+#define CALLSIGN_CHUNK 64
 
 
 AnytoneRadio::AnytoneRadio(const QString &name, AnytoneInterface *device, QObject *parent)
@@ -52,6 +55,7 @@ AnytoneRadio::startDownload(bool blocking, const ErrorStack &err) {
 
   _task = StatusDownload;
   _errorStack = err;
+  _job.reset();
 
   if (blocking) {
     run();
@@ -77,6 +81,7 @@ AnytoneRadio::startUpload(Config *config, bool blocking, const Codeplug::Flags &
   _task = StatusUpload;
   _codeplugFlags = flags;
   _errorStack = err;
+  _job.reset();
 
   if (blocking) {
     run();
@@ -96,6 +101,12 @@ AnytoneRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const Calls
   Q_UNUSED(db);
   Q_UNUSED(blocking);
 
+  if (StatusIdle != _task)
+    return false;
+
+  // Reset the job before encoding, which may take a while. A cancel request during the encoding
+  // must not get lost.
+  _job.reset();
   _callsigns->encode(db, selection);
 
   _task = StatusUploadCallsigns;
@@ -190,8 +201,10 @@ AnytoneRadio::download() {
   }
 
   logDebug() << "Download of " << _codeplug->image(0).numElements() << " bitmaps.";
+  _dev->resetStatistics();
 
   // Download bitmaps
+  _job.beginPhase(tr("Read bitmaps"), _codeplug->memSize(), RBSIZE);
   for (int n=0; n<_codeplug->image(0).numElements(); n++) {
     unsigned addr = _codeplug->image(0).element(n).address();
     unsigned size = _codeplug->image(0).element(n).data().size();
@@ -199,6 +212,8 @@ AnytoneRadio::download() {
       errMsg(_errorStack) << "Cannot download codeplug.";
       return false;
     }
+    if (! _job.advance(size, _errorStack))
+      return false;
     emit downloadProgress(float(n*100)/_codeplug->image(0).numElements());
   }
 
@@ -218,6 +233,10 @@ AnytoneRadio::download() {
   }
 
   // Download remaining memory sections
+  qint64 remaining = 0;
+  for (int n=nstart; n<_codeplug->image(0).numElements(); n++)
+    remaining += _codeplug->image(0).element(n).data().size();
+  _job.beginPhase(tr("Read codeplug"), remaining, RBSIZE);
   for (int n=nstart; n<_codeplug->image(0).numElements(); n++) {
     unsigned addr = _codeplug->image(0).element(n).address();
     unsigned size = _codeplug->image(0).element(n).data().size();
@@ -225,9 +244,13 @@ AnytoneRadio::download() {
       errMsg(_errorStack) << "Cannot download codeplug.";
       return false;
     }
+    if (! _job.advance(size, _errorStack))
+      return false;
     emit downloadProgress(float(n*100)/_codeplug->image(0).numElements());
   }
 
+  logDebug() << "Download: " << _dev->statistics().format() << ".";
+
   return true;
 }
 
@@ -238,8 +261,11 @@ AnytoneRadio::upload() {
     return false;
   }
 
+  _dev->resetStatistics();
+
   // Download bitmaps first
-  size_t nbitmaps = _codeplug->numImages();
+  size_t nbitmaps = _codeplug->image(0).numElements();
+  _job.beginPhase(tr("Read bitmaps"), _codeplug->memSize(), RBSIZE);
   for (int n=0; n<_codeplug->image(0).numElements(); n++) {
     unsigned addr = _codeplug->image(0).element(n).address();
     unsigned size = _codeplug->image(0).element(n).data().size();
@@ -247,6 +273,8 @@ AnytoneRadio::upload() {
       errMsg(_errorStack) << "Cannot read codeplug for update.";
       return false;
     }
+    if (! _job.advance(size, _errorStack))
+      return false;
     emit uploadProgress(float(n*25)/_codeplug->image(0).numElements());
   }
 
@@ -254,7 +282,18 @@ AnytoneRadio::upload() {
   // and written back to the device more or less untouched
   _codeplug->allocateUpdated();
 
+  // The radios report neither a unit-specific ID nor a checksum of the codeplug. Hence a cached
+  // codeplug cannot be verified against the device without reading it back entirely. To this end,
+  // the memory sections are always read from the device.
+  bool delta = _codeplugFlags.updateCodePlug && _codeplugFlags.deltaUpload;
+  if (_codeplugFlags.useImageCache)
+    logInfo() << "Codeplug cache is not used: The radio cannot verify a cached codeplug.";
+
   // Download new memory sections for update
+  qint64 remaining = 0;
+  for (int n=nbitmaps; n<_codeplug->image(0).numElements(); n++)
+    remaining += _codeplug->image(0).element(n).data().size();
+  _job.beginPhase(tr("Read codeplug"), remaining, RBSIZE);
   for (int n=nbitmaps; n<_codeplug->image(0).numElements(); n++) {
     unsigned addr = _codeplug->image(0).element(n).address();
     unsigned size = _codeplug->image(0).element(n).data().size();
@@ -262,9 +301,17 @@ AnytoneRadio::upload() {
       errMsg(_errorStack) << "Cannot read codeplug for update.";
       return false;
     }
+    if (! _job.advance(size, _errorStack))
+      return false;
     emit uploadProgress(25+float(n*25)/_codeplug->image(0).numElements());
   }
 
+  // Keep a copy of the codeplug read from the device for delta uploads. The element data is
+  // implicitly shared, hence this is cheap until the encoder modifies an element.
+  DFUFile::Image original;
+  if (delta)
+    original = _codeplug->image(0);
+
   // Update binary codeplug from config
   if (! _codeplug->encode(_config, _codeplugFlags, _errorStack)) {
     errMsg(_errorStack) << "Cannot encode codeplug.";
@@ -274,20 +321,103 @@ AnytoneRadio::upload() {
   // Sort all elements before uploading
   _codeplug->image(0).sort();
 
-  // Upload all elements back to the device
+  // Last chance to cancel before the device gets modified
+  if (! _job.check(_errorStack))
+    return false;
+
+  // Upload all elements back to the device, skipped blocks count as transferred
+  _job.beginPhase(tr("Write codeplug"), _codeplug->memSize(), WBSIZE);
+  size_t totalBlocks = 0, skippedBlocks = 0;
   for (int n=0; n<_codeplug->image(0).numElements(); n++) {
     unsigned addr = _codeplug->image(0).element(n).address();
     unsigned size = _codeplug->image(0).element(n).data().size();
-    if (! _dev->write(0, addr, _codeplug->data(addr), size, _errorStack)) {
-      errMsg(_errorStack) << "Cannot write codeplug.";
-      return false;
+    if (! delta) {
+      if (! _dev->write(0, addr, _codeplug->data(addr), size, _errorStack)) {
+        errMsg(_errorStack) << "Cannot write codeplug.";
+        return false;
+      }
+    } else {
+      // Write only consecutive runs of modified blocks
+      for (unsigned offset=0; offset<size;) {
+        unsigned bsize = std::min(unsigned(WBSIZE), size-offset);
+        totalBlocks++;
+        if (! _codeplug->image(0).differs(addr+offset, bsize, original)) {
+          skippedBlocks++; offset += bsize;
+          continue;
+        }
+        unsigned start = offset; offset += bsize;
+        while ((offset < size) && _codeplug->image(0).differs(
+                 addr+offset, std::min(unsigned(WBSIZE), size-offset), original)) {
+          offset += std::min(unsigned(WBSIZE), size-offset);
+          totalBlocks++;
+        }
+        if (! _dev->write(0, addr+start, _codeplug->data(addr+start), offset-start, _errorStack)) {
+          errMsg(_errorStack) << "Cannot write codeplug.";
+          return false;
+        }
+      }
     }
+    if (! _job.advance(size, _errorStack))
+      return false;
     emit uploadProgress(50+float(n*50)/_codeplug->image(0).numElements());
   }
 
+  if (delta) {
+    logInfo() << "Delta upload skipped " << skippedBlocks << " of " << totalBlocks
+              << " unchanged blocks.";
+  }
+  logDebug() << "Upload: " << _dev->statistics().format() << ".";
+
   return true;
 }
 
+QString
+AnytoneRadio::journalKey() const {
+  AnytoneInterface::RadioVariant variant;
+  if ((nullptr == _dev) || (! _dev->getInfo(variant)))
+    return QString();
+  return QString("anytone-%1-%2-%3").arg(variant.name).arg(variant.version)
+      .arg(int(variant.bands), 2, 16, QChar('0'));
+}
+
+/** Returns the address of the n-th block of the given image or -1 if there is none. */
+static qint64
+callsignBlockAddress(const DFUFile::Image &image, size_t n) {
+  for (int i=0; i<image.numElements(); i++) {
+    size_t nb = image.element(i).data().size()/WBSIZE;
+    if (n < nb)
+      return image.element(i).address() + n*WBSIZE;
+    n -= nb;
+  }
+  return -1;
+}
+
+bool
+AnytoneRadio::verifyCallsignResume(size_t confirmed) {
+  if (0 == confirmed)
+    return true;
+
+  const DFUFile::Image &image = _callsigns->image(0);
+  ErrorStack err;
+  if (! _dev->read_start(0, 0, err)) {
+    logInfo() << "Cannot resume call-sign DB upload: " << err.format();
+    return false;
+  }
+  foreach (size_t n, QList<size_t>({0, confirmed-1})) {
+    uint8_t block[WBSIZE];
+    qint64 addr = callsignBlockAddress(image, n);
+    if ((0 > addr) || (! _dev->read(0, addr, block, WBSIZE, err))) {
+      logInfo() << "Cannot resume call-sign DB upload: Cannot read block " << n << ": "
+                << err.format();
+      return false;
+    }
+    if (0 != memcmp(block, image.data(addr), WBSIZE)) {
+      logInfo() << "Cannot resume call-sign DB upload: Device does not hold the confirmed blocks.";
+      return false;
+    }
+  }
+  return true;
+}
 
 bool
 AnytoneRadio::uploadCallsigns() {
@@ -296,21 +426,56 @@ AnytoneRadio::uploadCallsigns() {
 
   size_t totalBlocks = _callsigns->memSize()/WBSIZE;
   size_t blkWritten  = 0;
-  // Upload all elements back to the device
+
+  // Resume an interrupted upload of the same call-sign DB, the blocks are written in order
+  size_t resumeAt = 0;
+  QString key = journalKey();
+  TransferJournal journal(key.isEmpty() ? key : (key + "-callsigns"), WBSIZE);
+  if (TransferJob::Journal::Off != _job.journal()) {
+    QByteArray hash = TransferJournal::hash(_callsigns->image(0));
+    ErrorStack err;
+    if ((TransferJob::Journal::Resume == _job.journal()) && journal.load(err) &&
+        journal.matches(hash) && (journal.confirmed() <= totalBlocks) &&
+        verifyCallsignResume(journal.confirmed())) {
+      resumeAt = journal.confirmed();
+      logInfo() << "Resume call-sign DB upload at block " << resumeAt << " of " << totalBlocks
+                << ".";
+    } else {
+      if (TransferJob::Journal::Resume == _job.journal())
+        logInfo() << "Cannot resume call-sign DB upload, no matching journal found.";
+      if (! journal.begin(hash, err))
+        logWarn() << "Cannot journal call-sign DB upload: " << err.format();
+    }
+  }
+
+  _dev->resetStatistics();
+  _job.beginPhase(tr("Write call-sign DB"), (totalBlocks-resumeAt)*WBSIZE, WBSIZE);
+  // Upload all elements back to the device, several blocks at once to allow for pipelining
   for (int n=0; n<_callsigns->image(0).numElements(); n++) {
     unsigned addr = _callsigns->image(0).element(n).address();
     unsigned size = _callsigns->image(0).element(n).data().size();
     unsigned nblks = size/WBSIZE;
-    for (unsigned i=0; i<nblks; i++) {
-      if (! _dev->write(0, addr+i*WBSIZE, _callsigns->data(addr)+i*WBSIZE, WBSIZE, _errorStack)) {
+    // Skip blocks already confirmed
+    unsigned first = std::min(size_t(nblks), resumeAt - std::min(resumeAt, blkWritten));
+    blkWritten += first;
+    for (unsigned i=first; i<nblks;) {
+      unsigned m = std::min(nblks-i, unsigned(CALLSIGN_CHUNK));
+      if (! _dev->write(0, addr+i*WBSIZE, _callsigns->data(addr)+i*WBSIZE, m*WBSIZE, _errorStack)) {
         errMsg(_errorStack) << "Cannot write callsign db.";
         _task = StatusError;
         return false;
       }
-      blkWritten++;
+      i += m; blkWritten += m;
+      journal.confirm(blkWritten);
+      if (! _job.advance(m*WBSIZE, _errorStack))
+        return false;
       emit uploadProgress(float(blkWritten*100)/totalBlocks);
     }
   }
 
+  if (TransferJob::Journal::Off != _job.journal())
+    journal.remove();
+  logDebug() << "Callsign upload: " << _dev->statistics().format() << ".";
+
   return true;
 }
@@ -14,6 +14,7 @@
 #include "anytone_interface.hh"
 #include "anytone_codeplug.hh"
 
+
 /** Implements an interface to Anytone radios.
  *
  * The transfer of the codeplug to the device is performed in 4 steps.
@@ -70,6 +71,14 @@ private:
    * This method block until the upload is complete. */
   virtual bool uploadCallsigns();
 
+  /** Returns the key identifying the connected radio model within the @c TransferJournal. */
+  QString journalKey() const;
+  /** Checks, whether the device holds the first @c confirmed blocks of the call-sign DB. The
+   * radios do not expose a unit-specific ID, hence a journal may also stem from another radio of
+   * the same model. To this end, the first and the last confirmed blocks are read back and
+   * compared to the call-sign DB. */
+  bool verifyCallsignResume(size_t confirmed);
+
 protected:
   /** The device identifier. */
   QString _name;
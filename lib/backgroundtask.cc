@@ -0,0 +1,16 @@
+#include "backgroundtask.hh"
+
+BackgroundTask::BackgroundTask(const std::function<void()> &task, QObject *parent)
+  : QThread(parent), _task(task)
+{
+  // pass...
+}
+
+BackgroundTask::~BackgroundTask() {
+  wait();
+}
+
+void
+BackgroundTask::run() {
+  _task();
+}
@@ -0,0 +1,33 @@
+#ifndef BACKGROUNDTASK_HH
+#define BACKGROUNDTASK_HH
+
+#include <QThread>
+#include <functional>
+
+/** Runs a single function on a separate thread.
+ *
+ * This is used to perform expensive operations like parsing large databases without blocking the
+ * GUI thread. The function must not touch any objects living in other threads. Instead, the
+ * results should be collected and applied once the @c finished signal of the thread got
+ * received. The owner must call @c wait before the task gets destroyed.
+ *
+ * @ingroup util */
+class BackgroundTask: public QThread
+{
+  Q_OBJECT
+
+public:
+  /** Constructs the task for the given function. Use @c start to run it. */
+  explicit BackgroundTask(const std::function<void()> &task, QObject *parent=nullptr);
+  /** Destructor, waits for the task to finish. */
+  virtual ~BackgroundTask();
+
+protected:
+  void run();
+
+protected:
+  /** The function to run. */
+  std::function<void()> _task;
+};
+
+#endif // BACKGROUNDTASK_HH
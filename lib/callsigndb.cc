@@ -5,13 +5,13 @@
  * Implementation of CallsignDB::Selection
  * ********************************************************************************************* */
 CallsignDB::Selection::Selection(int64_t count)
-  : _count(count)
+  : _count(count), _prefixes()
 {
   // pass...
 }
 
 CallsignDB::Selection::Selection(const Selection &other)
-  : _count(other._count)
+  : _count(other._count), _prefixes(other._prefixes)
 {
   // pass...
 }
@@ -38,6 +38,16 @@ CallsignDB::Selection::clearCountLimit() {
   _count = -1;
 }
 
+const QSet<unsigned> &
+CallsignDB::Selection::prefixes() const {
+  return _prefixes;
+}
+
+void
+CallsignDB::Selection::setPrefixes(const QSet<unsigned> &prefixes) {
+  _prefixes = prefixes;
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of CallsignDB
@@ -2,6 +2,7 @@
 #define CALLSIGNDB_HH
 
 #include "dfufile.hh"
+#include <QSet>
 
 // Forward decl.
 class UserDatabase;
@@ -33,10 +34,18 @@ public:
     /** Clears the count limit. */
     void clearCountLimit();
 
+    /** Returns the DMR IDs (or prefixes), the selected callsigns should be closest to. If empty,
+     * the callsigns are selected in ascending order of their IDs. */
+    const QSet<unsigned> &prefixes() const;
+    /** Sets the DMR IDs (or prefixes), the selected callsigns should be closest to. */
+    void setPrefixes(const QSet<unsigned> &prefixes);
+
   protected:
     /** Specifies the maximum amount of callsigns to add. If negative, the device limit should be
      * used. */
     int64_t _count;
+    /** The DMR IDs, the selected callsigns should be closest to. */
+    QSet<unsigned> _prefixes;
   };
 
 protected:
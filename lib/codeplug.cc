@@ -3,13 +3,17 @@
 #include <QtEndian>
 #include "logger.hh"
 #include "roamingchannel.hh"
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
 
 
 /* ********************************************************************************************* *
  * Implementation of CodePlug::Flags
  * ********************************************************************************************* */
 Codeplug::Flags::Flags()
-  : updateCodePlug(true), autoEnableGPS(false), autoEnableRoaming(false)
+  : updateCodePlug(true), autoEnableGPS(false), autoEnableRoaming(false), deltaUpload(false),
+    useImageCache(false), parallelEncode(false)
 {
   // pass...
 }
@@ -580,11 +584,40 @@ Codeplug::Element::writeUnicode(unsigned offset, const QString &txt, unsigned ma
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of CodePlug::Context::Table
+ * ********************************************************************************************* */
+/** Indices below this limit are stored in the dense index->object vector. */
+#define DENSE_INDEX_LIMIT 0x4000
+
+ConfigItem *
+Codeplug::Context::Table::object(unsigned idx) const {
+  if (idx < DENSE_INDEX_LIMIT)
+    return (idx < unsigned(objects.size())) ? objects[idx] : nullptr;
+  return sparseObjects.value(idx, nullptr);
+}
+
+void
+Codeplug::Context::Table::add(ConfigItem *obj, unsigned idx) {
+  if (! indices.contains(obj))
+    indices.insert(obj, idx);
+  if (idx >= DENSE_INDEX_LIMIT) {
+    if (! sparseObjects.contains(idx))
+      sparseObjects.insert(idx, obj);
+    return;
+  }
+  if (idx >= unsigned(objects.size()))
+    objects.resize(idx+1);
+  if (nullptr == objects[idx])
+    objects[idx] = obj;
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of CodePlug::Context
  * ********************************************************************************************* */
 Codeplug::Context::Context(Config *config)
-  : _config(config), _tables()
+  : _config(config), _tables(), _types()
 {
   // Add tables for common elements
   addTable(&DMRRadioID::staticMetaObject);
@@ -605,55 +638,78 @@ Codeplug::Context::config() const {
   return _config;
 }
 
+int
+Codeplug::Context::resolve(const QMetaObject *type) const {
+  // Walk up the class hierarchy until a table or a cached type is found
+  for (; nullptr != type; type = type->superClass()) {
+    auto table = _types.constFind(type);
+    if (_types.constEnd() != table)
+      return *table;
+  }
+  return -1;
+}
+
+int
+Codeplug::Context::resolveAndCache(const QMetaObject *type) {
+  int table = resolve(type);
+  if ((0 <= table) && (! _types.contains(type)))
+    _types.insert(type, table);
+  return table;
+}
+
 bool
 Codeplug::Context::hasTable(const QMetaObject *obj) const {
-  // Find a matching table
-  if (_tables.contains(obj->className()))
-    return true;
-  else if (obj->superClass())
-    return hasTable(obj->superClass());
-  return false;
+  return 0 <= resolve(obj);
 }
 
 Codeplug::Context::Table &
 Codeplug::Context::getTable(const QMetaObject *obj) {
-  if (_tables.contains(obj->className()))
-    return _tables[obj->className()];
-  return getTable(obj->superClass());
+  return _tables[resolveAndCache(obj)];
+}
+
+const Codeplug::Context::Table &
+Codeplug::Context::getTable(const QMetaObject *obj) const {
+  static const Table empty;
+  int table = resolve(obj);
+  if (0 > table)
+    return empty;
+  return _tables[table];
 }
 
 bool
 Codeplug::Context::addTable(const QMetaObject *obj) {
   if (hasTable(obj))
     return false;
-  _tables.insert(obj->className(), Table());
+  _types.insert(obj, _tables.size());
+  _tables.append(Table());
   return true;
 }
 
 ConfigItem *
 Codeplug::Context::obj(const QMetaObject *elementType, unsigned idx) {
-  if (! hasTable(elementType))
+  int table = resolve(elementType);
+  if (0 > table)
     return nullptr;
-  return getTable(elementType).objects.value(idx, nullptr);
+  return _tables.at(table).object(idx);
 }
 
 int
 Codeplug::Context::index(ConfigItem *obj) {
   if (nullptr == obj)
     return -1;
-  if (! hasTable(obj->metaObject()))
+  int table = resolve(obj->metaObject());
+  if (0 > table)
     return -1;
-  return getTable(obj->metaObject()).indices.value(obj, -1);
+  return _tables.at(table).indices.value(obj, -1);
 }
 
 bool
 Codeplug::Context::add(ConfigItem *obj, unsigned idx) {
-  if (!hasTable(obj->metaObject()))
+  // Caches the table for the type of the object, later lookups of that type are a single hash hit
+  int table = resolveAndCache(obj->metaObject());
+  if (0 > table)
     return false;
-  if (! getTable(obj->metaObject()).indices.contains(obj))
-    getTable(obj->metaObject()).indices.insert(obj, idx);
-  if (! getTable(obj->metaObject()).objects.contains(idx))
-    getTable(obj->metaObject()).objects.insert(idx, obj);
+  _tables[table].add(obj, idx);
   return true;
 }
 
@@ -670,3 +726,68 @@ Codeplug::Codeplug(QObject *parent)
 Codeplug::~Codeplug() {
 	// pass...
 }
+
+/** Wraps a single encoding step to be run on the thread pool. */
+class EncodingStepRunnable: public QRunnable
+{
+public:
+  /** Constructor. */
+  EncodingStepRunnable(const Codeplug::EncodingStep &step, bool &result, const ErrorStack &err,
+                       QSemaphore &done)
+    : QRunnable(), _step(step), _result(result), _err(err), _done(done)
+  {
+    setAutoDelete(true);
+  }
+
+  void run() {
+    _result = _step(_err);
+    _done.release();
+  }
+
+protected:
+  /** The step to execute. */
+  Codeplug::EncodingStep _step;
+  /** Reference to the result. */
+  bool &_result;
+  /** The error stack of this step. */
+  ErrorStack _err;
+  /** Gets released once the step is done. */
+  QSemaphore &_done;
+};
+
+bool
+Codeplug::runEncodingSteps(const QVector<EncodingStep> &steps, bool parallel, const ErrorStack &err) {
+  if ((! parallel) || (2 > steps.size())) {
+    foreach (const EncodingStep &step, steps) {
+      if (! step(err))
+        return false;
+    }
+    return true;
+  }
+
+  // Detach all shared data first. Otherwise, the steps would copy the shared element data
+  // concurrently when obtaining a pointer into the codeplug.
+  detach();
+  // Also create the lazily constructed singletons, the steps may refer to.
+  SelectedChannel::get(); DefaultRadioID::get(); DefaultRoamingZone::get();
+
+  // Every step gets its own error stack and result.
+  QVector<ErrorStack> errors(steps.size());
+  QVector<bool> results(steps.size(), false);
+  // Wait for these steps only, the global pool may also run the steps of other codeplugs (e.g.,
+  // when writing to several radios at once).
+  QSemaphore done;
+  QThreadPool *pool = QThreadPool::globalInstance();
+  for (int i=0; i<steps.size(); i++)
+    pool->start(new EncodingStepRunnable(steps[i], results[i], errors[i], done));
+  done.acquire(steps.size());
+
+  bool success = true;
+  for (int i=0; i<steps.size(); i++) {
+    if (results[i])
+      continue;
+    err.take(errors[i]);
+    success = false;
+  }
+  return success;
+}
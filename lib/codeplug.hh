@@ -5,7 +5,9 @@
 #include "dfufile.hh"
 #include "userdatabase.hh"
 #include <QHash>
+#include <QVector>
 #include "config.hh"
+#include <functional>
 
 //class Config;
 class ConfigItem;
@@ -19,6 +21,10 @@ class Codeplug: public DFUFile
   Q_OBJECT
 
 public:
+  /** A single step of the encoding, e.g., encoding all channels. Errors are reported to the
+   * passed error stack. */
+  typedef std::function<bool(const ErrorStack &err)> EncodingStep;
+
   /** Certain flags passed to CodePlug::encode to control the transfer and encoding of the
    * codeplug. */
   class Flags {
@@ -34,6 +40,19 @@ public:
     /** If @c true enables automatic roaming when there is a roaming zone defined that is used by any
      * channel. This may cause automatic transmissions, hence the default is @c false. */
     bool autoEnableRoaming;
+    /** If @c true, only those blocks of the codeplug get written to the device, that differ from
+     * the codeplug read back from the device before encoding. This requires @c updateCodePlug to
+     * be set, as there is no reference to compare against otherwise. Default @c false. */
+    bool deltaUpload;
+    /** If @c true, the codeplug last written to the device is taken from a local cache instead of
+     * reading it back from the device, provided the radio can verify that the cached codeplug
+     * matches the device entirely. None of the supported radios can do that yet, hence the flag
+     * is currently ignored. Default @c false. */
+    bool useImageCache;
+    /** If @c true, independent element tables (e.g., channels, contacts, zones) get encoded
+     * concurrently on the global thread pool. The resulting binary codeplug is identical to the
+     * one obtained by the serial encoding. Default @c false. */
+    bool parallelEncode;
 
     /** Default constructor, enables code-plug update and disables automatic GPS/APRS and roaming. */
     Flags();
@@ -228,35 +247,66 @@ public:
 
     /** Returns the number of elements for the specified type. */
     template <class T>
-    unsigned int count() {
+    unsigned int count() const {
       return getTable(&T::staticMetaObject).indices.size();
     }
 
   protected:
-    /** Internal used table type to associate objects and indices. */
+    /** Internal used table type to associate objects and indices. Small indices are stored in a
+     * dense vector, large ones (e.g., DMR IDs used as index) in a hash. */
     class Table {
     public:
-      /** The index->object map. */
-      QHash<unsigned, ConfigItem *> objects;
+      /** Returns the object associated with the given index or @c nullptr. */
+      ConfigItem *object(unsigned idx) const;
+      /** Associates the given object and index, keeps any previous association of either. */
+      void add(ConfigItem *obj, unsigned idx);
+
+    public:
+      /** The index->object map for small indices. */
+      QVector<ConfigItem *> objects;
+      /** The index->object map for large indices. */
+      QHash<unsigned, ConfigItem *> sparseObjects;
       /** The object->index map. */
       QHash<ConfigItem *, unsigned> indices;
     };
 
   protected:
+    /** Returns the index of the table for the given type or -1 if there is none. Derived types
+     * are resolved by their base classes, unless already cached. This lookup does not modify the
+     * context and may thus be used concurrently. */
+    int resolve(const QMetaObject *type) const;
+    /** Like @c resolve but also caches the resolved table for the given type. */
+    int resolveAndCache(const QMetaObject *type);
     /** Returns a reference to the table for the given type. */
     Table &getTable(const QMetaObject *obj);
+    /** Returns a reference to the table for the given type. This lookup does not modify the
+     * context and may thus be used concurrently. */
+    const Table &getTable(const QMetaObject *obj) const;
 
   protected:
     /** A weak reference to the config object. */
     Config *_config;
     /** Table of tables. */
-    QHash<QString, Table> _tables;
+    QVector<Table> _tables;
+    /** Maps types to the index of their table. Besides the types tables were added for, it also
+     * caches the derived types seen by @c add. */
+    QHash<const QMetaObject *, int> _types;
   };
 
 protected:
   /** Hidden default constructor. */
   explicit Codeplug(QObject *parent=nullptr);
 
+  /** Runs the given encoding steps.
+   *
+   * If @c parallel is @c false, the steps are executed in order and the first failing step stops
+   * the execution. Otherwise, all steps are executed concurrently on the global thread pool. The
+   * steps must then neither modify the context nor touch the same memory within the codeplug.
+   * Errors are collected per step and reported in the order of the steps, such that the outcome
+   * does not depend on the scheduling. */
+  bool runEncodingSteps(const QVector<EncodingStep> &steps, bool parallel,
+                        const ErrorStack &err=ErrorStack());
+
 public:
   /** Destructor. */
   virtual ~Codeplug();
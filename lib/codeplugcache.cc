@@ -0,0 +1,96 @@
+#include "codeplugcache.hh"
+#include <QStandardPaths>
+#include <QFile>
+#include <QDir>
+#include <QRegExp>
+#include "logger.hh"
+
+
+/* ********************************************************************************************* *
+ * Implementation of CodeplugCache
+ * ********************************************************************************************* */
+CodeplugCache::CodeplugCache(const QString &key)
+  : _key(key)
+{
+  // Keep key usable as a file name
+  _key.replace(QRegExp("[^A-Za-z0-9_\\-\\.]"), "_");
+}
+
+const QString &
+CodeplugCache::key() const {
+  return _key;
+}
+
+QString
+CodeplugCache::path() {
+  return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/codeplugs";
+}
+
+QString
+CodeplugCache::filename() const {
+  return path() + "/" + _key + ".dfu";
+}
+
+bool
+CodeplugCache::exists() const {
+  return (! _key.isEmpty()) && QFile::exists(filename());
+}
+
+bool
+CodeplugCache::load(DFUFile &file, const ErrorStack &err) const {
+  if (! exists()) {
+    errMsg(err) << "No cached codeplug for radio '" << _key << "'.";
+    return false;
+  }
+  if (! file.read(filename(), err)) {
+    errMsg(err) << "Cannot load cached codeplug for radio '" << _key << "'.";
+    return false;
+  }
+  logDebug() << "Loaded cached codeplug for '" << _key << "' from '" << filename() << "'.";
+  return true;
+}
+
+bool
+CodeplugCache::store(DFUFile &file, const ErrorStack &err) const {
+  if (_key.isEmpty()) {
+    errMsg(err) << "Cannot cache codeplug: No radio key.";
+    return false;
+  }
+
+  QDir directory;
+  if ((! directory.exists(path())) && (! directory.mkpath(path()))) {
+    errMsg(err) << "Cannot cache codeplug: Cannot create path '" << path() << "'.";
+    return false;
+  }
+
+  if (! file.write(filename(), err)) {
+    errMsg(err) << "Cannot cache codeplug for radio '" << _key << "'.";
+    // Do not keep a partially written image
+    remove();
+    return false;
+  }
+
+  logDebug() << "Cached codeplug for '" << _key << "' at '" << filename() << "'.";
+  return true;
+}
+
+bool
+CodeplugCache::remove() const {
+  if (! exists())
+    return true;
+  return QFile::remove(filename());
+}
+
+bool
+CodeplugCache::copy(DFUFile::Image &dest, const DFUFile::Image &source, uint32_t addr,
+                    uint32_t size, uint32_t blocksize)
+{
+  for (uint32_t offset=0; offset<size; offset+=blocksize) {
+    uint32_t n = std::min(blocksize, size-offset);
+    if ((! dest.isAllocated(addr+offset)) || (! source.isAllocated(addr+offset)) ||
+        (! dest.isAllocated(addr+offset+n-1)) || (! source.isAllocated(addr+offset+n-1)))
+      return false;
+    memcpy(dest.data(addr+offset), source.data(addr+offset), n);
+  }
+  return true;
+}
@@ -0,0 +1,57 @@
+#ifndef CODEPLUGCACHE_HH
+#define CODEPLUGCACHE_HH
+
+#include <QString>
+#include "dfufile.hh"
+#include "errorstack.hh"
+
+/** Persistent on-disk cache of the binary codeplugs last written to radios.
+ *
+ * When a codeplug gets updated, the current codeplug is read from the device first. For radios,
+ * that were last programmed by qdmr/dmrconf, this read-back is mostly redundant. This class stores
+ * the last codeplug image written to a radio, identified by a key. The key must identify the
+ * particular radio (e.g., by its serial number), not just the model. The radio implementation is
+ * responsible to verify (e.g., by a checksum reported by the device) that the cached image matches
+ * the codeplug within the device entirely before using it as the base for the update.
+ *
+ * The images are stored as DFU files within the application data directory.
+ *
+ * @ingroup util */
+class CodeplugCache
+{
+public:
+  /** Constructs a cache for the radio identified by the given key. */
+  explicit CodeplugCache(const QString &key);
+
+  /** Returns the key identifying the radio. */
+  const QString &key() const;
+  /** Returns the file name of the cached image. */
+  QString filename() const;
+
+  /** Returns @c true if there is a cached image for the radio. */
+  bool exists() const;
+  /** Loads the cached image into the given DFU file.
+   * @returns @c false if there is no cached image or the image cannot be read. */
+  bool load(DFUFile &file, const ErrorStack &err=ErrorStack()) const;
+  /** Stores the given codeplug image as the last written one. */
+  bool store(DFUFile &file, const ErrorStack &err=ErrorStack()) const;
+  /** Removes the cached image, e.g., once it became invalid. */
+  bool remove() const;
+
+  /** Copies the memory region at @c addr of size @c size from the @c source image into the
+   * @c dest image. The region is copied in blocks of size @c blocksize. Each block must be
+   * allocated in both images.
+   * @returns @c false if any block is not allocated in one of the images. */
+  static bool copy(DFUFile::Image &dest, const DFUFile::Image &source, uint32_t addr,
+                   uint32_t size, uint32_t blocksize);
+
+public:
+  /** Returns the directory, the cached images are stored in. */
+  static QString path();
+
+protected:
+  /** The key identifying the radio. */
+  QString _key;
+};
+
+#endif // CODEPLUGCACHE_HH
@@ -80,11 +80,28 @@ Config::copy(const ConfigItem &other) {
 
 ConfigItem *
 Config::clone() const {
+  // Copying the lists would only copy the pointers to the elements of this config. Hence, the
+  // clone is created from the YAML representation, which re-links all references to the elements
+  // of the clone. Labeling and serialization do not modify the config.
+  Config *self = const_cast<Config *>(this);
+  ErrorStack err;
+  ConfigItem::Context labels;
+  YAML::Node doc;
+  if (self->label(labels, err))
+    doc = self->serialize(labels, err);
+  if (doc.IsNull()) {
+    logError() << "Cannot clone config: " << err.format();
+    return nullptr;
+  }
+
   Config *conf = new Config();
-  if (! conf->copy(*this)) {
+  ConfigItem::Context context;
+  if (! (conf->parse(doc, context, err) && conf->link(doc, context, err))) {
+    logError() << "Cannot clone config: " << err.format();
     conf->deleteLater();
     return nullptr;
   }
+  conf->setModified(false);
   return conf;
 }
 
@@ -100,6 +100,10 @@ public:
   explicit Config(QObject *parent = nullptr);
 
   bool copy(const ConfigItem &other);
+  /** Creates an independent deep copy of the configuration. Unlike @c copy, which only copies
+   * the references to the elements, all references within the clone point to the elements of
+   * the clone. Hence the clone can be used (e.g., encoded) independently of this configuration.
+   * @returns @c nullptr if the configuration cannot be cloned. */
   ConfigItem *clone() const;
 
   /** Returns @c true if the config was modified, @see modified. */
@@ -19,10 +19,7 @@ ConfigLabelingVisitor::processItem(ConfigItem *item, const ErrorStack &err)
       return Visitor::processItem(item, err);
 
     // Find unused ID
-    unsigned n=1;
-    QString id=QString("%1%2").arg(prefix).arg(n);
-    while (_context.contains(id))
-      id=QString("%1%2").arg(prefix).arg(++n);
+    QString id = _context.newId(prefix);
 
     // Add to context
     if (! _context.add(id, obj)) {
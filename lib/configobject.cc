@@ -36,7 +36,7 @@ QHash<QString, QHash<ConfigObject *, QString>> ConfigObject::Context::_tagNames
     QHash<QString, QHash<ConfigObject *, QString>>();
 
 ConfigItem::Context::Context()
-  : _version(), _objects(), _ids()
+  : _version(), _objects(), _ids(), _nextId()
 {
   // pass...
 }
@@ -83,6 +83,18 @@ ConfigItem::Context::add(const QString &id, ConfigObject *obj) {
   return true;
 }
 
+QString
+ConfigItem::Context::newId(const QString &prefix) {
+  // IDs are never removed from the context, hence all numbers below the counter remain taken.
+  unsigned &n = _nextId[prefix];
+  if (0 == n)
+    n = 1;
+  QString id = QString("%1%2").arg(prefix).arg(n);
+  while (contains(id))
+    id = QString("%1%2").arg(prefix).arg(++n);
+  return id;
+}
+
 bool
 ConfigItem::Context::hasTag(const QString &className, const QString &property, const QString &tag) {
   QString qname = className+"::"+property;
@@ -996,6 +1008,10 @@ ConfigObject::ConfigObject(const QString &name, QObject *parent)
   // pass...
 }
 
+ConfigObject::~ConfigObject() {
+  ConfigObjectReference::clearReferencesTo(this);
+}
+
 const QString &
 ConfigObject::name() const {
   return _name;
@@ -1016,12 +1032,7 @@ ConfigObject::idPrefix() const {
 
 bool
 ConfigObject::label(ConfigObject::Context &context, const ErrorStack &err) {
-  unsigned n=1;
-  QString prefix = this->idPrefix();
-  QString id=QString("%1%2").arg(prefix).arg(n);
-  while (context.contains(id)) {
-    id=QString("%1%2").arg(prefix).arg(++n);
-  }
+  QString id = context.newId(this->idPrefix());
 
   if (! context.add(id, this)) {
     if (context.contains(this))
@@ -1088,13 +1099,13 @@ ConfigExtension::ConfigExtension(QObject *parent)
  * Implementation of AbstractConfigObjectList
  * ********************************************************************************************* */
 AbstractConfigObjectList::AbstractConfigObjectList(const QMetaObject &elementType, QObject *parent)
-  : QObject(parent), _elementTypes(), _items()
+  : QObject(parent), _elementTypes(), _items(), _indices()
 {
   _elementTypes.append(elementType);
 }
 
 AbstractConfigObjectList::AbstractConfigObjectList(const std::initializer_list<QMetaObject> &elementTypes, QObject *parent)
-  : QObject(parent), _elementTypes(elementTypes), _items()
+  : QObject(parent), _elementTypes(elementTypes), _items(), _indices()
 {
   // pass...
 }
@@ -1115,13 +1126,13 @@ AbstractConfigObjectList::count() const {
 
 int
 AbstractConfigObjectList::indexOf(ConfigObject *obj) const {
-  return _items.indexOf(obj);
+  return _indices.value(obj, -1);
 }
 
 void
 AbstractConfigObjectList::clear() {
   for (int i=(count()-1); i>=0; i--) {
-    _items.pop_back();
+    _indices.remove(_items.takeLast());
     emit elementRemoved(i);
   }
 }
@@ -1146,7 +1157,7 @@ AbstractConfigObjectList::findItemsOfTypes(const QStringList &typeNames, QSet<Co
 
 bool
 AbstractConfigObjectList::has(ConfigObject *obj) const {
-  return 0 <= indexOf(obj);
+  return _indices.contains(obj);
 }
 
 ConfigObject *
@@ -1159,7 +1170,7 @@ int AbstractConfigObjectList::add(ConfigObject *obj, int row) {
   if (nullptr == obj)
     return -1;
   // If already in list -> ignore
-  if (0 <= indexOf(obj))
+  if (_indices.contains(obj))
     return -1;
   if (-1 == row)
     row = _items.size();
@@ -1177,6 +1188,7 @@ int AbstractConfigObjectList::add(ConfigObject *obj, int row) {
     return -1;
   }
   _items.insert(row, obj);
+  reindex(row);
   // Otherwise connect to object
   connect(obj, SIGNAL(destroyed(QObject*)), this, SLOT(onElementDeleted(QObject*)));
   connect(obj, SIGNAL(modified(ConfigItem*)), this, SLOT(onElementModified(ConfigItem*)));
@@ -1193,6 +1205,8 @@ AbstractConfigObjectList::take(ConfigObject *obj) {
   if (0 > idx)
     return false;
   _items.remove(idx, 1);
+  _indices.remove(obj);
+  reindex(idx);
   emit elementRemoved(idx);
   // Otherwise disconnect from
   disconnect(obj, nullptr, this, nullptr);
@@ -1209,6 +1223,8 @@ AbstractConfigObjectList::moveUp(int row) {
   if ((row <= 0) || (row>=count()))
     return false;
   std::swap(_items[row-1], _items[row]);
+  _indices[_items[row-1]] = row-1;
+  _indices[_items[row]] = row;
   return true;
 }
 
@@ -1218,6 +1234,7 @@ AbstractConfigObjectList::moveUp(int first, int last) {
     return false;
   for (int row=first; row<=last; row++)
     std::swap(_items[row-1], _items[row]);
+  reindex(first-1, last);
   return true;
 }
 
@@ -1226,6 +1243,8 @@ AbstractConfigObjectList::moveDown(int row) {
   if ((row >= (count()-1)) || (0 > row))
     return false;
   std::swap(_items[row+1], _items[row]);
+  _indices[_items[row]] = row;
+  _indices[_items[row+1]] = row+1;
   return true;
 }
 
@@ -1235,6 +1254,7 @@ AbstractConfigObjectList::moveDown(int first, int last) {
     return false;
   for (int row=last; row>=first; row--)
     std::swap(_items[row+1], _items[row]);
+  reindex(first, last+1);
   return true;
 }
 
@@ -1255,7 +1275,7 @@ AbstractConfigObjectList::classNames() const {
 void
 AbstractConfigObjectList::onElementModified(ConfigItem *obj) {
   int idx = indexOf(obj->as<ConfigObject>());
-  if (0 >= idx)
+  if (0 <= idx)
     emit elementModified(idx);
 }
 
@@ -1266,10 +1286,20 @@ AbstractConfigObjectList::onElementDeleted(QObject *obj) {
   int idx = indexOf(reinterpret_cast<ConfigObject *>(obj));
   if (0 <= idx) {
     _items.remove(idx);
+    _indices.remove(reinterpret_cast<ConfigObject *>(obj));
+    reindex(idx);
     emit elementRemoved(idx);
   }
 }
 
+void
+AbstractConfigObjectList::reindex(int from, int to) {
+  if ((0 > to) || (to >= _items.size()))
+    to = _items.size()-1;
+  for (int i=from; i<=to; i++)
+    _indices[_items[i]] = i;
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of ConfigObjectList
@@ -69,6 +69,10 @@ public:
 
     /** Associates the given object with the given ID. */
     virtual bool add(const QString &id, ConfigObject *);
+    /** Returns the first unused ID of the form prefix + number, with number starting at 1.
+     * A counter per prefix skips all numbers already known to be taken, such that labeling
+     * @c n objects of the same kind takes linear time. */
+    virtual QString newId(const QString &prefix);
 
     /** Returns @c true if the property of the class has the specified tag associated. */
     static bool hasTag(const QString &className, const QString &property, const QString &tag);
@@ -88,6 +92,8 @@ public:
     QHash<QString, ConfigObject *> _objects;
     /** OBJ->ID look-up table. */
     QHash<ConfigObject*, QString> _ids;
+    /** Maps ID prefixes to the next number to probe. */
+    QHash<QString, unsigned> _nextId;
     /** Maps tags to singleton objects. */
     static QHash<QString, QHash<QString, ConfigObject *>> _tagObjects;
     /** Maps singleton objects to tags. */
@@ -216,6 +222,9 @@ protected:
   ConfigObject(const QString &name, QObject *parent = nullptr);
 
 public:
+  /** Destructor, clears all references to this object. */
+  virtual ~ConfigObject();
+
   /** Returns the name of the object. */
   virtual const QString &name() const;
   /** Sets the name of the object. */
@@ -325,11 +334,19 @@ private slots:
   /** Internal used callback to handle deleted elements. */
   void onElementDeleted(QObject *obj);
 
+protected:
+  /** Updates the index of all items within [@c from, @c to]. If @c to is negative, all items
+   * starting at @c from are updated. */
+  void reindex(int from, int to=-1);
+
 protected:
   /** Holds the static QMetaObject of the element type. */
   QList<QMetaObject> _elementTypes;
   /** Holds the list items. */
   QVector<ConfigObject *> _items;
+  /** Maps each item to its index within @c _items. This turns membership tests and index
+   * look-ups into constant-time operations. */
+  QHash<ConfigObject *, int> _indices;
 };
 
 
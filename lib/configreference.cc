@@ -9,15 +9,133 @@
 #include "roamingzone.hh"
 #include "zone.hh"
 #include "encryptionextension.hh"
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QHash>
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigObjectReference::ElementTypes
+ * ********************************************************************************************* */
+/** Immutable list of the types a reference may point to. The descriptors are interned, such that
+ * all references allowing the same types share a single instance. The descriptors are looked up
+ * by their meta-objects and never freed, as there are only a few combinations of types. */
+class ConfigObjectReference::ElementTypes
+{
+protected:
+  /** Hidden constructor, use @c get or @c extend. */
+  ElementTypes(const QList<const QMetaObject *> &types);
+
+public:
+  /** Returns @c true if instances of the given type may be referenced. */
+  bool accepts(const QMetaObject *type) const;
+  /** Returns the shared descriptor allowing the types of this one and the given type. */
+  const ElementTypes *extend(const QMetaObject *type) const;
+
+  /** Returns the shared descriptor for the given type. */
+  static const ElementTypes *get(const QMetaObject *type);
+
+protected:
+  /** Returns the lock protecting the descriptors. References are created in several threads
+   * (e.g., while decoding a codeplug). */
+  static QReadWriteLock &lock();
+
+public:
+  /** The possible element types. */
+  const QList<const QMetaObject *> types;
+  /** The class names of the possible element types. */
+  QStringList names;
+
+protected:
+  /** The descriptors extending this one by a single type. */
+  mutable QHash<const QMetaObject *, const ElementTypes *> _extensions;
+};
+
+ConfigObjectReference::ElementTypes::ElementTypes(const QList<const QMetaObject *> &types)
+  : types(types), names(), _extensions()
+{
+  foreach (const QMetaObject *type, types)
+    names.append(type->className());
+}
+
+bool
+ConfigObjectReference::ElementTypes::accepts(const QMetaObject *type) const {
+  for (; nullptr != type; type = type->superClass()) {
+    if (types.contains(type))
+      return true;
+  }
+  return false;
+}
+
+QReadWriteLock &
+ConfigObjectReference::ElementTypes::lock() {
+  static QReadWriteLock *lock = new QReadWriteLock();
+  return *lock;
+}
+
+const ConfigObjectReference::ElementTypes *
+ConfigObjectReference::ElementTypes::get(const QMetaObject *type) {
+  static QHash<const QMetaObject *, const ElementTypes *> *descriptors =
+      new QHash<const QMetaObject *, const ElementTypes *>();
+
+  {
+    QReadLocker locker(&lock());
+    if (const ElementTypes *descriptor = descriptors->value(type, nullptr))
+      return descriptor;
+  }
+
+  QWriteLocker locker(&lock());
+  const ElementTypes *&descriptor = (*descriptors)[type];
+  if (nullptr == descriptor)
+    descriptor = new ElementTypes({type});
+  return descriptor;
+}
+
+const ConfigObjectReference::ElementTypes *
+ConfigObjectReference::ElementTypes::extend(const QMetaObject *type) const {
+  {
+    QReadLocker locker(&lock());
+    if (const ElementTypes *descriptor = _extensions.value(type, nullptr))
+      return descriptor;
+  }
+
+  QWriteLocker locker(&lock());
+  const ElementTypes *&descriptor = _extensions[type];
+  if (nullptr == descriptor)
+    descriptor = new ElementTypes(types + QList<const QMetaObject *>{type});
+  return descriptor;
+}
 
 
 /* ********************************************************************************************* *
  * Implementation of ConfigObjectReference
  * ********************************************************************************************* */
+/** The reverse index of all references. Maps config objects to the references pointing to them.
+ * The index is never freed, as objects may still be destroyed during the static destruction. */
+class ReferenceIndex
+{
+public:
+  /** Protects the index, references may be set from several threads. */
+  QMutex mutex;
+  /** Maps objects to the references pointing to them. */
+  QHash<ConfigObject *, QSet<ConfigObjectReference *>> references;
+
+public:
+  /** Returns the index. */
+  static ReferenceIndex &get() {
+    static ReferenceIndex *index = new ReferenceIndex();
+    return *index;
+  }
+};
+
 ConfigObjectReference::ConfigObjectReference(const QMetaObject &elementType, QObject *parent)
-  : QObject(parent), _elementTypes(), _object(nullptr)
+  : QObject(parent), _elementTypes(ElementTypes::get(&elementType)), _object(nullptr)
 {
-  _elementTypes.append(elementType.className());
+  // pass...
+}
+
+ConfigObjectReference::~ConfigObjectReference() {
+  track(nullptr);
 }
 
 bool
@@ -27,41 +145,27 @@ ConfigObjectReference::isNull() const {
 
 void
 ConfigObjectReference::clear() {
-  if (_object) {
-    disconnect(_object, SIGNAL(destroyed(QObject*)), this, SLOT(onReferenceDeleted(QObject*)));
-    emit modified();
-  }
-  _object = nullptr;
+  if (nullptr == _object)
+    return;
+  track(nullptr);
+  emit modified();
 }
 
 bool
 ConfigObjectReference::set(ConfigObject *object) {
-  if (_object)
-    disconnect(_object, SIGNAL(destroyed(QObject*)), this, SLOT(onReferenceDeleted(QObject*)));
-
   if (nullptr == object) {
-    _object = nullptr;
+    track(nullptr);
     return true;
   }
 
   // Check type
-  bool typeCheck = false;
-  foreach (const QString &cname, _elementTypes) {
-    if (object->inherits(cname.toLatin1().constData())) {
-      typeCheck = true;
-      break;
-    }
-  }
-  if (! typeCheck) {
+  if (! _elementTypes->accepts(object->metaObject())) {
     logError() << "Cannot reference element of type " << object->metaObject()->className()
-               << ", expected instance of " << _elementTypes.join(", ");
+               << ", expected instance of " << _elementTypes->names.join(", ");
     return false;
   }
 
-  _object = object;
-  if (_object)
-    connect(_object, SIGNAL(destroyed(QObject*)), this, SLOT(onReferenceDeleted(QObject*)));
-
+  track(object);
   emit modified();
   return true;
 }
@@ -87,24 +191,48 @@ ConfigObjectReference::compare(const ConfigObjectReference &other) const {
 
 bool
 ConfigObjectReference::allow(const QMetaObject *elementType) {
-  if (! _elementTypes.contains(elementType->className()))
-    _elementTypes.append(elementType->className());
+  if (! _elementTypes->types.contains(elementType))
+    _elementTypes = _elementTypes->extend(elementType);
   return true;
 }
 
 const QStringList &
 ConfigObjectReference::elementTypeNames() const {
-  return _elementTypes;
+  return _elementTypes->names;
 }
 
 void
-ConfigObjectReference::onReferenceDeleted(QObject *obj) {
-  // Check if destroyed obj is referenced one.
-  if (_object != reinterpret_cast<ConfigObject*>(obj))
+ConfigObjectReference::track(ConfigObject *object) {
+  ReferenceIndex &index = ReferenceIndex::get();
+  QMutexLocker lock(&index.mutex);
+  if (_object == object)
     return;
-  // If it is
-  _object = nullptr;
-  emit modified();
+  if (_object) {
+    auto refs = index.references.find(_object);
+    if (index.references.end() != refs) {
+      refs->remove(this);
+      if (refs->isEmpty())
+        index.references.erase(refs);
+    }
+  }
+  _object = object;
+  if (_object)
+    index.references[_object].insert(this);
+}
+
+void
+ConfigObjectReference::clearReferencesTo(ConfigObject *obj) {
+  ReferenceIndex &index = ReferenceIndex::get();
+  QSet<ConfigObjectReference *> refs;
+  {
+    QMutexLocker lock(&index.mutex);
+    refs = index.references.take(obj);
+    foreach (ConfigObjectReference *ref, refs)
+      ref->_object = nullptr;
+  }
+  // Notify outside of the lock, the handlers may update other references
+  foreach (ConfigObjectReference *ref, refs)
+    emit ref->modified();
 }
 
 
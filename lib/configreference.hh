@@ -12,16 +12,28 @@ class EncryptionKey;
 
 /** Implements a reference to a config object.
  * This class is only used to implement the automatic generation/parsing of the YAML codeplug files.
+ *
+ * As every config object holds several references, these are kept lightweight: The possible
+ * element types are held by a descriptor shared among all references of the same kind and the
+ * references do not connect to the referenced object. Instead, all references are tracked in a
+ * single reverse index, that gets consulted once a config object gets destroyed.
  * @ingroup conf */
 class ConfigObjectReference: public QObject
 {
   Q_OBJECT
 
+protected:
+  /** Shared descriptor of the possible element types. */
+  class ElementTypes;
+
 protected:
   /** Hidden constructor. */
   ConfigObjectReference(const QMetaObject &elementType=ConfigObject::staticMetaObject, QObject *parent = nullptr);
 
 public:
+  /** Destructor, removes the reference from the reverse index. */
+  virtual ~ConfigObjectReference();
+
   /** Returns @c true if the reference is null.
    * That is, if there is no object referenced. */
   bool isNull() const;
@@ -59,18 +71,22 @@ public:
   /** Compares the references. */
   int compare(const ConfigObjectReference &other) const;
 
+  /** Clears all references to the given object. Gets called by the object once it gets
+   * destroyed. */
+  static void clearReferencesTo(ConfigObject *obj);
+
 signals:
   /** Gets emitted if the reference is changed.
    * This signal is not emitted if the referenced object is modified. */
   void modified();
 
-protected slots:
-  /** Internal call back whenever the referenced object gets deleted. */
-  void onReferenceDeleted(QObject *obj);
+protected:
+  /** Points the reference to the given object and updates the reverse index accordingly. */
+  void track(ConfigObject *object);
 
 protected:
-  /** Holds the static QMetaObject of the possible element types. */
-  QStringList _elementTypes;
+  /** Holds the shared descriptor of the possible element types. */
+  const ElementTypes *_elementTypes;
   /** The reference to the object. */
   ConfigObject *_object;
 };
@@ -1,4 +1,16 @@
 #include "crc32.hh"
+#include <cstring>
+#include <QtGlobal>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32_HAVE_CLMUL 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC32_HAVE_ARMV8 1
+#include <arm_acle.h>
+#endif
 
 static const uint32_t _crc_table[256] = {
   /* CRC polynomial 0xedb88320 */
@@ -48,6 +60,176 @@ static const uint32_t _crc_table[256] = {
 };
 
 
+/** Tables for the slice-by-8 implementation. The first table is the classic byte-wise table, the
+ * k-th table holds the CRC of a byte followed by k zero bytes. */
+struct SliceTables {
+  uint32_t table[8][256];
+
+  SliceTables() {
+    for (int i=0; i<256; i++) {
+      table[0][i] = _crc_table[i];
+      for (int k=1; k<8; k++)
+        table[k][i] = (table[k-1][i] >> 8) ^ _crc_table[table[k-1][i] & 0xff];
+    }
+  }
+};
+
+static const SliceTables &
+sliceTables() {
+  static const SliceTables tables;
+  return tables;
+}
+
+static uint32_t
+crc32_bytewise(uint32_t crc, const uint8_t *buf, size_t n) {
+	for (size_t i=0; i<n; i++)
+    crc = ( _crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8) );
+  return crc;
+}
+
+static uint32_t
+crc32_slice8(uint32_t crc, const uint8_t *buf, size_t n) {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+  const uint32_t (*t)[256] = sliceTables().table;
+  while (n >= 8) {
+    uint32_t lo, hi;
+    memcpy(&lo, buf, 4); memcpy(&hi, buf+4, 4);
+    lo ^= crc;
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+        t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    buf += 8; n -= 8;
+  }
+#endif
+  return crc32_bytewise(crc, buf, n);
+}
+
+#ifdef CRC32_HAVE_CLMUL
+/** Folds 16-byte blocks using carry-less multiplication, followed by a Barrett reduction. See
+ * Gopal et al., "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction", Intel
+ * 2009. The constants are those of the bit-reflected polynomial 0xedb88320. Requires at least 64
+ * bytes and processes a multiple of 16 bytes. */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t
+crc32_clmul_blocks(uint32_t crc, const uint8_t *buf, size_t n) {
+  static const uint64_t k1k2[] __attribute__((aligned(16))) = { 0x0154442bd4, 0x01c6e41596 };
+  static const uint64_t k3k4[] __attribute__((aligned(16))) = { 0x01751997d0, 0x00ccaa009e };
+  static const uint64_t k5k0[] __attribute__((aligned(16))) = { 0x0163cd6124, 0x0000000000 };
+  static const uint64_t poly[] __attribute__((aligned(16))) = { 0x01db710641, 0x01f7011641 };
+
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+  x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+  x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+  x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+  x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+  x0 = _mm_load_si128((const __m128i *)k1k2);
+  buf += 64; n -= 64;
+
+  // Fold 4 blocks in parallel
+  while (n >= 64) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+    y5 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    y6 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    y7 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    y8 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+    buf += 64; n -= 64;
+  }
+
+  // Fold into 128 bits
+  x0 = _mm_load_si128((const __m128i *)k3k4);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  // Fold remaining single blocks
+  while (n >= 16) {
+    x2 = _mm_loadu_si128((const __m128i *)buf);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    buf += 16; n -= 16;
+  }
+
+  // Fold 128 bits to 64 bits
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+  x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits
+  x0 = _mm_load_si128((const __m128i *)poly);
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return _mm_extract_epi32(x1, 1);
+}
+
+static uint32_t
+crc32_clmul(uint32_t crc, const uint8_t *buf, size_t n) {
+  if (n >= 64) {
+    size_t blocks = n & ~size_t(15);
+    crc = crc32_clmul_blocks(crc, buf, blocks);
+    buf += blocks; n -= blocks;
+  }
+  return crc32_slice8(crc, buf, n);
+}
+#endif
+
+#ifdef CRC32_HAVE_ARMV8
+static uint32_t
+crc32_armv8(uint32_t crc, const uint8_t *buf, size_t n) {
+  while (n >= 8) {
+    uint64_t word;
+    memcpy(&word, buf, 8);
+    crc = __crc32d(crc, word);
+    buf += 8; n -= 8;
+  }
+  while (n--)
+    crc = __crc32b(crc, *buf++);
+  return crc;
+}
+#endif
+
+/** Selects the fastest implementation supported by the host CPU. */
+static CRC32::Implementation
+selectImplementation() {
+  if (CRC32::isSupported(CRC32::Implementation::ARMv8))
+    return CRC32::Implementation::ARMv8;
+  if (CRC32::isSupported(CRC32::Implementation::CLMUL))
+    return CRC32::Implementation::CLMUL;
+  return CRC32::Implementation::SliceBy8;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of CRC32
+ * ********************************************************************************************* */
 CRC32::CRC32()
   : _crc(0xFFFFFFFF)
 {
@@ -61,8 +243,11 @@ CRC32::update(uint8_t c) {
 
 void
 CRC32::update(const uint8_t *buf, size_t n) {
-	for (size_t i=0; i<n; i++)
-    _crc = ( _crc_table[(_crc ^ buf[i]) & 0xFF] ^ (_crc >> 8) );
+  // Short headers are not worth the dispatch
+  if (n < 16)
+    _crc = crc32_bytewise(_crc, buf, n);
+  else
+    _crc = process(_crc, buf, n, implementation());
 }
 
 void
@@ -70,3 +255,64 @@ CRC32::update(const QByteArray &buf) {
 	update((const uint8_t *)buf.constData(), buf.size());
 }
 
+CRC32::Implementation
+CRC32::implementation() {
+  static const Implementation impl = selectImplementation();
+  return impl;
+}
+
+bool
+CRC32::isSupported(Implementation impl) {
+  switch (impl) {
+  case Implementation::Bytewise:
+  case Implementation::SliceBy8:
+    return true;
+  case Implementation::CLMUL:
+#ifdef CRC32_HAVE_CLMUL
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#else
+    return false;
+#endif
+  case Implementation::ARMv8:
+#ifdef CRC32_HAVE_ARMV8
+    return true;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+const char *
+CRC32::name(Implementation impl) {
+  switch (impl) {
+  case Implementation::Bytewise: return "bytewise";
+  case Implementation::SliceBy8: return "slice-by-8";
+  case Implementation::CLMUL: return "clmul";
+  case Implementation::ARMv8: return "armv8";
+  }
+  return "unknown";
+}
+
+uint32_t
+CRC32::process(uint32_t crc, const uint8_t *buf, size_t n, Implementation impl) {
+  switch (impl) {
+  case Implementation::Bytewise:
+    return crc32_bytewise(crc, buf, n);
+  case Implementation::SliceBy8:
+    return crc32_slice8(crc, buf, n);
+  case Implementation::CLMUL:
+#ifdef CRC32_HAVE_CLMUL
+    return crc32_clmul(crc, buf, n);
+#else
+    break;
+#endif
+  case Implementation::ARMv8:
+#ifdef CRC32_HAVE_ARMV8
+    return crc32_armv8(crc, buf, n);
+#else
+    break;
+#endif
+  }
+  return crc32_slice8(crc, buf, n);
+}
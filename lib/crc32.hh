@@ -4,10 +4,22 @@
 #include <QByteArray>
 
 /** Implements the CRC32 checksum as used in DFU files.
+ *
+ * Larger blocks of data are processed using the fastest implementation available on the host CPU,
+ * which is selected once at runtime. All implementations yield identical results.
  *
  * @ingroup util */
 class CRC32
 {
+public:
+  /** Possible implementations of the CRC computation. */
+  enum class Implementation {
+    Bytewise,    ///< Classic table-driven, byte-at-a-time implementation.
+    SliceBy8,    ///< Portable slice-by-8 implementation, processes 8 bytes per step.
+    CLMUL,       ///< Folding using carry-less multiplication (x86 PCLMULQDQ).
+    ARMv8        ///< ARMv8 CRC32 instructions.
+  };
+
 public:
   /** Default constructor. */
 	CRC32();
@@ -20,6 +32,16 @@ public:
   /** Returns the current CRC. */
   inline uint32_t get() { return _crc; }
 
+  /** Returns the implementation selected for the host CPU. */
+  static Implementation implementation();
+  /** Returns @c true if the given implementation is supported by the host CPU. */
+  static bool isSupported(Implementation impl);
+  /** Returns the name of the given implementation. */
+  static const char *name(Implementation impl);
+  /** Updates the given CRC register with the given data using the specified implementation.
+   * The implementation must be supported by the host CPU. */
+  static uint32_t process(uint32_t crc, const uint8_t *buf, size_t n, Implementation impl);
+
 protected:
   /** Current CRC. */
 	uint32_t _crc;
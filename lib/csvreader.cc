@@ -3,36 +3,40 @@
 #include "utils.hh"
 #include "logger.hh"
 
-#include <QRegExp>
 #include <QDebug>
+#include <algorithm>
 
-QVector< QPair<QRegExp, CSVLexer::Token::TokenType> > CSVLexer::_pattern = {
-  { QRegExp("^n([0-9]{3})"),                     CSVLexer::Token::T_DCS_N },
-  { QRegExp("^i([0-9]{3})"),                     CSVLexer::Token::T_DCS_I },
-  { QRegExp("^([a-zA-Z0-9]{1,6}-[0-9]{1,2})"),   CSVLexer::Token::T_APRSCALL },
-  { QRegExp("^([a-zA-Z_][a-zA-Z0-9_]*)"),        CSVLexer::Token::T_KEYWORD },
-  { QRegExp("^\"([^\"\r\n]*)\""),                CSVLexer::Token::T_STRING },
-  { QRegExp("^([+-]?[0-9]+(\\.[0-9]*)?)"),       CSVLexer::Token::T_NUMBER },
-  { QRegExp("^(:)"),                             CSVLexer::Token::T_COLON },
-  { QRegExp("^(-)"),                             CSVLexer::Token::T_NOT_SET },
-  { QRegExp("^(\\+)"),                           CSVLexer::Token::T_ENABLED },
-  { QRegExp("^(,)"),                             CSVLexer::Token::T_COMMA },
-  { QRegExp("^([ \t]+)"),                        CSVLexer::Token::T_WHITESPACE },
-  { QRegExp("^(\r?\n)"),                         CSVLexer::Token::T_NEWLINE},
-  { QRegExp("^(#[^\n\r]*)"),                     CSVLexer::Token::T_COMMENT},
+/** Character classes used by the lexer. */
+enum CharClass {
+  C_DIGIT = 1, C_ALPHA = 2, C_UNDERSCORE = 4, C_BLANK = 8
 };
 
+/** Maps ASCII characters to their character classes. */
+static const struct CharClassTable {
+  /** The class of every ASCII character. */
+  quint8 cls[128];
+  /** Constructs the table. */
+  CharClassTable() : cls() {
+    for (int c='0'; c<='9'; c++)
+      cls[c] = C_DIGIT;
+    for (int c='a'; c<='z'; c++)
+      cls[c] = cls[c-'a'+'A'] = C_ALPHA;
+    cls[int('_')] = C_UNDERSCORE;
+    cls[int(' ')] = cls[int('\t')] = C_BLANK;
+  }
+} charClassTable;
+
 
 /* ********************************************************************************************* *
  * Implementation of CSVLexer
  * ********************************************************************************************* */
 CSVLexer::CSVLexer(QTextStream &stream, QObject *parent)
-  : QObject(parent), _errorMessage(), _stream(stream), _stack(), _currentLine()
+  : QObject(parent), _errorMessage(), _stream(stream), _stack(), _text()
 {
   _stream.seek(0);
+  _text = _stream.readAll();
   _stack.reserve(10);
   _stack.push_back({0, 1, 1});
-  _currentLine = _stream.readLine();
 }
 
 const QString &
@@ -48,30 +52,123 @@ CSVLexer::next() {
   return token;
 }
 
+inline unsigned
+CSVLexer::charClass(qint64 offset) const {
+  if (offset >= _text.size())
+    return 0;
+  ushort c = _text.at(offset).unicode();
+  return (128 > c) ? charClassTable.cls[c] : 0;
+}
+
+inline qint64
+CSVLexer::span(qint64 offset, unsigned cls) const {
+  qint64 end = offset;
+  while (charClass(end) & cls)
+    end++;
+  return end-offset;
+}
+
+CSVLexer::Token
+CSVLexer::token(Token::TokenType type, qint64 start, qint64 length, qint64 matched) {
+  State &state = _stack.back();
+  Token token = {type, _text.mid(start, length), state.line, state.column};
+  state.offset += matched;
+  state.column += length;
+  return token;
+}
+
 CSVLexer::Token
 CSVLexer::lex() {
-  if (_currentLine.isEmpty() && _stream.atEnd()) {
-    return {Token::T_END_OF_STREAM, "", _stack.back().line, _stack.back().column };
-  } else if (_currentLine.isEmpty()) {
-    Token token = {Token::T_NEWLINE, "", _stack.back().line, _stack.back().column };
-    _stack.back().offset = _stream.pos();
-    _currentLine = _stream.readLine();
-    _stack.back().line++;
-    _stack.back().column = 1;
+  State &state = _stack.back();
+  const qint64 pos = state.offset, size = _text.size();
+  if (pos >= size)
+    return {Token::T_END_OF_STREAM, "", state.line, state.column};
+
+  const QChar *text = _text.constData();
+  const QChar c = text[pos];
+  const unsigned cls = charClass(pos);
+
+  // Handle line ends, the one terminating the last line is not reported.
+  if (('\r' == c) && ((pos+1) == size)) {
+    state.offset = size;
+    return {Token::T_END_OF_STREAM, "", state.line, state.column};
+  }
+  if (('\n' == c) || (('\r' == c) && ((pos+1) < size) && ('\n' == text[pos+1]))) {
+    qint64 len = ('\n' == c) ? 1 : 2;
+    if ((pos+len) >= size) {
+      state.offset = size;
+      return {Token::T_END_OF_STREAM, "", state.line, state.column};
+    }
+    Token token = {Token::T_NEWLINE, "", state.line, state.column};
+    state.offset += len;
+    state.line++;
+    state.column = 1;
     return token;
   }
-  foreach (auto pattern, _pattern) {
-    if (0 == pattern.first.indexIn(_currentLine)) {
-      Token token = {pattern.second, pattern.first.cap(1), _stack.back().line, _stack.back().column};
-      _stack.back().offset += pattern.first.matchedLength();
-      _stack.back().column += token.value.size();
-      _currentLine = _currentLine.mid(pattern.first.matchedLength());
-      return token;
-    }
+
+  // DCS codes 'nXXX' and 'iXXX'
+  if ((('n' == c) || ('i' == c)) && (3 <= span(pos+1, C_DIGIT)))
+    return token(('n' == c) ? Token::T_DCS_N : Token::T_DCS_I, pos+1, 3, 4);
+
+  // APRS call 'CALL-SSID', the call has at most 6 and the SSID at most 2 chars
+  qint64 alnum = span(pos, C_ALPHA | C_DIGIT);
+  if ((1 <= alnum) && (6 >= alnum) && ((pos+alnum) < size) && ('-' == text[pos+alnum])) {
+    qint64 ssid = std::min(qint64(2), span(pos+alnum+1, C_DIGIT));
+    if (ssid)
+      return token(Token::T_APRSCALL, pos, alnum+1+ssid, alnum+1+ssid);
+  }
+
+  // Keywords
+  if (cls & (C_ALPHA | C_UNDERSCORE)) {
+    qint64 len = span(pos, C_ALPHA | C_DIGIT | C_UNDERSCORE);
+    return token(Token::T_KEYWORD, pos, len, len);
+  }
+
+  // Strings must end on the same line
+  if ('"' == c) {
+    qint64 end = pos+1;
+    while ((end < size) && ('"' != text[end]) && ('\r' != text[end]) && ('\n' != text[end]))
+      end++;
+    if ((end < size) && ('"' == text[end]))
+      return token(Token::T_STRING, pos+1, end-pos-1, end-pos+1);
+  }
+
+  // Numbers with optional sign and fractional part
+  qint64 sign = (('+' == c) || ('-' == c)) ? 1 : 0;
+  if (qint64 digits = span(pos+sign, C_DIGIT)) {
+    qint64 len = sign + digits;
+    if (((pos+len) < size) && ('.' == text[pos+len]))
+      len += 1 + span(pos+len+1, C_DIGIT);
+    return token(Token::T_NUMBER, pos, len, len);
   }
-  _errorMessage = tr("Lexer error %1,%2: Unexpected char '%3'.").arg(_stack.back().line)
-      .arg(_stack.back().column).arg(_currentLine.at(0));
-  return {Token::T_ERROR, _errorMessage, _stack.back().line, _stack.back().column};
+
+  // Single char tokens
+  if (':' == c)
+    return token(Token::T_COLON, pos, 1, 1);
+  if ('-' == c)
+    return token(Token::T_NOT_SET, pos, 1, 1);
+  if ('+' == c)
+    return token(Token::T_ENABLED, pos, 1, 1);
+  if (',' == c)
+    return token(Token::T_COMMA, pos, 1, 1);
+
+  // Whitespace
+  if (cls & C_BLANK) {
+    qint64 len = span(pos, C_BLANK);
+    return token(Token::T_WHITESPACE, pos, len, len);
+  }
+
+  // Comments extend to the end of the line
+  if ('#' == c) {
+    qint64 end = pos+1;
+    while ((end < size) && ('\r' != text[end]) && ('\n' != text[end]))
+      end++;
+    return token(Token::T_COMMENT, pos, end-pos, end-pos);
+  }
+
+  _errorMessage = tr("Lexer error %1,%2: Unexpected char '%3'.").arg(state.line)
+      .arg(state.column).arg(c);
+  return {Token::T_ERROR, _errorMessage, state.line, state.column};
 }
 
 void
@@ -84,8 +181,6 @@ CSVLexer::pop() {
   if (_stack.size() < 2)
     return;
   _stack.pop_back();
-  _stream.seek(_stack.back().offset);
-  _currentLine = QString();
 }
 
 /* ********************************************************************************************* *
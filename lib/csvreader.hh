@@ -18,7 +18,12 @@ class ScanList;
 class RoamingZone;
 
 
-/** The lexer class divides a text stream into tokens. */
+/** The lexer class divides a text stream into tokens.
+ *
+ * The lexer reads the complete stream once and scans the text in a single pass using a character
+ * class table. Tokens are matched in a fixed order of precedence (DCS codes, APRS calls, keywords,
+ * strings, numbers, punctuation, whitespace and comments), that is, the first matching token type
+ * wins. */
 class CSVLexer: public QObject
 {
   Q_OBJECT
@@ -60,7 +65,7 @@ public:
 
   /// Current state of lexer.
   struct State {
-    /// The current stream offset.
+    /// The current offset within the text.
     qint64 offset;
     /// The current line count.
     qint64 line;
@@ -85,6 +90,17 @@ protected:
   /** Internal used function to get the next token. Also returns ignored tokens like whitespace
    * and comment. */
   Token lex();
+  /** Returns the character class flags of the character at the given offset. Returns 0 for
+   * non-ASCII characters and offsets beyond the end of the text. */
+  inline unsigned charClass(qint64 offset) const;
+  /** Counts the characters of the given class starting at the given offset. */
+  inline qint64 span(qint64 offset, unsigned cls) const;
+  /** Assembles a token of the given type at the current position and advances the state.
+   * @param type Specifies the token type.
+   * @param start Specifies the offset of the token value.
+   * @param length Specifies the length of the token value.
+   * @param matched Specifies the number of characters consumed. */
+  Token token(Token::TokenType type, qint64 start, qint64 length, qint64 matched);
 
 protected:
   /// The error message.
@@ -93,10 +109,8 @@ protected:
   QTextStream &_stream;
   /// The stack of saved lexer states
   QVector<State> _stack;
-  /// The current line count
-  QString _currentLine;
-  /// The list of patterns to match
-  static QVector< QPair<QRegExp, Token::TokenType> > _pattern;
+  /// The complete text to tokenize.
+  QString _text;
 };
 
 
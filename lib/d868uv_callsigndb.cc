@@ -153,13 +153,8 @@ bool D868UVCallsignDB::encode(UserDatabase *db, const Selection &selection, cons
   if (selection.hasCountLimit())
     n = std::min(n, (qint64)selection.countLimit());
 
-  // Select n users and sort them in ascending order of their IDs
-  QVector<UserDatabase::User> users;
-  users.reserve(n);
-  for (unsigned i=0; i<n; i++)
-    users.append(db->user(i));
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
+  // Select n users closest to the selected IDs, in ascending order of their IDs
+  QVector<UserDatabase::User> users = db->closest(selection.prefixes(), n);
 
   // Compute total size of callsign db entries
   size_t dbSize = 0;
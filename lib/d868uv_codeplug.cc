@@ -1421,28 +1421,19 @@ D868UVCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStac
   if (! this->encodeBootSettings(flags, ctx, err))
     return false;
 
-  if (! this->encodeChannels(flags, ctx, err))
-    return false;
-
-  if (! this->encodeContacts(flags, ctx, err))
-    return false;
-
-  if (! this->encodeAnalogContacts(flags, ctx, err))
-    return false;
-
-  if (! this->encodeRXGroupLists(flags, ctx, err))
-    return false;
-
-  if (! this->encodeZones(flags, ctx, err))
-    return false;
-
-  if (! this->encodeScanLists(flags, ctx, err))
-    return false;
-
-  if (! this->encodeGPSSystems(flags, ctx, err))
-    return false;
-
-  return true;
+  // The element tables below are independent of each other, that is, every step only writes its
+  // own table. Hence they may be encoded concurrently.
+  QVector<EncodingStep> steps = {
+    [this, &flags, &ctx](const ErrorStack &err) { return this->encodeChannels(flags, ctx, err); },
+    [this, &flags, &ctx](const ErrorStack &err) { return this->encodeContacts(flags, ctx, err); },
+    [this, &flags, &ctx](const ErrorStack &err) { return this->encodeAnalogContacts(flags, ctx, err); },
+    [this, &flags, &ctx](const ErrorStack &err) { return this->encodeRXGroupLists(flags, ctx, err); },
+    [this, &flags, &ctx](const ErrorStack &err) { return this->encodeZones(flags, ctx, err); },
+    [this, &flags, &ctx](const ErrorStack &err) { return this->encodeScanLists(flags, ctx, err); },
+    [this, &flags, &ctx](const ErrorStack &err) { return this->encodeGPSSystems(flags, ctx, err); }
+  };
+
+  return runEncodingSteps(steps, flags.parallelEncode, err);
 }
 
 bool
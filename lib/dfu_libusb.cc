@@ -1,8 +1,16 @@
 #include "dfu_libusb.hh"
 #include <unistd.h>
+#include <cstring>
+#include <algorithm>
+#include <QStringList>
 #include "logger.hh"
 #include "utils.hh"
 
+/** Minimum delay between two polls of a busy device in us. */
+#define MIN_POLL_DELAY 1000
+/** Maximum delay between two polls of a busy device in us, unless the device asks for more. */
+#define MAX_POLL_DELAY 100000
+
 
 // USB request types.
 #define REQUEST_TYPE_TO_HOST    0xA1
@@ -33,6 +41,62 @@ enum {
 };
 
 
+/* ********************************************************************************************* *
+ * Implementation of DFUDevice::TimingStatistics
+ * ********************************************************************************************* */
+/** Upper bounds of the histogram bins in us, the last bin is unbounded. */
+static const qint64 binBounds[DFUDevice::TimingStatistics::NumBins-1] = {
+  100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000,
+  1000000, 2000000, 5000000 };
+/** Labels of the histogram bins. */
+static const char *binLabels[DFUDevice::TimingStatistics::NumBins] = {
+  "<0.1ms", "<0.2ms", "<0.5ms", "<1ms", "<2ms", "<5ms", "<10ms", "<20ms", "<50ms", "<100ms",
+  "<200ms", "<500ms", "<1s", "<2s", "<5s", ">=5s" };
+/** Names of the operations. */
+static const char *operationNames[DFUDevice::TimingStatistics::NumOperations] = {
+  "erase", "download", "upload", "status", "wait" };
+
+DFUDevice::TimingStatistics::TimingStatistics()
+{
+  reset();
+}
+
+void
+DFUDevice::TimingStatistics::reset() {
+  memset(histograms, 0, sizeof(histograms));
+}
+
+void
+DFUDevice::TimingStatistics::add(Operation op, qint64 ns) {
+  Histogram &hist = histograms[unsigned(op)];
+  hist.count++;
+  hist.elapsed += ns;
+  hist.max = std::max(hist.max, ns);
+  unsigned bin = std::upper_bound(binBounds, binBounds+NumBins-1, ns/1000) - binBounds;
+  hist.bins[bin]++;
+}
+
+QString
+DFUDevice::TimingStatistics::format() const {
+  QStringList lines;
+  for (unsigned op=0; op<NumOperations; op++) {
+    const Histogram &hist = histograms[op];
+    if (0 == hist.count)
+      continue;
+    QStringList bins;
+    for (unsigned i=0; i<NumBins; i++) {
+      if (hist.bins[i])
+        bins.append(QString("%1: %2").arg(binLabels[i]).arg(hist.bins[i]));
+    }
+    lines.append(QString("%1: %2 ops in %3s, mean %4 ms, max. %5 ms [%6]")
+                 .arg(operationNames[op]).arg(hist.count).arg(double(hist.elapsed)/1e9, 0, 'f', 2)
+                 .arg(double(hist.elapsed)/hist.count/1e6, 0, 'f', 2)
+                 .arg(double(hist.max)/1e6, 0, 'f', 2).arg(bins.join(", ")));
+  }
+  return lines.join("\n");
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of DFUDevice::Descriptor
  * ********************************************************************************************* */
@@ -47,7 +111,7 @@ DFUDevice::Descriptor::Descriptor(const USBDeviceInfo &info, uint8_t bus, uint8_
  * Implementation of DFUDevice
  * ********************************************************************************************* */
 DFUDevice::DFUDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObject *parent)
-  : QObject(parent), _ctx(nullptr), _dev(nullptr)
+  : QObject(parent), _ctx(nullptr), _dev(nullptr), _status(), _statistics()
 {
   if (USBDeviceInfo::Class::DFU != descr.interfaceClass()) {
     errMsg(err) << "Cannot connect to DFU device using a non DFU descriptor: "
@@ -192,10 +256,27 @@ DFUDevice::close() {
 }
 
 
+const DFUDevice::TimingStatistics &
+DFUDevice::statistics() const {
+  return _statistics;
+}
+
+void
+DFUDevice::resetStatistics() {
+  _statistics.reset();
+}
+
+void
+DFUDevice::record(Operation op, const QElapsedTimer &timer) {
+  _statistics.add(op, timer.nsecsElapsed());
+}
+
 int
 DFUDevice::download(unsigned block, uint8_t *data, unsigned len, const ErrorStack &err) {
+  QElapsedTimer timer; timer.start();
   int error = libusb_control_transfer(
         _dev, REQUEST_TYPE_TO_DEVICE, REQUEST_DNLOAD, block, 0, data, len, 0);
+  record(Operation::Download, timer);
 
   if (error < 0) {
     errMsg(err) << "Cannot write to device: " << libusb_strerror((enum libusb_error) error) << ".";
@@ -207,8 +288,10 @@ DFUDevice::download(unsigned block, uint8_t *data, unsigned len, const ErrorStac
 
 int
 DFUDevice::upload(unsigned block, uint8_t *data, unsigned len, const ErrorStack &err) {
+  QElapsedTimer timer; timer.start();
   int error = libusb_control_transfer(
         _dev, REQUEST_TYPE_TO_HOST, REQUEST_UPLOAD, block, 0, data, len, 0);
+  record(Operation::Upload, timer);
 
   if (error < 0) {
     errMsg(err) << "Cannot read block: " << libusb_strerror((enum libusb_error) error) << ".";
@@ -233,8 +316,10 @@ DFUDevice::detach(int timeout, const ErrorStack &err)
 int
 DFUDevice::get_status(const ErrorStack &err)
 {
+  QElapsedTimer timer; timer.start();
   int error = libusb_control_transfer(
         _dev, REQUEST_TYPE_TO_HOST, REQUEST_GETSTATUS, 0, 0, (unsigned char*)&_status, 6, 0);
+  record(Operation::Status, timer);
   if (0 > error) {
     errMsg(err) << "Cannot get status: " << libusb_strerror((enum libusb_error) error) << ".";
     return error;
@@ -259,8 +344,10 @@ DFUDevice::get_state(int &pstate, const ErrorStack &err)
 {
   unsigned char state;
 
+  QElapsedTimer timer; timer.start();
   int error = libusb_control_transfer(
         _dev, REQUEST_TYPE_TO_HOST, REQUEST_GETSTATE, 0, 0, &state, 1, 0);
+  record(Operation::Status, timer);
   pstate = state;
   if (error < 0) {
     errMsg(err) << "Cannot get state: " << libusb_strerror((enum libusb_error) error) << ".";
@@ -286,11 +373,15 @@ int
 DFUDevice::wait_idle(const ErrorStack &err)
 {
   int state, error;
+  unsigned delay = 0;
 
-  for (;;) {
-    if (0 > (error = get_state(state, err)))
-      return 1;
+  // Request the status rather than the state. This lets the device process a pending request and
+  // refreshes the poll timeout, which may be stale from an earlier operation.
+  if (0 > (error = get_status(err)))
+    return 1;
+  state = _status.state;
 
+  for (;;) {
     switch (state) {
       case dfuIDLE:
         return 0;
@@ -305,9 +396,23 @@ DFUDevice::wait_idle(const ErrorStack &err)
 
       case appDETACH:
       case dfuDNBUSY:
-      case dfuMANIFEST_WAIT_RESET:
-        usleep(100000);
-        continue;
+      case dfuMANIFEST_WAIT_RESET: {
+        // Do not poll earlier than requested by the device with the last status, back off
+        // exponentially while the device remains busy.
+        unsigned backoff = (0 == delay) ? MIN_POLL_DELAY : std::min(2*delay, unsigned(MAX_POLL_DELAY));
+        delay = std::max(unsigned(_status.poll_timeout)*1000, backoff);
+        QElapsedTimer timer; timer.start();
+        usleep(delay);
+        record(Operation::Wait, timer);
+        // Requesting the status lets the device leave the busy state and updates the poll timeout
+        if (dfuDNBUSY == state) {
+          if (0 > (error = get_status(err)))
+            return 1;
+          state = _status.state;
+          continue;
+        }
+        error = 0;
+      } break;
 
       default:
         error = abort(err);
@@ -316,6 +421,9 @@ DFUDevice::wait_idle(const ErrorStack &err)
 
     if (error < 0)
       return 1;
+
+    if (0 > (error = get_state(state, err)))
+      return 1;
   }
 }
 
@@ -382,6 +490,7 @@ DFUSEDevice::erasePage(uint32_t address, const ErrorStack &err) {
     0x41, (uint8_t)address, (uint8_t)(address >> 8), (uint8_t)(address >> 16), (uint8_t)(address >> 24)
   };
 
+  QElapsedTimer timer; timer.start();
   if (int error = download(0, cmd, 5, err)) {
     errMsg(err) << "Cannot erase page at address " << QString::number(address, 16) << ".";
     return error;
@@ -391,6 +500,7 @@ DFUSEDevice::erasePage(uint32_t address, const ErrorStack &err) {
     errMsg(err) << "Erase page command failed.";
     return false;
   }
+  record(Operation::Erase, timer);
   return true;
 }
 
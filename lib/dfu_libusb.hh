@@ -2,6 +2,7 @@
 #define DFU_LIBUSB_HH
 
 #include <QObject>
+#include <QElapsedTimer>
 #include <libusb.h>
 #include "errorstack.hh"
 #include "radiointerface.hh"
@@ -26,6 +27,50 @@ private:
 		unsigned  string_index : 8;
   };
 
+public:
+  /** The operations, the timing statistics are collected for. */
+  enum class Operation {
+    Erase = 0,  ///< Erasing a memory page, including waiting for the device.
+    Download,   ///< Transferring data to the device.
+    Upload,     ///< Transferring data from the device.
+    Status,     ///< Requesting the status or state of the device.
+    Wait        ///< Waiting for the device while it is busy.
+  };
+
+  /** Collects a histogram of the durations of every operation.
+   * These statistics are collected across all operations, until they get reset using
+   * @c resetStatistics. */
+  struct TimingStatistics {
+    /** Number of histogram bins. */
+    static const unsigned NumBins = 16;
+    /** Number of operations. */
+    static const unsigned NumOperations = 5;
+
+    /** Durations of a single operation. */
+    struct Histogram {
+      /** Number of operations. */
+      unsigned count;
+      /** Total time spent in ns. */
+      qint64 elapsed;
+      /** The maximum duration in ns. */
+      qint64 max;
+      /** Number of operations per duration bin, the bins are spaced 1-2-5 starting at 0.1ms. */
+      unsigned bins[NumBins];
+    };
+
+    /** The histograms, indexed by @c Operation. */
+    Histogram histograms[NumOperations];
+
+    /** Empty constructor. */
+    TimingStatistics();
+    /** Resets the statistics. */
+    void reset();
+    /** Adds an operation of the given duration in ns. */
+    void add(Operation op, qint64 ns);
+    /** Formats the statistics as a human readable text, one line per operation. */
+    QString format() const;
+  };
+
 public:
   /** Specialization to address a DFU device uniquely. */
   class Descriptor: public USBDeviceDescriptor
@@ -51,6 +96,11 @@ public:
   /** Uploads some data from the device. */
   int upload(unsigned block, uint8_t *data, unsigned len, const ErrorStack &err=ErrorStack());
 
+  /** Returns the timing statistics. */
+  const TimingStatistics &statistics() const;
+  /** Resets the timing statistics. */
+  void resetStatistics();
+
 public:
   /** Finds all DFU interfaces with the specified VID/PID combination. */
   static QList<USBDeviceDescriptor> detect(uint16_t vid, uint16_t pid);
@@ -66,8 +116,12 @@ protected:
   int get_state(int &pstate, const ErrorStack &err=ErrorStack());
   /** Internal used function to abort the current operation. */
   int abort(const ErrorStack &err=ErrorStack());
-  /** Internal used function to busy-wait for a response from the device. */
+  /** Internal used function to wait for the device to become idle. While the device is busy, it
+   * gets polled no earlier than the poll timeout reported with the last status, backing off
+   * exponentially. */
   int wait_idle(const ErrorStack &err=ErrorStack());
+  /** Adds the duration of an operation, measured by the given timer, to the statistics. */
+  void record(Operation op, const QElapsedTimer &timer);
 
 protected:
   /** USB context. */
@@ -76,6 +130,8 @@ protected:
 	libusb_device_handle *_dev;
   /** Device status. */
 	status_t _status;
+  /** The timing statistics. */
+  TimingStatistics _statistics;
 };
 
 
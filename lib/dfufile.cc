@@ -1,6 +1,11 @@
 #include "dfufile.hh"
 #include <QFile>
+#include <QFileInfo>
 #include <QtEndian>
+#include <QSet>
+#include <QHash>
+#include <QMutex>
+#include <algorithm>
 
 #include "crc32.hh"
 #include "logger.hh"
@@ -39,6 +44,199 @@ typedef struct __attribute((packed)) {
 } element_prefix_t;
 
 
+/** Size of the write buffer. Larger blocks are written directly. */
+#define WRITE_BUFFER_SIZE 0x10000
+
+
+/* ********************************************************************************************* *
+ * Implementation of DFUFile::Buffer
+ * ********************************************************************************************* */
+class DFUFile::Buffer
+{
+public:
+  /** Constructs an empty buffer. */
+  Buffer();
+  /** Destructor, unmaps the file. */
+  ~Buffer();
+
+  /** Loads the remaining content of the given file. The file gets mapped into memory using a
+   * separate handle, such that the mapping stays valid after the given file is closed. If the
+   * file cannot be mapped, its content gets read at once. */
+  bool load(QFile &file, QString &errorMessage);
+
+  /** Returns the name of the file. */
+  inline const QString &fileName() const { return _fileName; }
+  /** Returns a pointer to the content. */
+  inline const uchar *data() const { return _data; }
+  /** Returns the size of the content. */
+  inline qint64 size() const { return _size; }
+  /** Returns @c true if @c n bytes are available at the given offset. */
+  inline bool available(qint64 offset, qint64 n) const {
+    return (0 <= offset) && (0 <= n) && ((offset+n) <= _size);
+  }
+
+  /** Returns @c true if the given file is currently mapped by any buffer. */
+  static bool isMapped(const QString &filename);
+
+protected:
+  /** Returns the registry of mapped files (canonical path and number of mappings). */
+  static QHash<QString, int> &mappedFiles();
+  /** Guards the registry of mapped files. */
+  static QMutex &mappedFilesLock();
+
+protected:
+  /** The name of the file. */
+  QString _fileName;
+  /** Separate handle of the mapped file. */
+  QFile _mapped;
+  /** Holds the file content if it cannot be mapped. */
+  QByteArray _copy;
+  /** Pointer to the content. */
+  const uchar *_data;
+  /** Size of the content. */
+  qint64 _size;
+  /** Canonical path of the mapped file, empty if the file is not mapped. */
+  QString _mappedPath;
+};
+
+DFUFile::Buffer::Buffer()
+  : _fileName(), _mapped(), _copy(), _data(nullptr), _size(0), _mappedPath()
+{
+  // pass...
+}
+
+DFUFile::Buffer::~Buffer() {
+  if (_mappedPath.isEmpty())
+    return;
+  QMutexLocker locker(&mappedFilesLock());
+  if (0 == --mappedFiles()[_mappedPath])
+    mappedFiles().remove(_mappedPath);
+}
+
+QHash<QString, int> &
+DFUFile::Buffer::mappedFiles() {
+  static QHash<QString, int> files;
+  return files;
+}
+
+QMutex &
+DFUFile::Buffer::mappedFilesLock() {
+  static QMutex lock;
+  return lock;
+}
+
+bool
+DFUFile::Buffer::isMapped(const QString &filename) {
+  QString path = QFileInfo(filename).canonicalFilePath();
+  if (path.isEmpty())
+    return false;
+  QMutexLocker locker(&mappedFilesLock());
+  return mappedFiles().contains(path);
+}
+
+bool
+DFUFile::Buffer::load(QFile &file, QString &errorMessage) {
+  _fileName = file.fileName();
+  qint64 start = file.pos();
+
+  if ((! file.isSequential()) && (! _fileName.isEmpty())) {
+    _mapped.setFileName(_fileName);
+    if (_mapped.open(QIODevice::ReadOnly) && (start < _mapped.size())) {
+      _size = _mapped.size()-start;
+      _data = _mapped.map(start, _size);
+      if (nullptr != _data) {
+        // Register mapping, the file must not be truncated while mapped
+        _mappedPath = QFileInfo(_fileName).canonicalFilePath();
+        QMutexLocker locker(&mappedFilesLock());
+        mappedFiles()[_mappedPath]++;
+        return true;
+      }
+    }
+    _mapped.close();
+  }
+
+  // Fallback, read remaining content at once
+  _copy = file.readAll();
+  if (QFileDevice::NoError != file.error()) {
+    errorMessage = DFUFile::tr("Cannot read DFU file '%1': %2").arg(_fileName).arg(file.errorString());
+    return false;
+  }
+  _data = (const uchar *)_copy.constData();
+  _size = _copy.size();
+  return true;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of DFUFile::Writer
+ * ********************************************************************************************* */
+class DFUFile::Writer
+{
+public:
+  /** Constructs a writer for the given file. */
+  Writer(QFile &file);
+
+  /** Writes the given data and updates the CRC. Small blocks are collected and written at once,
+   * large blocks are written directly. */
+  bool write(const void *data, qint64 len);
+  /** Writes all buffered data. */
+  bool flush();
+
+  /** Returns the CRC over all data written so far. */
+  inline uint32_t crc() { return _crc.get(); }
+  /** Returns the name of the file. */
+  inline QString fileName() const { return _file.fileName(); }
+  /** Returns the last error of the file. */
+  inline QString errorString() const { return _file.errorString(); }
+
+protected:
+  /** The destination file. */
+  QFile &_file;
+  /** The CRC over the data written so far. */
+  CRC32 _crc;
+  /** The write buffer. */
+  QByteArray _buffer;
+  /** Number of bytes used in the write buffer. */
+  qint64 _used;
+};
+
+DFUFile::Writer::Writer(QFile &file)
+  : _file(file), _crc(), _buffer(WRITE_BUFFER_SIZE, 0), _used(0)
+{
+  // pass...
+}
+
+bool
+DFUFile::Writer::write(const void *data, qint64 len) {
+  _crc.update((const uint8_t *)data, len);
+
+  if (len >= WRITE_BUFFER_SIZE) {
+    if (! flush())
+      return false;
+    return len == _file.write((const char *)data, len);
+  }
+
+  if ((_used+len) > WRITE_BUFFER_SIZE) {
+    if (! flush())
+      return false;
+  }
+
+  memcpy(_buffer.data()+_used, data, len);
+  _used += len;
+  return true;
+}
+
+bool
+DFUFile::Writer::flush() {
+  if (0 == _used)
+    return true;
+  if (_used != _file.write(_buffer.constData(), _used))
+    return false;
+  _used = 0;
+  return true;
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of DFUFile
  * ********************************************************************************************* */
@@ -124,19 +322,25 @@ DFUFile::read(const QString &filename, const ErrorStack &err) {
 bool
 DFUFile::read(QFile &file, const ErrorStack &err)
 {
-  CRC32 crc;
-
   _images.clear();
 
+  qint64 start = file.pos();
+  QSharedPointer<Buffer> buffer(new Buffer());
+  QString errorMessage;
+  if (! buffer->load(file, errorMessage)) {
+    errMsg(err) << errorMessage;
+    return false;
+  }
+
+  qint64 offset = 0;
   file_prefix_t prefix;
-  if (sizeof(file_prefix_t) != file.read((char *)&prefix, sizeof(file_prefix_t))) {
-    errMsg(err) << "Cannot read suffix: " << file.errorString() << ".";
+  if (! buffer->available(offset, sizeof(file_prefix_t))) {
+    errMsg(err) << "Cannot read prefix: Unexpected end of file.";
     errMsg(err) << "Cannot read DFU file '" << file.fileName() << "'.";
     return false;
   }
-
-  // update crc
-  crc.update((const uint8_t *)&prefix, sizeof(file_prefix_t));
+  memcpy(&prefix, buffer->data()+offset, sizeof(file_prefix_t));
+  offset += sizeof(file_prefix_t);
 
   if (memcmp(prefix.signature, "DfuSe", 5)) {
     errMsg(err) << "Invalid DFU file signature. Not a DFU file?";
@@ -147,24 +351,24 @@ DFUFile::read(QFile &file, const ErrorStack &err)
   uint32_t filesize = qFromLittleEndian(prefix.image_size);
   uint8_t  n_images = prefix.n_targets;
 
+  // Images are read in place, avoids copying the element vectors
+  _images.reserve(n_images);
   for (uint8_t i=0; i<n_images; i++) {
-    Image img; QString errorMessage;
-    if (! img.read(file, crc, errorMessage)) {
+    _images.append(Image());
+    if (! _images.last().read(buffer, offset, errorMessage)) {
       errMsg(err) << errorMessage;
       return false;
     }
-    _images.append(img);
   }
 
   file_suffix_t suffix;
-  if (sizeof(file_suffix_t) != file.read((char *)&suffix, sizeof(suffix))) {
-    errMsg(err) << "Cannot read suffix: " << file.errorString() << ".";
+  if (! buffer->available(offset, sizeof(file_suffix_t))) {
+    errMsg(err) << "Cannot read suffix: Unexpected end of file.";
     errMsg(err) << "Cannot read DFU file '" << file.fileName() << "'.";
     return false;
   }
-
-  // Update CRC with suffix excl. CRC itself
-  crc.update((const uint8_t *) &suffix, sizeof(file_suffix_t)-4);
+  memcpy(&suffix, buffer->data()+offset, sizeof(file_suffix_t));
+  offset += sizeof(file_suffix_t);
 
   if (filesize != (size()-sizeof(file_suffix_t))) {
     errMsg(err) << "Filesize " << (size()-sizeof(file_suffix_t))
@@ -179,17 +383,33 @@ DFUFile::read(QFile &file, const ErrorStack &err)
     return false;
   }
 
-  if (crc.get() != suffix.crc) {
+  // The file got parsed completely, compute CRC over entire file excl. CRC itself in one pass
+  CRC32 crc;
+  crc.update(buffer->data(), offset-4);
+  if (crc.get() != qFromLittleEndian(suffix.crc)) {
     errMsg(err) << "Invalid checksum got " << QString::number(unsigned(suffix.crc),16)
                 << " expected " << QString::number(unsigned(crc.get())) << ".";
     errMsg(err) << "Cannot read DFU file '" << file.fileName() << "'.";
     return false;
   }
+
+  // Leave the file at the end of the DFU file, as if it was read sequentially
+  if (! file.isSequential())
+    file.seek(start+offset);
+
   return true;
 }
 
 bool
 DFUFile::write(const QString &filename, const ErrorStack &err) {
+  // Elements must not refer to the file being truncated
+  release(filename);
+  // Any other mapping of the file would fault on access once the file got truncated
+  if (Buffer::isMapped(filename)) {
+    errMsg(err) << "Cannot write DFU file '" << filename << "': File is still in use.";
+    return false;
+  }
+
   QFile file(filename);
   if (! file.open(QIODevice::WriteOnly)) {
     errMsg(err) << "Cannot create DFU file '" << filename << "': " << file.errorString() << ".";
@@ -210,18 +430,16 @@ DFUFile::write(QFile &file, const ErrorStack &err) {
   prefix.image_size = qToLittleEndian(uint32_t(size()-sizeof(file_suffix_t)));
   prefix.n_targets = _images.size();
 
-  if (sizeof(file_prefix_t) != file.write((char *)&prefix, sizeof(file_prefix_t))) {
+  Writer writer(file);
+  if (! writer.write(&prefix, sizeof(file_prefix_t))) {
     errMsg(err) << "Cannot write DFU prefix to '" << file.fileName()
                 << "': " << file.errorString() << ".";
     return false;
   }
 
-  CRC32 crc;
-  crc.update((uint8_t *)&prefix, sizeof(file_prefix_t));
-
   foreach (const Image &i, _images) {
     QString errorMessage;
-    if (! i.write(file, crc, errorMessage)) {
+    if (! i.write(writer, errorMessage)) {
       errMsg(err) << errorMessage;
       return false;
     }
@@ -236,10 +454,11 @@ DFUFile::write(QFile &file, const ErrorStack &err) {
   memcpy(suffix.signature, "UFD", 3);
   suffix.size = 16;
 
-  crc.update((uint8_t *) &suffix, sizeof(file_suffix_t)-4);
-  suffix.crc = qToLittleEndian(crc.get());
-
-  if (sizeof(file_suffix_t) != file.write((char *)&suffix, sizeof(file_suffix_t))) {
+  // Write suffix excl. CRC first, then the CRC over everything written so far
+  bool ok = writer.write(&suffix, sizeof(file_suffix_t)-4);
+  suffix.crc = qToLittleEndian(writer.crc());
+  ok = ok && writer.write(&suffix.crc, 4) && writer.flush();
+  if (! ok) {
     errMsg(err) << "Cannot write DFU suffix to '" << file.fileName()
                 << "': " << file.errorString() << ".";
     return false;
@@ -269,6 +488,28 @@ DFUFile::data(uint32_t offset, uint32_t img) const {
   return image(img).data(offset);
 }
 
+void
+DFUFile::detach() {
+  for (int i=0; i<_images.size(); i++) {
+    Image &img = image(i);
+    for (int j=0; j<img.numElements(); j++)
+      img.element(j).data().data();
+  }
+}
+
+void
+DFUFile::release(const QString &filename) {
+  QFileInfo info(filename);
+  if (! info.exists())
+    return;
+  for (int i=0; i<_images.size(); i++) {
+    Image &img = image(i);
+    for (int j=0; j<img.numElements(); j++)
+      if (img.element(j).refersTo(info))
+        img.element(j).release();
+  }
+}
+
 void
 DFUFile::dump(QTextStream &stream) const {
   stream << "DFU file with " << _images.size() << " images:\n";
@@ -282,19 +523,19 @@ DFUFile::dump(QTextStream &stream) const {
  * Implementation of DFUFile::Element
  * ********************************************************************************************* */
 DFUFile::Element::Element()
-  : _address(0), _data()
+  : _address(0), _data(), _buffer()
 {
   // pass...
 }
 
 DFUFile::Element::Element(uint32_t addr, uint32_t size)
-  : _address(addr), _data(size, 0x00)
+  : _address(addr), _data(size, 0x00), _buffer()
 {
   // pass...
 }
 
 DFUFile::Element::Element(const Element &other)
-  : _address(other._address), _data(other._data)
+  : _address(other._address), _data(other._data), _buffer(other._buffer)
 {
   // pass...
 }
@@ -303,6 +544,7 @@ DFUFile::Element &
 DFUFile::Element::operator=(const Element &other) {
   _address = other._address;
   _data = other._data;
+  _buffer = other._buffer;
   return *this;
 }
 
@@ -333,61 +575,80 @@ DFUFile::Element::isAligned(unsigned blocksize) const {
 
 const QByteArray &
 DFUFile::Element::data() const {
+  // Data may leave the element as an implicitly shared copy, it must not refer to the buffer
+  release();
   return _data;
 }
 
 QByteArray &
 DFUFile::Element::data() {
+  // Data refers to the read-only buffer, copy before it gets modified
+  release();
   return _data;
 }
 
+const char *
+DFUFile::Element::constData() const {
+  return _data.constData();
+}
+
+void
+DFUFile::Element::release() const {
+  if (_buffer.isNull())
+    return;
+  _data = QByteArray(_data.constData(), _data.size());
+  _buffer.clear();
+}
+
 bool
-DFUFile::Element::read(QFile &file, CRC32 &crc, QString &errorMessage)
+DFUFile::Element::refersTo(const QFileInfo &file) const {
+  return (! _buffer.isNull()) && (QFileInfo(_buffer->fileName()) == file);
+}
+
+bool
+DFUFile::Element::read(const QSharedPointer<Buffer> &buffer, qint64 &offset, QString &errorMessage)
 {
   // Read Element prefix:
   element_prefix_t prefix;
-  if (sizeof(element_prefix_t) != file.read((char *)&prefix, sizeof(element_prefix_t))) {
-    errorMessage = tr("Cannot read DFU file '%1': Cannot read element prefix: %2").arg(file.fileName()).arg(file.errorString());
+  if (! buffer->available(offset, sizeof(element_prefix_t))) {
+    errorMessage = tr("Cannot read DFU file '%1': Cannot read element prefix: Unexpected end of file.")
+        .arg(buffer->fileName());
     return false;
   }
-
-  crc.update((const uint8_t *) &prefix, sizeof(element_prefix_t));
+  memcpy(&prefix, buffer->data()+offset, sizeof(element_prefix_t));
 
   _address = qFromLittleEndian(prefix.address);
   uint32_t size = qFromLittleEndian(prefix.size);
 
-  _data.clear();
-  _data = file.read(size);
-
-  if (size != uint32_t(_data.size())) {
-    errorMessage = tr("Cannot read DFU file '%1': Cannot read element data: %2").arg(file.fileName()).arg(file.errorString());
+  if (! buffer->available(offset+sizeof(element_prefix_t), size)) {
+    errorMessage = tr("Cannot read DFU file '%1': Cannot read element data: Unexpected end of file.")
+        .arg(buffer->fileName());
     return false;
   }
 
-  crc.update(_data);
+  // Refer to the data within the buffer instead of copying it
+  _data = QByteArray::fromRawData((const char *)buffer->data()+offset+sizeof(element_prefix_t), size);
+  _buffer = buffer;
+  offset += sizeof(element_prefix_t) + size;
 
   return true;
 }
 
 bool
-DFUFile::Element::write(QFile &file, CRC32 &crc, QString &errorMessage) const {
+DFUFile::Element::write(Writer &writer, QString &errorMessage) const {
   element_prefix_t prefix;
   prefix.address = qToLittleEndian(_address);
   prefix.size = qToLittleEndian(uint32_t(_data.size()));
 
-  crc.update((uint8_t *) &prefix, sizeof(element_prefix_t));
-
-  if (sizeof(element_prefix_t) != file.write((const char *)&prefix, sizeof(element_prefix_t))) {
+  if (! writer.write(&prefix, sizeof(element_prefix_t))) {
     errorMessage = tr("Cannot write element prefix to file '%1': %2")
-        .arg(file.fileName()).arg(file.errorString());
+        .arg(writer.fileName()).arg(writer.errorString());
     return false;
   }
 
-  crc.update(_data);
-
-  if (_data.size() != file.write(_data)) {
+  if (! writer.write(_data.constData(), _data.size())) {
     errorMessage = tr("Cannot write element data to file '%1': %2")
-        .arg(file.fileName()).arg(file.errorString());
+        .arg(writer.fileName()).arg(writer.errorString());
     return false;
   }
 
@@ -533,7 +794,9 @@ DFUFile::Image::addElement(uint32_t addr, uint32_t size, int index) {
     _elements.append(Element(addr, size));
     _addressmap.add(addr, size);
   } else {
+    // Indices of all following elements change
     _elements.insert(index, Element(addr, size));
+    _addressmap.shiftIndices(index, 1);
     _addressmap.add(addr, size, index);
   }
 }
@@ -541,13 +804,15 @@ DFUFile::Image::addElement(uint32_t addr, uint32_t size, int index) {
 void
 DFUFile::Image::addElement(const Element &element) {
   _elements.append(element);
-  _addressmap.add(element.address(), element.size());
+  _addressmap.add(element.address(), element.memSize());
 }
 
 void
 DFUFile::Image::remElement(int i) {
   _elements.remove(i);
+  // Indices of all following elements change
   _addressmap.rem(i);
+  _addressmap.shiftIndices(i+1, -1);
 }
 
 bool
@@ -559,18 +824,19 @@ DFUFile::Image::isAligned(unsigned blocksize) const {
 }
 
 bool
-DFUFile::Image::read(QFile &file, CRC32 &crc, QString &errorMessage)
+DFUFile::Image::read(const QSharedPointer<Buffer> &buffer, qint64 &offset, QString &errorMessage)
 {
   image_prefix_t prefix;
-  if (sizeof(image_prefix_t) != file.read((char *)&prefix, sizeof(image_prefix_t))) {
-    errorMessage = tr("Cannot read DFU file '%1': Cannot read image: %2").arg(file.fileName()).arg(file.errorString());
+  if (! buffer->available(offset, sizeof(image_prefix_t))) {
+    errorMessage = tr("Cannot read DFU file '%1': Cannot read image: Unexpected end of file.")
+        .arg(buffer->fileName());
     return false;
   }
-
-  crc.update((const uint8_t *) &prefix, sizeof(image_prefix_t));
+  memcpy(&prefix, buffer->data()+offset, sizeof(image_prefix_t));
+  offset += sizeof(image_prefix_t);
 
   if (memcmp(prefix.signature, "Target", 6)) {
-    errorMessage = tr("Cannot read DFU file '%1': Invalid image signature value.").arg(file.fileName());
+    errorMessage = tr("Cannot read DFU file '%1': Invalid image signature value.").arg(buffer->fileName());
     return false;
   }
 
@@ -583,9 +849,11 @@ DFUFile::Image::read(QFile &file, CRC32 &crc, QString &errorMessage)
 
   uint32_t size = qFromLittleEndian(prefix.size);
   uint32_t n_elements = qFromLittleEndian(prefix.n_elements);
+  // Do not trust the element count blindly when reserving space
+  _elements.reserve(std::min(qint64(n_elements), (buffer->size()-offset)/qint64(sizeof(element_prefix_t))));
   for (uint32_t i=0; i<n_elements; i++) {
     Element element;
-    if (! element.read(file, crc, errorMessage))
+    if (! element.read(buffer, offset, errorMessage))
       return false;
     this->addElement(element);
   }
@@ -593,14 +861,14 @@ DFUFile::Image::read(QFile &file, CRC32 &crc, QString &errorMessage)
   // verify size:
   if (size != (this->size()-sizeof(image_prefix_t))) {
     errorMessage = tr("Cannot read DFU file '%1': Invalid image size %2b specified, expected %3b.")
-        .arg(file.fileName()).arg(size).arg(this->size()-sizeof(image_prefix_t));
+        .arg(buffer->fileName()).arg(size).arg(this->size()-sizeof(image_prefix_t));
     return false;
   }
   return true;
 }
 
 bool
-DFUFile::Image::write(QFile &file, CRC32 &crc, QString &errorMessage) const {
+DFUFile::Image::write(Writer &writer, QString &errorMessage) const {
   image_prefix_t prefix;
   memcpy(prefix.signature, "Target", 6);
   prefix.alternate_setting = _alternate_settings;
@@ -611,16 +879,14 @@ DFUFile::Image::write(QFile &file, CRC32 &crc, QString &errorMessage) const {
   prefix.size = qToLittleEndian(uint32_t(size()-sizeof(image_prefix_t)));
   prefix.n_elements = qToLittleEndian(uint32_t(_elements.size()));
 
-  crc.update((uint8_t *)&prefix, sizeof(image_prefix_t));
-
-  if (sizeof(image_prefix_t) != file.write((char *)&prefix, sizeof(image_prefix_t))) {
+  if (! writer.write(&prefix, sizeof(image_prefix_t))) {
     errorMessage = tr("Cannot write image prefix to '%1': %2.")
-        .arg(file.fileName()).arg(file.errorString());
+        .arg(writer.fileName()).arg(writer.errorString());
     return false;
   }
 
   foreach (const Element &e, _elements) {
-    if (! e.write(file, crc, errorMessage))
+    if (! e.write(writer, errorMessage))
       return false;
   }
 
@@ -634,10 +900,14 @@ DFUFile::Image::sort() {
                      return first.address()<second.address();
                    });
 
-  // Rebuild address map
+  rebuildAddressMap();
+}
+
+void
+DFUFile::Image::rebuildAddressMap() {
   _addressmap.clear();
   for (int i=0; i<_elements.size(); i++)
-    _addressmap.add(_elements[i].address(), _elements.size());
+    _addressmap.add(_elements[i].address(), _elements[i].memSize());
 }
 
 void
@@ -676,6 +946,37 @@ DFUFile::Image::data(uint32_t offset) const {
     logFatal() << "Cannot resolve offset " << QString::number(offset, 16) << "h.";
     return nullptr;
   }
-  return (unsigned char *)(element(idx).data().data()+
+  return (const unsigned char *)(element(idx).constData()+
                            (offset-element(idx).address()));
 }
+
+bool
+DFUFile::Image::differs(uint32_t offset, uint32_t size, const Image &reference) const {
+  int idx = _addressmap.find(offset), refIdx = reference._addressmap.find(offset);
+  if ((0 > idx) || (0 > refIdx))
+    return true;
+  // Block must be contained within a single element in both images
+  if ((idx != _addressmap.find(offset+size-1)) || (refIdx != reference._addressmap.find(offset+size-1)))
+    return true;
+  return 0 != memcmp(data(offset), reference.data(offset), size);
+}
+
+QList<uint32_t>
+DFUFile::Image::sectors(uint32_t sectorSize, const Image *reference) const {
+  QSet<uint32_t> sectors;
+  for (int i=0; i<numElements(); i++) {
+    uint32_t addr = element(i).address(), end = addr + element(i).memSize();
+    // Split the element at the sector boundaries
+    while (addr < end) {
+      uint32_t sector = addr - (addr % sectorSize);
+      uint32_t next = std::min(end, sector + sectorSize);
+      if ((! sectors.contains(sector)) &&
+          ((nullptr == reference) || differs(addr, next-addr, *reference)))
+        sectors.insert(sector);
+      addr = next;
+    }
+  }
+  QList<uint32_t> list = sectors.values();
+  std::sort(list.begin(), list.end());
+  return list;
+}
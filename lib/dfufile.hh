@@ -6,11 +6,12 @@
 #include <QByteArray>
 #include <QString>
 #include <QTextStream>
+#include <QSharedPointer>
 
 #include "addressmap.hh"
 #include "errorstack.hh"
 
-class CRC32;
+class QFileInfo;
 
 /** A collection of images, each consisting of one or more memory sections.
  *
@@ -74,6 +75,12 @@ class DFUFile: public QObject
 	Q_OBJECT
 
 public:
+  /** Holds the content of a DFU file being read, usually a read-only memory map of the file.
+   * Elements read from a file refer to their data within this buffer instead of copying it. */
+  class Buffer;
+  /** Buffered writer, updating the CRC while writing. */
+  class Writer;
+
   /** Represents a single element within a @c Image. */
 	class Element {
 	public:
@@ -96,15 +103,26 @@ public:
     uint32_t memSize() const;
     /** Checks if the element address and size is aligned with the given block size. */
     bool isAligned(unsigned blocksize) const;
-    /** Returns a reference to the data. */
+    /** Returns a reference to the data.
+     * If the element refers to the memory of a read file, the data gets copied first. Hence, a
+     * copy of the returned array stays valid after the file got released. */
 		const QByteArray &data() const;
-    /** Returns a reference to the data. */
+    /** Returns a reference to the data.
+     * If the element refers to the memory of a read file, the data gets copied first. */
 		QByteArray &data();
+    /** Returns a pointer to the data without copying it. The pointer is only valid as long as the
+     * element is neither modified nor destroyed. */
+    const char *constData() const;
+    /** Copies the data, if the element still refers to the memory of a read file. */
+    void release() const;
 
-    /** Reads an element from the given file and updates the CRC. */
-		bool read(QFile &file, CRC32 &crc, QString &errorMessage);
-    /** Writes an element to the given file and updates the CRC. */
-		bool write(QFile &file, CRC32 &crc, QString &errorMessage) const;
+    /** Reads an element from the given buffer at the given offset. The element data is not
+     * copied but refers to the buffer. On success, the offset is advanced past the element. */
+		bool read(const QSharedPointer<Buffer> &buffer, qint64 &offset, QString &errorMessage);
+    /** Returns @c true if the element data still refers to the memory of the given file. */
+    bool refersTo(const QFileInfo &file) const;
+    /** Writes an element using the given writer. */
+		bool write(Writer &writer, QString &errorMessage) const;
 
     /** Dumps a textual representation of the element. */
 		void dump(QTextStream &stream) const;
@@ -112,8 +130,11 @@ public:
 	protected:
     /** The address of the element. */
 		uint32_t _address;
-    /** The data of the element. */
-		QByteArray _data;
+    /** The data of the element. Copied lazily, once it leaves the element. */
+		mutable QByteArray _data;
+    /** The buffer, the data refers to. Keeps the buffer alive as long as the element refers to
+     * it. */
+    mutable QSharedPointer<Buffer> _buffer;
 	};
 
   /** Represents a single image within a @c DFUFile. */
@@ -163,10 +184,11 @@ public:
     /** Checks if all element addresses and sizes is aligned with the given block size. */
     bool isAligned(unsigned blocksize) const;
 
-    /** Reads an image from the given file and updates the CRC. */
-		bool read(QFile &file, CRC32 &crc, QString &errorMessage);
-    /** Writes this image to the given file and updates the CRC. */
-		bool write(QFile &file, CRC32 &crc, QString &errorMessage) const;
+    /** Reads an image from the given buffer at the given offset. On success, the offset is
+     * advanced past the image. */
+		bool read(const QSharedPointer<Buffer> &buffer, qint64 &offset, QString &errorMessage);
+    /** Writes this image using the given writer. */
+		bool write(Writer &writer, QString &errorMessage) const;
 
     /** Prints a textual representation of the image into the given stream. */
 		void dump(QTextStream &stream) const;
@@ -179,9 +201,23 @@ public:
     /** Returns a const pointer to the encoded raw data at the specified offset. */
     virtual const unsigned char *data(uint32_t offset) const;
 
+    /** Returns @c true if the memory block at @c offset of size @c size differs from the same block
+     * within the @c reference image. If the block is not allocated in both images, it is considered
+     * to be modified. */
+    bool differs(uint32_t offset, uint32_t size, const Image &reference) const;
+    /** Returns the sorted addresses of all sectors of size @c sectorSize covered by the elements of
+     * this image. Every sector is listed once, even if it is covered by several elements. If a
+     * @c reference image is given, only those sectors are listed, that differ from the
+     * reference. */
+    QList<uint32_t> sectors(uint32_t sectorSize, const Image *reference=nullptr) const;
+
     /** Sorts all elements with respect to their addresses. */
     void sort();
 
+  protected:
+    /** Rebuilds the address map from the elements, e.g., after the elements were reordered. */
+    void rebuildAddressMap();
+
 	protected:
     /** Alternate settings byte. */
 		uint8_t  _alternate_settings;
@@ -218,17 +254,29 @@ public:
   /** Checks if all image addresses and sizes is aligned with the given block size. */
   bool isAligned(unsigned blocksize) const;
 
+  /** Ensures, that the images and elements do not share their data with any copy of this file.
+   * Afterwards, distinct elements may be modified concurrently. */
+  void detach();
+
   /** Reads the specified DFU file.
    * @return @c false on error. */
   bool read(const QString &filename, const ErrorStack &err=ErrorStack());
   /** Reads the specified DFU file.
+   *
+   * The file gets mapped into memory (if possible) and the elements refer to their data within
+   * the mapped file. The data of an element is only copied once it gets modified or accessed via
+   * @c Element::data(). While mapped, the file must not be modified by other processes.
    * @returns @c false on error. */
   bool read(QFile &file, const ErrorStack &err=ErrorStack());
 
-  /** Writes to the specified file.
+  /** Writes to the specified file. If elements still refer to the very same file (i.e., it was
+   * read before), their data gets copied before the file is overwritten. Fails, if the file is
+   * still mapped by any other DFU file or a copy of its images, as overwriting it would
+   * invalidate that mapping.
    * @returns @c false on error. */
   bool write(const QString &filename, const ErrorStack &err=ErrorStack());
-  /** Writes to the specified file.
+  /** Writes to the specified file. The file must not be mapped by any DFU file (see
+   * @c write(const QString&, const ErrorStack&)).
    * @returns @c false on error. */
   bool write(QFile &file, const ErrorStack &err=ErrorStack());
 
@@ -243,6 +291,10 @@ public:
   /** Returns a const pointer to the encoded raw data at the specified offset. */
   virtual const unsigned char *data(uint32_t offset, uint32_t img=0) const;
 
+protected:
+  /** Copies the data of all elements referring to the given file. */
+  void release(const QString &filename);
+
 protected:
   /// The list of images.
 	QVector<Image> _images;
@@ -55,6 +55,8 @@ GD77::startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignDB::S
     return false;
   }
 
+  // Reset the job before encoding, a cancel request during the encoding must not get lost.
+  _job.reset();
   // Assemble call-sign db from user DB
   logDebug() << "Encode call-signs into db.";
   _callsigns.encode(db, selection);
@@ -94,14 +94,9 @@ GD77CallsignDB::encode(UserDatabase *calldb, const Selection &selection, const E
   if (0 == n)
     return true;
 
-  // Select first n entries and sort them in ascending order of their IDs
-  logDebug() << "Select first " << n << " entries out off " << calldb->count() << ".";
-  QVector<UserDatabase::User> users;
-  for (unsigned i=0; i<n; i++)
-    users.append(calldb->user(i));
-  logDebug() << "Sort selected w.r.t their ID in ascending order.";
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
+  // Select n entries closest to the selected IDs, in ascending order of their IDs
+  logDebug() << "Select " << n << " entries out off " << calldb->count() << ".";
+  QVector<UserDatabase::User> users = calldb->closest(selection.prefixes(), n);
 
   // Allocate segment for user db if requested
   size_t size = align_size(sizeof(userdb_t)+n*sizeof(userdb_entry_t), BLOCK_SIZE);
@@ -0,0 +1,325 @@
+#include "jsonstreamparser.hh"
+#include <QIODevice>
+#include <cstring>
+
+/** Size of the chunks read from a device. */
+#define CHUNK_SIZE 0x10000
+
+
+/* ********************************************************************************************* *
+ * Implementation of JsonStreamParser::Handler
+ * ********************************************************************************************* */
+JsonStreamParser::Handler::~Handler() {
+  // pass...
+}
+
+void
+JsonStreamParser::Handler::beginObject() {
+  // pass...
+}
+
+void
+JsonStreamParser::Handler::endObject() {
+  // pass...
+}
+
+void
+JsonStreamParser::Handler::beginArray() {
+  // pass...
+}
+
+void
+JsonStreamParser::Handler::endArray() {
+  // pass...
+}
+
+void
+JsonStreamParser::Handler::key(const QString &key) {
+  Q_UNUSED(key);
+}
+
+void
+JsonStreamParser::Handler::value(const QJsonValue &value) {
+  Q_UNUSED(value);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of JsonStreamParser
+ * ********************************************************************************************* */
+JsonStreamParser::JsonStreamParser(Handler *handler)
+  : _handler(handler), _state(State::Value), _stack(), _buffer(), _pos(0), _consumed(0),
+    _final(false)
+{
+  // pass...
+}
+
+void
+JsonStreamParser::reset() {
+  _state = State::Value;
+  _stack.clear();
+  _buffer.clear();
+  _pos = 0;
+  _consumed = 0;
+  _final = false;
+}
+
+unsigned
+JsonStreamParser::depth() const {
+  return _stack.size();
+}
+
+qint64
+JsonStreamParser::offset() const {
+  return _consumed + _pos;
+}
+
+bool
+JsonStreamParser::feed(const QByteArray &data, const ErrorStack &err) {
+  return feed(data.constData(), data.size(), err);
+}
+
+bool
+JsonStreamParser::feed(const char *data, qint64 len, const ErrorStack &err) {
+  if (State::Error == _state) {
+    errMsg(err) << "Cannot parse JSON: Parser is in error state.";
+    return false;
+  }
+  // Drop consumed data, keep incomplete tokens
+  _buffer.remove(0, _pos);
+  _consumed += _pos; _pos = 0;
+  _buffer.append(data, len);
+  return process(err);
+}
+
+bool
+JsonStreamParser::finish(const ErrorStack &err) {
+  if (State::Error == _state) {
+    errMsg(err) << "Cannot parse JSON: Parser is in error state.";
+    return false;
+  }
+  _final = true;
+  if (! process(err))
+    return false;
+  if (State::Done != _state)
+    return fail("Unexpected end of document", err);
+  return true;
+}
+
+bool
+JsonStreamParser::parse(QIODevice *device, const ErrorStack &err) {
+  QByteArray chunk;
+  while (! device->atEnd()) {
+    chunk = device->read(CHUNK_SIZE);
+    if (chunk.isEmpty()) {
+      errMsg(err) << "Cannot read JSON document: " << device->errorString();
+      return false;
+    }
+    if (! feed(chunk, err))
+      return false;
+  }
+  return finish(err);
+}
+
+bool
+JsonStreamParser::process(const ErrorStack &err) {
+  while (true) {
+    // skip whitespace
+    while ((_pos < _buffer.size()) && (' ' == _buffer[_pos] || '\n' == _buffer[_pos] ||
+                                       '\r' == _buffer[_pos] || '\t' == _buffer[_pos]))
+      _pos++;
+    if (_pos >= _buffer.size())
+      return true;
+
+    char c = _buffer[_pos];
+    switch (_state) {
+    case State::Value:
+    case State::ValueOrArrayEnd:
+      if ((']' == c) && (State::ValueOrArrayEnd == _state)) {
+        _pos++; closeContainer();
+      } else if ('{' == c) {
+        _pos++; _stack.append('{'); _state = State::KeyOrObjectEnd;
+        _handler->beginObject();
+      } else if ('[' == c) {
+        _pos++; _stack.append('['); _state = State::ValueOrArrayEnd;
+        _handler->beginArray();
+      } else if ('"' == c) {
+        QString str;
+        Token res = readString(str);
+        if (Token::Incomplete == res)
+          return true;
+        if (Token::Invalid == res)
+          return fail("Invalid string", err);
+        _handler->value(str);
+        valueDone();
+      } else if (('-' == c) || (('0' <= c) && ('9' >= c))) {
+        double number;
+        Token res = readNumber(number);
+        if (Token::Incomplete == res)
+          return true;
+        if (Token::Invalid == res)
+          return fail("Invalid number", err);
+        _handler->value(number);
+        valueDone();
+      } else {
+        QJsonValue value;
+        Token res = readLiteral(value);
+        if (Token::Incomplete == res)
+          return true;
+        if (Token::Invalid == res)
+          return fail(QString("Unexpected character '%1'").arg(c), err);
+        _handler->value(value);
+        valueDone();
+      }
+      break;
+
+    case State::KeyOrObjectEnd:
+    case State::Key:
+      if (('}' == c) && (State::KeyOrObjectEnd == _state)) {
+        _pos++; closeContainer();
+      } else if ('"' == c) {
+        QString str;
+        Token res = readString(str);
+        if (Token::Incomplete == res)
+          return true;
+        if (Token::Invalid == res)
+          return fail("Invalid key", err);
+        _handler->key(str);
+        _state = State::Colon;
+      } else {
+        return fail(QString("Expected key, got '%1'").arg(c), err);
+      }
+      break;
+
+    case State::Colon:
+      if (':' != c)
+        return fail(QString("Expected ':', got '%1'").arg(c), err);
+      _pos++; _state = State::Value;
+      break;
+
+    case State::CommaOrEnd:
+      if (',' == c) {
+        _pos++; _state = ('{' == _stack.last()) ? State::Key : State::Value;
+      } else if ((('}' == c) && ('{' == _stack.last())) || ((']' == c) && ('[' == _stack.last()))) {
+        _pos++; closeContainer();
+      } else {
+        return fail(QString("Expected ',' or end of container, got '%1'").arg(c), err);
+      }
+      break;
+
+    case State::Done:
+      return fail(QString("Unexpected character '%1' after document").arg(c), err);
+
+    case State::Error:
+      return false;
+    }
+  }
+}
+
+JsonStreamParser::Token
+JsonStreamParser::readString(QString &str) {
+  const char *data = _buffer.constData();
+  int size = _buffer.size(), start = _pos+1, i = start;
+  str.clear();
+  while (i < size) {
+    uchar c = data[i];
+    if ('"' == c) {
+      str.append(QString::fromUtf8(data+start, i-start));
+      _pos = i+1;
+      return Token::Complete;
+    } else if (0x20 > c) {
+      return Token::Invalid;
+    } else if ('\\' != c) {
+      i++;
+      continue;
+    }
+    // Handle escape sequence
+    str.append(QString::fromUtf8(data+start, i-start));
+    if ((i+1) >= size)
+      return Token::Incomplete;
+    switch (data[i+1]) {
+    case '"': str.append(QLatin1Char('"')); break;
+    case '\\': str.append(QLatin1Char('\\')); break;
+    case '/': str.append(QLatin1Char('/')); break;
+    case 'b': str.append(QLatin1Char('\b')); break;
+    case 'f': str.append(QLatin1Char('\f')); break;
+    case 'n': str.append(QLatin1Char('\n')); break;
+    case 'r': str.append(QLatin1Char('\r')); break;
+    case 't': str.append(QLatin1Char('\t')); break;
+    case 'u': {
+      if ((i+6) > size)
+        return Token::Incomplete;
+      bool ok;
+      ushort code = QByteArray(data+i+2, 4).toUShort(&ok, 16);
+      if (! ok)
+        return Token::Invalid;
+      // Surrogate pairs are simply concatenated as UTF-16 code units
+      str.append(QChar(code));
+      i += 4;
+    } break;
+    default:
+      return Token::Invalid;
+    }
+    i += 2; start = i;
+  }
+  return Token::Incomplete;
+}
+
+JsonStreamParser::Token
+JsonStreamParser::readNumber(double &number) {
+  int i = _pos, size = _buffer.size();
+  while ((i < size) && ((('0' <= _buffer[i]) && ('9' >= _buffer[i])) || ('-' == _buffer[i]) ||
+                        ('+' == _buffer[i]) || ('.' == _buffer[i]) || ('e' == _buffer[i]) ||
+                        ('E' == _buffer[i])))
+    i++;
+  // A number is only complete if followed by some other character or the end of the document
+  if ((i >= size) && (! _final))
+    return Token::Incomplete;
+  bool ok;
+  number = _buffer.mid(_pos, i-_pos).toDouble(&ok);
+  if (! ok)
+    return Token::Invalid;
+  _pos = i;
+  return Token::Complete;
+}
+
+JsonStreamParser::Token
+JsonStreamParser::readLiteral(QJsonValue &value) {
+  static const char *literals[] = {"true", "false", "null"};
+  static const QJsonValue values[] = {QJsonValue(true), QJsonValue(false), QJsonValue()};
+  for (int l=0; l<3; l++) {
+    int len = strlen(literals[l]);
+    if (literals[l][0] != _buffer[_pos])
+      continue;
+    if ((_pos+len) > _buffer.size())
+      return _final ? Token::Invalid : Token::Incomplete;
+    if (0 != memcmp(_buffer.constData()+_pos, literals[l], len))
+      return Token::Invalid;
+    value = values[l];
+    _pos += len;
+    return Token::Complete;
+  }
+  return Token::Invalid;
+}
+
+void
+JsonStreamParser::valueDone() {
+  _state = _stack.isEmpty() ? State::Done : State::CommaOrEnd;
+}
+
+void
+JsonStreamParser::closeContainer() {
+  char c = _stack.takeLast();
+  if ('{' == c)
+    _handler->endObject();
+  else
+    _handler->endArray();
+  valueDone();
+}
+
+bool
+JsonStreamParser::fail(const QString &msg, const ErrorStack &err) {
+  _state = State::Error;
+  errMsg(err) << "Cannot parse JSON at offset " << offset() << ": " << msg << ".";
+  return false;
+}
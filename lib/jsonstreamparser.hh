@@ -0,0 +1,115 @@
+#ifndef JSONSTREAMPARSER_HH
+#define JSONSTREAMPARSER_HH
+
+#include <QByteArray>
+#include <QVector>
+#include <QJsonValue>
+#include "errorstack.hh"
+
+class QIODevice;
+
+/** Incremental, event-based (SAX-style) JSON parser.
+ *
+ * In contrast to @c QJsonDocument, this parser does not materialize the complete document.
+ * Instead, the document is tokenized incrementally as data arrives via @c feed and the
+ * corresponding events are passed to a @c Handler instance. This allows to process large
+ * documents (e.g., the user database) with a memory footprint independent of the document
+ * size and even while the document is still being downloaded.
+ *
+ * @code
+ * JsonStreamParser parser(&handler);
+ * while (moreData)
+ *   if (! parser.feed(chunk, err)) return false;
+ * if (! parser.finish(err)) return false;
+ * @endcode
+ *
+ * @ingroup util */
+class JsonStreamParser
+{
+public:
+  /** Interface of all event handlers. The default implementations ignore the events. */
+  class Handler
+  {
+  public:
+    /** Destructor. */
+    virtual ~Handler();
+    /** Gets called at the beginning of an object. */
+    virtual void beginObject();
+    /** Gets called at the end of an object. */
+    virtual void endObject();
+    /** Gets called at the beginning of an array. */
+    virtual void beginArray();
+    /** Gets called at the end of an array. */
+    virtual void endArray();
+    /** Gets called for every key within an object. The value follows. */
+    virtual void key(const QString &key);
+    /** Gets called for every scalar value (string, number, boolean or null). */
+    virtual void value(const QJsonValue &value);
+  };
+
+public:
+  /** Constructs a parser passing the events to the given handler. The ownership of the handler
+   * is not taken. */
+  explicit JsonStreamParser(Handler *handler);
+
+  /** Resets the parser to parse a new document. */
+  void reset();
+
+  /** Parses the next chunk of the document. */
+  bool feed(const char *data, qint64 len, const ErrorStack &err=ErrorStack());
+  /** Parses the next chunk of the document. */
+  bool feed(const QByteArray &data, const ErrorStack &err=ErrorStack());
+  /** Signals the end of the document. Fails, if the document is incomplete. */
+  bool finish(const ErrorStack &err=ErrorStack());
+  /** Parses the complete document from the given device in chunks. */
+  bool parse(QIODevice *device, const ErrorStack &err=ErrorStack());
+
+  /** Returns the current nesting depth. */
+  unsigned depth() const;
+  /** Returns the number of bytes consumed so far. */
+  qint64 offset() const;
+
+protected:
+  /** Possible results of reading a token. */
+  enum class Token {
+    Complete, Incomplete, Invalid
+  };
+
+  /** Possible parser states. */
+  enum class State {
+    Value, ValueOrArrayEnd, KeyOrObjectEnd, Key, Colon, CommaOrEnd, Done, Error
+  };
+
+  /** Processes the buffered data as far as possible. */
+  bool process(const ErrorStack &err);
+  /** Reads a string token at the current position. */
+  Token readString(QString &str);
+  /** Reads a number token at the current position. */
+  Token readNumber(double &number);
+  /** Reads one of the literals true, false or null at the current position. */
+  Token readLiteral(QJsonValue &value);
+  /** Gets called after a complete value. */
+  void valueDone();
+  /** Closes the innermost object or array. */
+  void closeContainer();
+  /** Sets the error state and assembles the error message. */
+  bool fail(const QString &msg, const ErrorStack &err);
+
+protected:
+  /** The event handler. */
+  Handler *_handler;
+  /** The current state. */
+  State _state;
+  /** Stack of open containers ('{' or '['). */
+  QVector<char> _stack;
+  /** Buffer of data not yet consumed. */
+  QByteArray _buffer;
+  /** Current read position within the buffer. */
+  int _pos;
+  /** Number of bytes consumed and removed from the buffer. */
+  qint64 _consumed;
+  /** If @c true, the end of the document was signaled. */
+  bool _final;
+};
+
+#endif // JSONSTREAMPARSER_HH
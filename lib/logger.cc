@@ -2,27 +2,38 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDateTime>
+#include <QThread>
+#include <algorithm>
 
 
 /* ********************************************************************************************* *
  * Implementation of LogMessage
  * ********************************************************************************************* */
 LogMessage::LogMessage(Level level, const QString &file, int line, const QString &message)
-  : QTextStream(), _level(level), _file(file), _line(line), _message(message)
+  : QTextStream(), _forward(true), _level(level), _file(file), _line(line), _message(message)
+{
+  this->setString(&_message);
+  this->seek(_message.size());
+}
+
+LogMessage::LogMessage(Level level, const QString &file, int line, const QString &message, bool forward)
+  : QTextStream(), _forward(forward), _level(level), _file(file), _line(line), _message(message)
 {
   this->setString(&_message);
   this->seek(_message.size());
 }
 
 LogMessage::LogMessage(const LogMessage &other)
-  : QTextStream(), _level(other._level), _file(other._file), _line(other._line), _message(other._message)
+  : QTextStream(), _forward(other._forward), _level(other._level), _file(other._file),
+    _line(other._line), _message(other._message)
 {
   this->setString(&_message);
   this->seek(_message.size());
 }
 
 LogMessage::~LogMessage() {
-  Logger::get().log(*this);
+  if (_forward)
+    Logger::get().log(*this);
 }
 
 LogMessage::Level
@@ -59,52 +70,225 @@ LogHandler::~LogHandler() {
   // pass...
 }
 
+LogMessage::Level
+LogHandler::minLevel() const {
+  return LogMessage::DEBUG;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of LogWriter
+ * ********************************************************************************************* */
+/** The background thread writing the queued log messages.
+ * @ingroup log */
+class LogWriter: public QThread
+{
+public:
+  /** Constructs a writer for the given logger. */
+  explicit LogWriter(Logger *logger)
+    : QThread(), _logger(logger)
+  {
+    // pass...
+  }
+
+protected:
+  void run() {
+    _logger->drain();
+  }
+
+protected:
+  /** The logger to write the messages of. */
+  Logger *_logger;
+};
+
 
 /* ********************************************************************************************* *
  * Implementation of Logger
  * ********************************************************************************************* */
 Logger *Logger::_instance = nullptr;
+// Nothing gets logged until a handler is added
+QAtomicInt Logger::_minLevel(int(LogMessage::FATAL)+1);
+/** Number of nested dispatches of the current thread, non-zero while a handler is called. */
+static thread_local int dispatchDepth = 0;
 
 Logger::Logger()
-  : QObject(nullptr), _handler()
+  : QObject(nullptr), _handler(), _mutex(), _handlerMutex(QMutex::Recursive), _queueMutex(),
+    _queued(), _written(), _queue(),
+    _enqueuedCount(0), _writtenCount(0), _writer(nullptr), _stop(false)
 {
   // pass...
 }
 
 Logger::~Logger() {
+  setAsynchronous(false);
   _handler.clear();
 }
 
 void
 Logger::log(const LogMessage &msg) {
-  foreach (LogHandler *handler, _handler) {
+  // Messages logged by a handler are passed directly to the handlers. Otherwise, the handler would
+  // wait for the writer, which in turn waits for the handler.
+  if (0 < dispatchDepth) {
+    dispatch(msg);
+    return;
+  }
+
+  QMutexLocker locker(&_queueMutex);
+  // Messages logged by the writer itself are passed directly to the handlers
+  if ((nullptr == _writer) || (QThread::currentThread() == _writer)) {
+    locker.unlock();
+    dispatch(msg);
+    return;
+  }
+
+  // While the writer stops, wait for the queued messages first to keep the order
+  if (_stop) {
+    while (_writtenCount < _enqueuedCount)
+      _written.wait(&_queueMutex);
+    locker.unlock();
+    dispatch(msg);
+    return;
+  }
+
+  _queue.enqueue(Entry{msg.level(), msg.file(), msg.line(), msg.message()});
+  quint64 id = ++_enqueuedCount;
+  _queued.wakeOne();
+
+  // Keep warnings and errors in place with respect to any other output
+  if (LogMessage::WARNING <= msg.level()) {
+    while (_writtenCount < id)
+      _written.wait(&_queueMutex);
+  }
+}
+
+void
+Logger::dispatch(const LogMessage &msg) {
+  // Copy the handlers, a handler may add or remove handlers
+  QMutexLocker locker(&_mutex);
+  QList<LogHandler *> handlers = _handler;
+  locker.unlock();
+
+  // Handlers may log themselves, hence the recursive lock
+  QMutexLocker handlerLocker(&_handlerMutex);
+  dispatchDepth++;
+  foreach (LogHandler *handler, handlers) {
     handler->handle(msg);
   }
+  dispatchDepth--;
+}
+
+void
+Logger::drain() {
+  QMutexLocker locker(&_queueMutex);
+  while (true) {
+    while (_queue.isEmpty() && (! _stop))
+      _queued.wait(&_queueMutex);
+    if (_queue.isEmpty())
+      return;
+
+    // Take all queued messages at once, such that the logging threads are not blocked while the
+    // messages get written.
+    QQueue<Entry> batch;
+    batch.swap(_queue);
+    locker.unlock();
+    foreach (const Entry &entry, batch)
+      dispatch(LogMessage(entry.level, entry.file, entry.line, entry.message, false));
+    locker.relock();
+
+    _writtenCount += batch.size();
+    _written.wakeAll();
+  }
+}
+
+bool
+Logger::isAsynchronous() const {
+  QMutexLocker locker(&_queueMutex);
+  return nullptr != _writer;
+}
+
+void
+Logger::setAsynchronous(bool enable) {
+  QMutexLocker locker(&_queueMutex);
+  if (enable == (nullptr != _writer))
+    return;
+
+  if (enable) {
+    _stop = false;
+    _writer = new LogWriter(this);
+    _writer->start();
+    return;
+  }
+
+  // Let the writer finish the queue
+  _stop = true;
+  _queued.wakeOne();
+  QThread *writer = _writer;
+  locker.unlock();
+  writer->wait();
+  locker.relock();
+  _writer = nullptr;
+  _stop = false;
+  delete writer;
+}
+
+void
+Logger::flush() {
+  QMutexLocker locker(&_queueMutex);
+  if ((nullptr == _writer) || (QThread::currentThread() == _writer))
+    return;
+  quint64 id = _enqueuedCount;
+  while (_writtenCount < id)
+    _written.wait(&_queueMutex);
 }
 
 void
 Logger::addHandler(LogHandler *handler) {
   if (nullptr == handler)
     return;
-  if (_handler.contains(handler))
-    return;
-  handler->setParent(this);
-  _handler.append(handler);
-  connect(handler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
+  {
+    QMutexLocker locker(&_mutex);
+    if (_handler.contains(handler))
+      return;
+    handler->setParent(this);
+    _handler.append(handler);
+    connect(handler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
+  }
+  updateMinLevel();
 }
 
 void
 Logger::remHandler(LogHandler *handler) {
-  if (_handler.contains(handler)) {
-    handler->setParent(nullptr);
-    disconnect(handler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
+  {
+    // Wait for any running dispatch, that may still call the handler
+    QMutexLocker handlerLocker(&_handlerMutex);
+    QMutexLocker locker(&_mutex);
+    if (_handler.contains(handler)) {
+      handler->setParent(nullptr);
+      disconnect(handler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
+    }
+    _handler.removeAll(handler);
+  }
+  updateMinLevel();
+}
+
+void
+Logger::updateMinLevel() {
+  QMutexLocker locker(&_mutex);
+  int level = int(LogMessage::FATAL)+1;
+  foreach (LogHandler *handler, _handler) {
+    level = std::min(level, int(handler->minLevel()));
   }
-  _handler.removeAll(handler);
+  _minLevel.storeRelease(level);
 }
 
 void
 Logger::onHandlerDeleted(QObject *obj) {
-  _handler.removeAll(dynamic_cast<LogHandler*>(obj));
+  {
+    QMutexLocker locker(&_mutex);
+    // The handler is already destroyed at this point, hence compare pointers only
+    _handler.removeAll(static_cast<LogHandler*>(obj));
+  }
+  updateMinLevel();
 }
 
 Logger &
@@ -116,6 +300,18 @@ Logger::get() {
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of AsyncLogging
+ * ********************************************************************************************* */
+AsyncLogging::AsyncLogging() {
+  Logger::get().setAsynchronous(true);
+}
+
+AsyncLogging::~AsyncLogging() {
+  Logger::get().setAsynchronous(false);
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of StreamLogHandler
  * ********************************************************************************************* */
@@ -133,6 +329,7 @@ StreamLogHandler::minLevel() const {
 void
 StreamLogHandler::setMinLevel(LogMessage::Level minLevel) {
   _minLevel = minLevel;
+  Logger::get().updateMinLevel();
 }
 
 void
@@ -217,6 +414,7 @@ FileLogHandler::minLevel() const {
 void
 FileLogHandler::setMinLevel(LogMessage::Level minLevel) {
   _minLevel = minLevel;
+  Logger::get().updateMinLevel();
 }
 
 void
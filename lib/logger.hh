@@ -6,22 +6,32 @@
 #include <QFile>
 #include <QTextStream>
 #include <QList>
+#include <QQueue>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
 
+class QThread;
+
+/** Constructs a log message of the given level. If no log handler accepts messages of this level,
+ * the message is neither constructed nor are its arguments evaluated. */
+#define logMessage(level) \
+  (! Logger::isEnabled(level)) ? (void)0 : LogMessageVoidify() & LogMessage(level, __FILE__, __LINE__)
 /** Constructs a debug message. */
-#define logDebug() LogMessage(LogMessage::DEBUG, __FILE__, __LINE__)
+#define logDebug() logMessage(LogMessage::DEBUG)
 /** Constructs an info message. */
-#define logInfo()  LogMessage(LogMessage::INFO, __FILE__, __LINE__)
+#define logInfo()  logMessage(LogMessage::INFO)
 /** Constructs a warning message. */
-#define logWarn()  LogMessage(LogMessage::WARNING, __FILE__, __LINE__)
+#define logWarn()  logMessage(LogMessage::WARNING)
 /** Constructs an error message. */
-#define logError() LogMessage(LogMessage::ERROR, __FILE__, __LINE__)
+#define logError() logMessage(LogMessage::ERROR)
 /** Constructs a fatal error message. */
 #ifdef __cpp_lib_stacktrace
 #include <stacktrace>
-#define logFatal() LogMessage(LogMessage::FATAL, __FILE__, __LINE__) << \
+#define logFatal() logMessage(LogMessage::FATAL) << \
   QString::fromStdString(std::to_string(std::stacktrace::current()))
 #else
-#define logFatal() LogMessage(LogMessage::FATAL, __FILE__, __LINE__)
+#define logFatal() logMessage(LogMessage::FATAL)
 #endif
 
 /** Implements a log-message.
@@ -40,6 +50,8 @@ public:
     FATAL     ///< Level for fatal error messages.
   } Level;
 
+  friend class Logger;
+
 public:
   /** Constructor.
    * @param level Specifies the level of the log message.
@@ -62,6 +74,13 @@ public:
   const QString &message() const;
 
 protected:
+  /** Constructs a message, that is not forwarded to the logger upon destruction. Used to pass
+   * queued messages to the handlers. */
+  LogMessage(Level level, const QString &file, int line, const QString &message, bool forward);
+
+protected:
+  /** If @c true, the message gets forwarded to the logger upon destruction. */
+  bool _forward;
   /** The log level. */
   Level _level;
   /** The source file. */
@@ -73,6 +92,17 @@ protected:
 };
 
 
+/** Turns a log message stream expression into a void expression. This allows the log macros to
+ * skip the message entirely using the conditional operator.
+ * @ingroup log */
+class LogMessageVoidify
+{
+public:
+  /** Consumes the log message stream. Has lower precedence than @c <<. */
+  inline void operator&(const QTextStream &) { }
+};
+
+
 /** Interface for all log message handler.
  * @ingroup log */
 class LogHandler: public QObject
@@ -84,17 +114,42 @@ public:
   explicit LogHandler(QObject *parent=nullptr);
   /** Destructor. */
   virtual ~LogHandler();
-  /** Callback to handle log messages. */
+  /** Returns the minimum level of the messages, this handler processes. Messages below the
+   * minimum level of all handlers are not even constructed. */
+  virtual LogMessage::Level minLevel() const;
+  /** Callback to handle log messages. The calls are serialized. A handler may log messages
+   * itself, these are passed to the handlers immediately. */
   virtual void handle(const LogMessage &message) = 0;
 };
 
 
 /** Singleton class to process log messages.
+ *
+ * Messages may be logged from any thread. By default, they are passed to the handlers
+ * synchronously. If enabled using @c setAsynchronous, debug and info messages are queued and
+ * passed to the handlers by a background writer thread, such that the logging thread does not wait
+ * for the output. The queue preserves the order of all messages, hence also the order of the
+ * messages logged by every thread. Warnings and errors wait until they were written, to keep them
+ * in place with respect to any other output.
+ *
  * @ingroup log */
 class Logger: public QObject
 {
   Q_OBJECT
 
+protected:
+  /** A queued log message. */
+  struct Entry {
+    /** The log level. */
+    LogMessage::Level level;
+    /** The source file. */
+    QString file;
+    /** The source line. */
+    int line;
+    /** The log message content. */
+    QString message;
+  };
+
 protected:
   /** Hidden constructor. Use @c get method to obtain an instance. */
   Logger();
@@ -109,6 +164,17 @@ public:
   void addHandler(LogHandler *handler);
   /** Removes a log-handler from the logger. The ownership is transferred back to the caller. */
   void remHandler(LogHandler *handler);
+  /** Updates the minimum level of the messages logged, must be called whenever the minimum level
+   * of any handler changes. */
+  void updateMinLevel();
+
+  /** Returns @c true if messages are written by a background thread. */
+  bool isAsynchronous() const;
+  /** Enables or disables the background writer. When disabled, all queued messages are written
+   * first. Must be disabled, before any stream, a handler writes into, gets destroyed. */
+  void setAsynchronous(bool enable);
+  /** Waits until all queued messages were written. */
+  void flush();
 
 protected slots:
   /** Internal callback to handle deleted handler objects. */
@@ -117,12 +183,60 @@ protected slots:
 public:
   /** Factory method to get the singleton instance. */
   static Logger &get();
+  /** Returns @c true if any handler accepts messages of the given level. */
+  static inline bool isEnabled(LogMessage::Level level) {
+    return int(level) >= _minLevel.loadAcquire();
+  }
+
+protected:
+  /** Passes the given message to all handlers. */
+  void dispatch(const LogMessage &msg);
+  /** Main loop of the background writer. */
+  void drain();
 
 protected:
   /** The singleton instance. */
   static Logger *_instance;
+  /** The minimum level of all handlers. */
+  static QAtomicInt _minLevel;
   /** The list of registered log-handler. */
   QList<LogHandler *> _handler;
+  /** Protects the list of handlers. */
+  QMutex _mutex;
+  /** Serializes the calls to the handlers, as messages may be logged from several threads. It is
+   * recursive, as a handler may log itself. */
+  QMutex _handlerMutex;
+  /** Protects the queue and the writer state. */
+  mutable QMutex _queueMutex;
+  /** Signals queued messages to the writer. */
+  QWaitCondition _queued;
+  /** Signals written messages to waiting threads. */
+  QWaitCondition _written;
+  /** Messages queued for the writer. */
+  QQueue<Entry> _queue;
+  /** Number of messages queued so far. */
+  quint64 _enqueuedCount;
+  /** Number of queued messages written so far. */
+  quint64 _writtenCount;
+  /** The background writer, @c nullptr if messages are written synchronously. */
+  QThread *_writer;
+  /** If @c true, the writer stops once the queue is empty. */
+  bool _stop;
+
+  friend class LogWriter;
+};
+
+
+/** Enables the asynchronous logging for its lifetime. Must be destroyed before the streams the
+ * log handlers write into.
+ * @ingroup log */
+class AsyncLogging
+{
+public:
+  /** Enables the background writer of the logger. */
+  AsyncLogging();
+  /** Writes all queued messages and disables the background writer. */
+  ~AsyncLogging();
 };
 
 
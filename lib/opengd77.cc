@@ -9,7 +9,8 @@
 RadioLimits *OpenGD77::_limits = nullptr;
 
 OpenGD77::OpenGD77(OpenGD77Interface *device, QObject *parent)
-  : Radio(parent), _name("Open GD-77"), _dev(device), _config(nullptr), _codeplug(), _callsigns()
+  : Radio(parent), _name("Open GD-77"), _dev(device), _codeplugFlags(), _config(nullptr), _codeplug(),
+    _callsigns()
 {
   // pass...
 }
@@ -65,6 +66,7 @@ OpenGD77::startDownload(bool blocking, const ErrorStack &err) {
 
   _task = StatusDownload;
   _errorStack = err;
+  _job.reset();
 
   if (blocking) {
     run();
@@ -82,8 +84,6 @@ OpenGD77::startDownload(bool blocking, const ErrorStack &err) {
 
 bool
 OpenGD77::startUpload(Config *config, bool blocking, const Codeplug::Flags &flags, const ErrorStack &err) {
-  Q_UNUSED(flags)
-
   logDebug() << "Start upload to " << name() << "...";
 
   if (StatusIdle != _task) {
@@ -97,7 +97,9 @@ OpenGD77::startUpload(Config *config, bool blocking, const Codeplug::Flags &flag
   }
 
   _task = StatusUpload;
+  _codeplugFlags = flags;
   _errorStack = err;
+  _job.reset();
 
   if (blocking) {
     run();
@@ -122,6 +124,8 @@ OpenGD77::startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignD
     return false;
   }
 
+  // Reset the job before encoding, a cancel request during the encoding must not get lost.
+  _job.reset();
   // Assemble call-sign db from user DB
   logDebug() << "Encode call-signs into db.";
   _callsigns.encode(db, selection);
@@ -236,6 +240,7 @@ OpenGD77::download()
 
   // Then download codeplug
   size_t bcount = 0;
+  _job.beginPhase(tr("Read codeplug"), totb, BSIZE);
   for (int image=0; image<_codeplug.numImages(); image++) {
     uint32_t bank = (0 == image) ? OpenGD77Codeplug::EEPROM : OpenGD77Codeplug::FLASH;
 
@@ -250,6 +255,8 @@ OpenGD77::download()
           return false;
         }
         QThread::usleep(100);
+        if (! _job.advance(BSIZE, _errorStack))
+          return false;
         emit downloadProgress(float(bcount*100)/totb);
       }
     }
@@ -285,6 +292,7 @@ OpenGD77::upload()
 
   // Then download codeplug
   size_t bcount = 0;
+  _job.beginPhase(tr("Read codeplug"), totb, BSIZE);
   for (int image=0; image<_codeplug.numImages(); image++) {
     uint32_t bank = ( (0 == image) ? OpenGD77Codeplug::EEPROM : OpenGD77Codeplug::FLASH );
 
@@ -298,12 +306,23 @@ OpenGD77::upload()
           return false;
         }
         QThread::usleep(100);
+        if (! _job.advance(BSIZE, _errorStack))
+          return false;
         emit uploadProgress(float(bcount*50)/totb);
       }
     }
     _dev->read_finish();
   }
 
+  // Keep a copy of the codeplug read from the device for delta uploads. The element data is
+  // implicitly shared, hence this is cheap until the encoder modifies an element.
+  bool delta = _codeplugFlags.deltaUpload;
+  QVector<DFUFile::Image> original;
+  if (delta) {
+    for (int image=0; image<_codeplug.numImages(); image++)
+      original.append(_codeplug.image(image));
+  }
+
   // Encode config into codeplug
   _codeplug.encode(_config);
 
@@ -312,7 +331,9 @@ OpenGD77::upload()
     return false;
   }
 
-  // Then upload codeplug
+  // Then upload codeplug, skipped blocks count as transferred
+  size_t skipped = 0;
+  _job.beginPhase(tr("Write codeplug"), totb, BSIZE);
   for (int image=0; image<_codeplug.numImages(); image++) {
     uint32_t bank = (0 == image) ? OpenGD77Codeplug::EEPROM : OpenGD77Codeplug::FLASH;
 
@@ -322,17 +343,31 @@ OpenGD77::upload()
       unsigned b0 = addr/BSIZE, nb = size/BSIZE;
 
       for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
+        // Skip unchanged blocks
+        if (delta && (! _codeplug.image(image).differs((b0+b)*BSIZE, BSIZE, original[image]))) {
+          skipped++;
+          if (! _job.advance(BSIZE, _errorStack))
+            return false;
+          continue;
+        }
         if (! _dev->write(bank, (b0+b)*BSIZE, _codeplug.data((b0+b)*BSIZE, image), BSIZE, _errorStack)) {
           errMsg(_errorStack) << "Cannot write block " << (b0+b) << ".";
           return false;
         }
         QThread::usleep(100);
+        if (! _job.advance(BSIZE, _errorStack))
+          return false;
         emit uploadProgress(float(bcount*50)/totb);
       }
     }
     _dev->write_finish();
   }
 
+  if (delta) {
+    logInfo() << "Delta upload skipped " << skipped << " of " << (bcount-totb)/BSIZE
+              << " unchanged blocks.";
+  }
+
   return true;
 }
 
@@ -356,6 +391,7 @@ OpenGD77::uploadCallsigns()
   }
 
   unsigned bcount = 0;
+  _job.beginPhase(tr("Write call-sign DB"), totb, BSIZE);
   // Then upload callsign DB
   for (int n=0; n<_callsigns.image(0).numElements(); n++) {
     unsigned addr = _callsigns.image(0).element(n).address();
@@ -368,6 +404,8 @@ OpenGD77::uploadCallsigns()
         errMsg(_errorStack) << "Cannot write block " << (b0+b) << ".";
         return false;
       }
+      if (! _job.advance(BSIZE, _errorStack))
+        return false;
       emit uploadProgress(float(bcount*100)/totb);
     }
   }
@@ -59,6 +59,8 @@ protected:
 	QString _name;
   /** The interface to the radio. */
   OpenGD77Interface *_dev;
+  /** Holds the flags to control assembly and upload of code-plugs. */
+  Codeplug::Flags _codeplugFlags;
   /** The generic configuration. */
 	Config *_config;
   /** The actual binary codeplug representation. */
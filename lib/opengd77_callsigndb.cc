@@ -99,12 +99,8 @@ OpenGD77CallsignDB::encode(UserDatabase *calldb, const Selection &selection, con
   if (0 == n)
     return true;
 
-  // Select first n entries and sort them in ascending order of their IDs
-  QVector<UserDatabase::User> users;
-  for (unsigned i=0; i<n; i++)
-    users.append(calldb->user(i));
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
+  // Select n entries closest to the selected IDs, in ascending order of their IDs
+  QVector<UserDatabase::User> users = calldb->closest(selection.prefixes(), n);
 
   // Allocate segment for user db if requested
   unsigned size = align_size(sizeof(userdb_t)+n*sizeof(userdb_entry_t), BLOCK_SIZE);
@@ -58,6 +58,7 @@ OpenRTX::startDownload(bool blocking, const ErrorStack &err) {
   }
 
   _task = StatusDownload;
+  _job.reset();
 
   if (blocking) {
     run();
@@ -90,6 +91,7 @@ OpenRTX::startUpload(Config *config, bool blocking, const Codeplug::Flags &flags
   }
 
   _task = StatusUpload;
+  _job.reset();
   if (blocking) {
     run();
     return (StatusIdle == _task);
@@ -211,6 +213,7 @@ OpenRTX::download(const ErrorStack &err)
 
   // Then download codeplug
   size_t bcount = 0;
+  _job.beginPhase(tr("Read codeplug"), totb, BSIZE);
   for (int image=0; image<_codeplug.numImages(); image++) {
     uint32_t bank = 0;
 
@@ -225,6 +228,8 @@ OpenRTX::download(const ErrorStack &err)
           return false;
         }
         QThread::usleep(100);
+        if (! _job.advance(BSIZE, err))
+          return false;
         emit downloadProgress(float(bcount*100)/totb);
       }
     }
@@ -261,6 +266,7 @@ OpenRTX::upload(const ErrorStack &err)
 
   // Then download codeplug
   size_t bcount = 0;
+  _job.beginPhase(tr("Read codeplug"), totb, BSIZE);
   for (int image=0; image<_codeplug.numImages(); image++) {
     uint32_t bank = 0;
 
@@ -274,6 +280,8 @@ OpenRTX::upload(const ErrorStack &err)
           return false;
         }
         QThread::usleep(100);
+        if (! _job.advance(BSIZE, err))
+          return false;
         emit uploadProgress(float(bcount*50)/totb);
       }
     }
@@ -289,6 +297,7 @@ OpenRTX::upload(const ErrorStack &err)
   }
 
   // Then upload codeplug
+  _job.beginPhase(tr("Write codeplug"), totb, BSIZE);
   for (int image=0; image<_codeplug.numImages(); image++) {
     uint32_t bank = 0;
 
@@ -303,6 +312,8 @@ OpenRTX::upload(const ErrorStack &err)
           return false;
         }
         QThread::usleep(100);
+        if (! _job.advance(BSIZE, err))
+          return false;
         emit uploadProgress(float(bcount*50)/totb);
       }
     }
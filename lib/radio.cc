@@ -27,7 +27,7 @@
  * Implementation of Radio
  * ******************************************************************************************** */
 Radio::Radio(QObject *parent)
-  : QThread(parent), _task(StatusIdle)
+  : QThread(parent), _task(StatusIdle), _errorStack(), _job()
 {
   // pass...
 }
@@ -152,3 +152,13 @@ const ErrorStack &
 Radio::errorStack() const {
   return _errorStack;
 }
+
+TransferJob *
+Radio::job() {
+  return &_job;
+}
+
+void
+Radio::cancel() {
+  _job.cancel();
+}
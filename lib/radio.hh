@@ -14,6 +14,7 @@
 #include "codeplug.hh"
 #include "callsigndb.hh"
 #include "errorstack.hh"
+#include "transferjob.hh"
 
 class Config;
 class UserDatabase;
@@ -75,6 +76,11 @@ public:
    * @c startUploadCallsignDB. It contains the error messages from the upload/download process. */
   const ErrorStack &errorStack() const;
 
+  /** Returns the job tracking the progress of the current transfer. Its @c progressed signal
+   * reports the transferred bytes and blocks, the throughput and the estimated time remaining of
+   * the current phase. */
+  TransferJob *job();
+
 public:
   /** Tries to detect the radio connected to the specified interface or constructs the specified
    * radio using the @c RadioInfo passed by @c force. */
@@ -97,6 +103,10 @@ public slots:
       const CallsignDB::Selection &selection=CallsignDB::Selection(),
       const ErrorStack &err=ErrorStack()) = 0;
 
+  /** Cancels the current transfer. The transfer stops at the next block, the radio gets rebooted
+   * and the error signal of the transfer is emitted. May be called from any thread. */
+  void cancel();
+
 signals:
   /** Gets emitted once the codeplug download has been started. */
 	void downloadStarted();
@@ -121,6 +131,8 @@ protected:
   Status _task;
   /** The error stack. */
   ErrorStack _errorStack;
+  /** Tracks the progress and allows to cancel the current transfer. */
+  TransferJob _job;
 };
 
 #endif // RADIO_HH
@@ -31,6 +31,7 @@ RadioddityRadio::startDownload(bool blocking, const ErrorStack &err) {
 
   _task = StatusDownload;
   _errorStack = err;
+  _job.reset();
 
   if (blocking) {
     run();
@@ -51,6 +52,7 @@ RadioddityRadio::startUpload(Config *config, bool blocking, const Codeplug::Flag
 
   _task = StatusUpload;
   _codeplugFlags = flags;
+  _job.reset();
   if (blocking) {
     this->run();
     return (StatusIdle == _task);
@@ -144,6 +146,7 @@ RadioddityRadio::download() {
   }
 
   unsigned bcount = 0;
+  _job.beginPhase(tr("Read codeplug"), btot*BSIZE, BSIZE);
   for (int n=0; n<codeplug().image(0).numElements(); n++) {
     int b0 = codeplug().image(0).element(n).address()/BSIZE;
     int nb = codeplug().image(0).element(n).data().size()/BSIZE;
@@ -157,6 +160,8 @@ RadioddityRadio::download() {
         errMsg(_errorStack) << "Cannot download codeplug.";
         return false;
       }
+      if (! _job.advance(BSIZE, _errorStack))
+        return false;
       emit downloadProgress(float(bcount*100)/btot);
     }
   }
@@ -177,6 +182,7 @@ RadioddityRadio::upload() {
   unsigned bcount = 0;
   if (_codeplugFlags.updateCodePlug) {
     // If codeplug gets updated, download codeplug from device first:
+    _job.beginPhase(tr("Read codeplug"), btot*BSIZE, BSIZE);
     for (int n=0; n<codeplug().image(0).numElements(); n++) {
       int b0 = codeplug().image(0).element(n).address()/BSIZE;
       int nb = codeplug().image(0).element(n).data().size()/BSIZE;
@@ -190,25 +196,43 @@ RadioddityRadio::upload() {
           errMsg(_errorStack) << "Cannot upload codeplug.";
           return false;
         }
+        if (! _job.advance(BSIZE, _errorStack))
+          return false;
         emit uploadProgress(float(bcount*50)/btot);
       }
     }
   }
 
+  // Keep a copy of the codeplug read from the device for delta uploads. The element data is
+  // implicitly shared, hence this is cheap until the encoder modifies an element.
+  bool delta = _codeplugFlags.updateCodePlug && _codeplugFlags.deltaUpload;
+  DFUFile::Image original;
+  if (delta)
+    original = codeplug().image(0);
+
   // Encode config into codeplug
   if (! codeplug().encode(_config, _codeplugFlags, _errorStack)) {
     errMsg(_errorStack) << "Codeplug upload failed.";
     return false;
   }
 
-  // then, upload modified codeplug
+  // then, upload modified codeplug, skipped blocks count as transferred
+  _job.beginPhase(tr("Write codeplug"), btot*BSIZE, BSIZE);
   bcount = 0;
+  unsigned skipped = 0;
   for (int n=0; n<codeplug().image(0).numElements(); n++) {
     int b0 = codeplug().image(0).element(n).address()/BSIZE;
     int nb = codeplug().image(0).element(n).data().size()/BSIZE;
     for (int i=0; i<nb; i++, bcount++) {
       // Select bank by addr
       uint32_t addr = (b0+i)*BSIZE;
+      // Skip unchanged blocks
+      if (delta && (! codeplug().image(0).differs(addr, BSIZE, original))) {
+        skipped++;
+        if (! _job.advance(BSIZE, _errorStack))
+          return false;
+        continue;
+      }
       RadioddityInterface::MemoryBank bank = (
             (0x10000 > addr) ? RadioddityInterface::MEMBANK_CODEPLUG_LOWER : RadioddityInterface::MEMBANK_CODEPLUG_UPPER );
       // write block
@@ -216,10 +240,15 @@ RadioddityRadio::upload() {
         errMsg(_errorStack) << "Cannot upload codeplug.";
         return false;
       }
+      if (! _job.advance(BSIZE, _errorStack))
+        return false;
       emit uploadProgress(50+float(bcount*50)/btot);
     }
   }
 
+  if (delta)
+    logInfo() << "Delta upload skipped " << skipped << " of " << bcount << " unchanged blocks.";
+
   return true;
 }
 
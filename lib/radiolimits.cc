@@ -520,6 +520,11 @@ RadioLimitItem::add(const QString &prop, RadioLimitElement *structure) {
   return true;
 }
 
+const RadioLimitElement *
+RadioLimitItem::element(const QString &prop) const {
+  return _elements.value(prop, nullptr);
+}
+
 bool
 RadioLimitItem::verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const {
   if (! prop.isReadable()) {
@@ -774,6 +779,14 @@ RadioLimitList::verify(const ConfigItem *item, const QMetaProperty &prop, RadioL
   return true;
 }
 
+qint64
+RadioLimitList::maxCount(const QMetaObject &type) const {
+  QString className = findClassName(type);
+  if (className.isEmpty())
+    return -1;
+  return _maxCount.value(className, -1);
+}
+
 QString
 RadioLimitList::findClassName(const QMetaObject &type) const {
   if (_elements.contains(type.className()))
@@ -417,6 +417,9 @@ public:
    * @param structure Specifies the structure declaration of the property value.
    * @returns @c false If a property with the same name is already defined. */
   bool add(const QString &prop, RadioLimitElement *structure);
+  /** Returns the structure declaration of the specified property or @c nullptr if the property
+   * is not declared. */
+  const RadioLimitElement *element(const QString &prop) const;
 
   virtual bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
   /** Verifies the properties of the given item. */
@@ -594,6 +597,10 @@ public:
 
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
 
+  /** Returns the maximum number of elements of the specified type (or one of its super-classes).
+   * @returns -1 if unlimited or if the type is not allowed. */
+  qint64 maxCount(const QMetaObject &type) const;
+
 protected:
   /** Searches for the specified type or one of its super-clsases in the set of allowed types. */
   QString findClassName(const QMetaObject &type) const;
@@ -2,10 +2,12 @@
 #include <QStandardPaths>
 #include <QFileInfo>
 #include "logger.hh"
-#include <QJsonDocument>
-#include <QJsonObject>
+#include "jsonstreamparser.hh"
+#include "backgroundtask.hh"
+#include <QSaveFile>
 #include <QNetworkReply>
 #include <QDir>
+#include <QHash>
 
 
 /* ********************************************************************************************* *
@@ -24,19 +26,125 @@ TalkGroupDatabase::TalkGroup::TalkGroup(const QString &name, unsigned number)
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of TalkGroupDatabase::Ingest
+ * ********************************************************************************************* */
+/** Collects the talk groups while parsing the JSON talk group database, either from a file or
+ * from the running download. The document is expected as @c {"id":"name",...}. Malformed
+ * entries are skipped and counted. If an ID occurs several times, the last entry wins. */
+class TalkGroupDatabase::Ingest: public JsonStreamParser::Handler
+{
+public:
+  /** Constructor. */
+  Ingest()
+    : parser(this), talkgroups(), skipped(0), ok(true), err(), file(), _level(0), _key(),
+      _isObject(false), _indices()
+  {
+    // pass...
+  }
+
+  void beginObject() {
+    if (0 == _level)
+      _isObject = true;
+    if (1 == _level)
+      skipped++;
+    _level++;
+  }
+
+  void endObject() {
+    _level--;
+  }
+
+  void beginArray() {
+    if (1 == _level)
+      skipped++;
+    _level++;
+  }
+
+  void endArray() {
+    _level--;
+  }
+
+  void key(const QString &key) {
+    if (1 == _level)
+      _key = key;
+  }
+
+  void value(const QJsonValue &value) {
+    if (1 != _level)
+      return;
+    bool ok;
+    unsigned id = _key.toUInt(&ok);
+    if ((! ok) || (! value.isString())) {
+      skipped++;
+      return;
+    }
+    if (_indices.contains(id)) {
+      talkgroups[_indices[id]] = TalkGroup(value.toString(), id);
+      return;
+    }
+    _indices.insert(id, talkgroups.size());
+    talkgroups.append(TalkGroup(value.toString(), id));
+  }
+
+  /** Checks, whether the parsed document is a JSON object. */
+  bool isObject(const ErrorStack &err=ErrorStack()) const {
+    if (! _isObject)
+      errMsg(err) << "JSON document is not an object!";
+    return _isObject;
+  }
+
+public:
+  /** The parser feeding this handler. */
+  JsonStreamParser parser;
+  /** The collected talk groups. */
+  QVector<TalkGroup> talkgroups;
+  /** Number of skipped, malformed entries. */
+  unsigned skipped;
+  /** If @c false, the parser failed. Used while downloading. */
+  bool ok;
+  /** Holds the parser errors. */
+  ErrorStack err;
+  /** The file, the downloaded document is written to. */
+  QSaveFile file;
+
+protected:
+  /** Current nesting level. */
+  unsigned _level;
+  /** The last key. */
+  QString _key;
+  /** If @c true, the top-level of the document is an object. */
+  bool _isObject;
+  /** Maps the talk group IDs to their index within @c talkgroups. */
+  QHash<unsigned, int> _indices;
+};
+
+
 /* ********************************************************************************************* *
  * Implementation of TalkGroupDatabase
  * ********************************************************************************************* */
-TalkGroupDatabase::TalkGroupDatabase(unsigned updatePeriodDays, QObject *parent)
-  : QAbstractTableModel(parent), _talkgroups(), _network()
+TalkGroupDatabase::TalkGroupDatabase(unsigned updatePeriodDays, QObject *parent, bool async)
+  : QAbstractTableModel(parent), _talkgroups(), _network(), _ingest(nullptr), _loader(nullptr),
+    _loading(nullptr), _updatePeriod(updatePeriodDays)
 {
   connect(&_network, SIGNAL(finished(QNetworkReply*)),
           this, SLOT(downloadFinished(QNetworkReply*)));
 
-  if ((! load()) || (updatePeriodDays < dbAge()))
+  if (async)
+    loadAsync(updatePeriodDays);
+  else if ((! load()) || (updatePeriodDays < dbAge()))
     download();
 }
 
+TalkGroupDatabase::~TalkGroupDatabase() {
+  if (_loader)
+    _loader->wait();
+  if (_loading)
+    delete _loading;
+  if (_ingest)
+    delete _ingest;
+}
+
 qint64
 TalkGroupDatabase::count() const {
   return _talkgroups.count();
@@ -60,22 +168,14 @@ TalkGroupDatabase::talkgroup(int index) const {
 
 void
 TalkGroupDatabase::download() {
-  QUrl url("https://api.brandmeister.network/v2/talkgroup/");
-  QNetworkRequest request(url);
-  _network.get(request);
-}
-
-void
-TalkGroupDatabase::downloadFinished(QNetworkReply *reply) {
-  if (reply->error()) {
-    QString msg = QString("Cannot download user database: %1").arg(reply->errorString());
-    logError() << msg;
-    emit error(msg);
+  // Apply a running background load first, it must not replace the downloaded database later.
+  finishLoading();
+  if (_ingest) {
+    logDebug() << "Download of talk group database already running.";
     return;
   }
 
   QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-  QFile file(path+"/talkgroups.json");
   QDir directory;
   if ((! directory.exists(path)) && (!directory.mkpath(path))) {
     QString msg = QString("Cannot create path '%1'.").arg(path);
@@ -83,19 +183,73 @@ TalkGroupDatabase::downloadFinished(QNetworkReply *reply) {
     emit error(msg);
     return;
   }
-  if (! file.open(QIODevice::WriteOnly)) {
-    QString msg = QString("Cannot save user database at '%1'.").arg(path+"/talkgroups.json");
+
+  // The document is parsed and written to disk as it arrives
+  _ingest = new Ingest();
+  _ingest->file.setFileName(path+"/talkgroups.json");
+  if (! _ingest->file.open(QIODevice::WriteOnly)) {
+    QString msg = QString("Cannot save talk group database at '%1'.").arg(path+"/talkgroups.json");
     logError() << msg;
     emit error(msg);
+    delete _ingest; _ingest = nullptr;
     return;
   }
 
-  file.write(reply->readAll());
-  file.flush();
-  file.close();
+  QUrl url("https://api.brandmeister.network/v2/talkgroup/");
+  QNetworkRequest request(url);
+  QNetworkReply *reply = _network.get(request);
+  connect(reply, SIGNAL(readyRead()), this, SLOT(downloadReadyRead()));
+}
+
+void
+TalkGroupDatabase::downloadReadyRead() {
+  QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+  if ((nullptr == reply) || (nullptr == _ingest))
+    return;
+
+  QByteArray chunk = reply->readAll();
+  _ingest->file.write(chunk);
+  if (_ingest->ok)
+    _ingest->ok = _ingest->parser.feed(chunk, _ingest->err);
+}
 
-  load();
+void
+TalkGroupDatabase::downloadFinished(QNetworkReply *reply) {
   reply->deleteLater();
+  if (nullptr == _ingest)
+    return;
+
+  if (reply->error()) {
+    QString msg = QString("Cannot download talk group database: %1").arg(reply->errorString());
+    logError() << msg;
+    emit error(msg);
+    _ingest->file.cancelWriting();
+    delete _ingest; _ingest = nullptr;
+    return;
+  }
+
+  // Process remaining data
+  downloadReadyRead();
+  Ingest *ingest = _ingest; _ingest = nullptr;
+  if ((! ingest->ok) || (! ingest->parser.finish(ingest->err)) ||
+      (! ingest->isObject(ingest->err))) {
+    QString msg = "Downloaded talk group database is invalid: " + ingest->err.format();
+    logError() << msg;
+    emit error(msg);
+    ingest->file.cancelWriting();
+    delete ingest;
+    return;
+  }
+  if (! ingest->file.commit())
+    logWarn() << "Cannot save talk group database at '" << ingest->file.fileName() << "': "
+              << ingest->file.errorString() << ".";
+
+  install(*ingest);
+  delete ingest;
+
+  logDebug() << "Downloaded talk group database with " << _talkgroups.size() << " entries.";
+
+  emit loaded();
 }
 
 bool
@@ -108,34 +262,22 @@ bool
 TalkGroupDatabase::load(const QString &filename) {
   QFile file(filename);
   if (! file.open(QIODevice::ReadOnly)) {
-    QString msg = QString("Cannot open talk group list '%1': ").arg(filename).arg(file.errorString());
+    QString msg = QString("Cannot open talk group list '%1': %2").arg(filename).arg(file.errorString());
     logError() << msg;
     emit error(msg);
     return false;
   }
-  QByteArray data = file.readAll();
-  file.close();
 
-  QJsonDocument doc = QJsonDocument::fromJson(data);
-  if (! doc.isObject()) {
-    QString msg = "Failed to load talk groups: JSON document is not an object!";
+  Ingest ingest;
+  if ((! ingest.parser.parse(&file, ingest.err)) || (! ingest.isObject(ingest.err))) {
+    QString msg = "Failed to load talk groups: " + ingest.err.format();
     logError() << msg;
     emit error(msg);
     return false;
   }
+  file.close();
 
-  beginResetModel();
-  QJsonObject tgs = doc.object();
-  _talkgroups.clear();
-  _talkgroups.reserve(tgs.count());
-  for (QJsonObject::const_iterator tg = tgs.begin(); tg!=tgs.end(); tg++) {
-    _talkgroups.append(TalkGroup(tg.value().toString(), tg.key().toUInt()));
-  }
-  // Sort repeater w.r.t. their IDs
-  std::stable_sort(_talkgroups.begin(), _talkgroups.end(),
-                   [](const TalkGroup &a, const TalkGroup &b){ return a.id < b.id; });
-  // Done.
-  endResetModel();
+  install(ingest);
 
   logDebug() << "Loaded talk group database with " << _talkgroups.size()
              << " entries from " << filename << ".";
@@ -144,6 +286,75 @@ TalkGroupDatabase::load(const QString &filename) {
   return true;
 }
 
+void
+TalkGroupDatabase::loadAsync(unsigned updatePeriodDays) {
+  if (_loader) {
+    logDebug() << "Loading of talk group database already running.";
+    return;
+  }
+
+  QString filename = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/talkgroups.json";
+  _updatePeriod = updatePeriodDays;
+  // Only parses the file, the talk groups get installed by finishLoading().
+  Ingest *ingest = _loading = new Ingest();
+  _loader = new BackgroundTask([ingest, filename]() {
+    QFile file(filename);
+    if (! file.open(QIODevice::ReadOnly)) {
+      errMsg(ingest->err) << "Cannot open talk group list '" << filename << "': "
+                          << file.errorString();
+      ingest->ok = false;
+      return;
+    }
+    ingest->ok = ingest->parser.parse(&file, ingest->err) && ingest->isObject(ingest->err);
+  }, this);
+  connect(_loader, &QThread::finished, this, &TalkGroupDatabase::finishLoading);
+  _loader->start(QThread::LowPriority);
+}
+
+bool
+TalkGroupDatabase::isLoading() const {
+  return nullptr != _loader;
+}
+
+void
+TalkGroupDatabase::finishLoading() {
+  if (nullptr == _loader)
+    return;
+  _loader->wait();
+  _loader->deleteLater();
+  _loader = nullptr;
+
+  Ingest *ingest = _loading; _loading = nullptr;
+  bool ok = ingest->ok;
+  if (ok) {
+    install(*ingest);
+    logDebug() << "Loaded talk group database with " << _talkgroups.size() << " entries.";
+    emit loaded();
+  } else {
+    QString msg = "Failed to load talk groups: " + ingest->err.format();
+    logError() << msg;
+    emit error(msg);
+  }
+  delete ingest;
+
+  if ((! ok) || (_updatePeriod < dbAge()))
+    download();
+}
+
+void
+TalkGroupDatabase::install(Ingest &ingest) {
+  if (ingest.skipped)
+    logWarn() << "Skipped " << ingest.skipped << " malformed entries in talk group database.";
+
+  beginResetModel();
+  _talkgroups.swap(ingest.talkgroups);
+  // Sort repeater w.r.t. their IDs
+  std::stable_sort(_talkgroups.begin(), _talkgroups.end(),
+                   [](const TalkGroup &a, const TalkGroup &b){ return a.id < b.id; });
+  // Done.
+  endResetModel();
+}
+
 
 int
 TalkGroupDatabase::rowCount(const QModelIndex &parent) const {
@@ -4,6 +4,8 @@
 #include <QAbstractTableModel>
 #include <QNetworkAccessManager>
 
+class BackgroundTask;
+
 /** Downloads, periodically updates and provides a list of talk group IDs and their names.
  *
  * @ingroup utils */
@@ -27,8 +29,11 @@ class TalkGroupDatabase : public QAbstractTableModel
 public:
   /** Constructs a talk group database.
    * @param updatePeriodDays Specifies the update period of the DB in days.
-   * @param parent Specifies the QObject parent. */
-  TalkGroupDatabase(unsigned updatePeriodDays=30, QObject *parent=nullptr);
+   * @param parent Specifies the QObject parent.
+   * @param async If @c true, the database gets loaded in the background, see @c loadAsync. */
+  TalkGroupDatabase(unsigned updatePeriodDays=30, QObject *parent=nullptr, bool async=false);
+  /** Destructor. */
+  virtual ~TalkGroupDatabase();
 
   /** Returns the number of talk groups. */
   qint64 count() const;
@@ -42,6 +47,14 @@ public:
   bool load();
   /** Loads all entries from the talk group db at the specified location. */
   bool load(const QString &filename);
+  /** Parses the downloaded talk group db on a separate thread. Once done, either @c loaded or
+   * @c error gets emitted. If the database is missing or older than @c updatePeriodDays days, it
+   * gets downloaded. */
+  void loadAsync(unsigned updatePeriodDays=30);
+  /** Returns @c true, if the database is being loaded in the background. */
+  bool isLoading() const;
+  /** Blocks until a background load is complete and applies its result. */
+  void finishLoading();
 
   /** Implements the QAbstractTableModel interface, returns the number of rows (number of entries). */
   int rowCount(const QModelIndex &parent=QModelIndex()) const;
@@ -61,14 +74,30 @@ public slots:
   void download();
 
 private slots:
+  /** Gets called whenever new data of the download arrived. */
+  void downloadReadyRead();
   /** Gets called whenever the download is complete. */
   void downloadFinished(QNetworkReply *reply);
 
+protected:
+  /** Forward declaration of the JSON ingest handler. */
+  class Ingest;
+  /** Takes the talk groups collected by the given ingest handler. */
+  void install(Ingest &ingest);
+
 protected:
   /** Holds all talk groups as id->name table. */
   QVector<TalkGroup>    _talkgroups;
   /** The network access used for downloading. */
   QNetworkAccessManager _network;
+  /** The ingest of the running download, if any. */
+  Ingest               *_ingest;
+  /** The running background load, if any. */
+  BackgroundTask       *_loader;
+  /** The ingest of the background load. */
+  Ingest               *_loading;
+  /** Update period in days, checked once the background load is complete. */
+  unsigned              _updatePeriod;
 };
 
 #endif // TALKGROUPDATABASE_HH
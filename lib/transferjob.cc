@@ -0,0 +1,139 @@
+#include "transferjob.hh"
+#include <QMutexLocker>
+#include <algorithm>
+
+/** Minimum time between two progress signals in ms. */
+#define PROGRESS_INTERVAL 100
+
+
+/* ********************************************************************************************* *
+ * Implementation of TransferProgress
+ * ********************************************************************************************* */
+TransferProgress::TransferProgress()
+  : phase(), bytes(0), totalBytes(0), blocks(0), totalBlocks(0), throughput(0), eta(-1)
+{
+  // pass...
+}
+
+unsigned
+TransferProgress::percent() const {
+  if (0 >= totalBytes)
+    return 0;
+  return std::min(qint64(100), (bytes*100)/totalBytes);
+}
+
+static QString
+formatBytes(double bytes) {
+  if (bytes < 1024)
+    return QString("%1 B").arg(bytes, 0, 'f', 0);
+  if (bytes < 1024*1024)
+    return QString("%1 KiB").arg(bytes/1024, 0, 'f', 1);
+  return QString("%1 MiB").arg(bytes/(1024*1024), 0, 'f', 1);
+}
+
+QString
+TransferProgress::format() const {
+  QString msg = QString("%1: %2/%3").arg(phase).arg(formatBytes(bytes)).arg(formatBytes(totalBytes));
+  if (0 < throughput)
+    msg.append(QString(", %1/s").arg(formatBytes(throughput)));
+  if (0 <= eta) {
+    unsigned sec = eta+0.5;
+    msg.append(QString(", ETA %1:%2").arg(sec/60).arg(sec%60, 2, 10, QChar('0')));
+  }
+  return msg;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of TransferJob
+ * ********************************************************************************************* */
+TransferJob::TransferJob(QObject *parent)
+  : QObject(parent), _cancelled(0), _mutex(), _progress(), _blockSize(1), _phaseTimer(),
+    _lastEmitted(0), _journal(Journal::Record)
+{
+  qRegisterMetaType<TransferProgress>();
+}
+
+void
+TransferJob::reset() {
+  _cancelled.storeRelease(0);
+  QMutexLocker lock(&_mutex);
+  _progress = TransferProgress();
+}
+
+void
+TransferJob::beginPhase(const QString &name, qint64 totalBytes, unsigned blockSize) {
+  TransferProgress progress;
+  progress.phase = name;
+  progress.totalBytes = totalBytes;
+  progress.totalBlocks = (totalBytes + blockSize - 1)/std::max(1u, blockSize);
+  {
+    QMutexLocker lock(&_mutex);
+    _progress = progress;
+    _blockSize = std::max(1u, blockSize);
+  }
+  _phaseTimer.start();
+  _lastEmitted = 0;
+  emit progressed(progress);
+}
+
+bool
+TransferJob::advance(qint64 bytes, const ErrorStack &err) {
+  if (! check(err))
+    return false;
+
+  qint64 elapsed = _phaseTimer.elapsed();
+  TransferProgress progress;
+  {
+    QMutexLocker lock(&_mutex);
+    _progress.bytes = std::min(_progress.bytes + bytes, _progress.totalBytes);
+    _progress.blocks = (_progress.bytes + _blockSize - 1)/_blockSize;
+    if (0 < elapsed) {
+      _progress.throughput = (1000.*_progress.bytes)/elapsed;
+      _progress.eta = (_progress.totalBytes-_progress.bytes)/std::max(1.0, _progress.throughput);
+    }
+    progress = _progress;
+  }
+
+  // Limit the rate of signals, these are usually queued to another thread
+  if (((elapsed - _lastEmitted) >= PROGRESS_INTERVAL) || (progress.bytes == progress.totalBytes)) {
+    _lastEmitted = elapsed;
+    emit progressed(progress);
+  }
+
+  return true;
+}
+
+bool
+TransferJob::check(const ErrorStack &err) const {
+  if (! isCancelled())
+    return true;
+  errMsg(err) << "Transfer cancelled.";
+  return false;
+}
+
+bool
+TransferJob::isCancelled() const {
+  return 0 != _cancelled.loadAcquire();
+}
+
+TransferProgress
+TransferJob::progress() const {
+  QMutexLocker lock(&_mutex);
+  return _progress;
+}
+
+TransferJob::Journal
+TransferJob::journal() const {
+  return _journal;
+}
+
+void
+TransferJob::setJournal(Journal mode) {
+  _journal = mode;
+}
+
+void
+TransferJob::cancel() {
+  _cancelled.storeRelease(1);
+}
@@ -0,0 +1,114 @@
+#ifndef TRANSFERJOB_HH
+#define TRANSFERJOB_HH
+
+#include <QObject>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include "errorstack.hh"
+
+/** Snapshot of the progress of the current phase of a transfer.
+ * @ingroup rif */
+class TransferProgress
+{
+public:
+  /** Empty constructor. */
+  TransferProgress();
+
+  /** Returns the fraction of the phase done in percent. */
+  unsigned percent() const;
+  /** Formats the progress, e.g. "Write codeplug: 12/64 KiB, 3.2 KiB/s, ETA 0:16". */
+  QString format() const;
+
+public:
+  /** Name of the phase, e.g. "Write codeplug". */
+  QString phase;
+  /** Bytes transferred in this phase so far. */
+  qint64 bytes;
+  /** Total number of bytes of this phase. */
+  qint64 totalBytes;
+  /** Blocks transferred so far. */
+  unsigned blocks;
+  /** Total number of blocks of this phase. */
+  unsigned totalBlocks;
+  /** Mean throughput of this phase in bytes per second. */
+  double throughput;
+  /** Estimated time remaining for this phase in seconds, -1 if unknown. */
+  double eta;
+};
+
+Q_DECLARE_METATYPE(TransferProgress)
+
+
+/** Tracks the progress of a transfer between host and radio and allows to cancel it.
+ *
+ * The radio calls @c beginPhase at the beginning of every phase (e.g., reading the codeplug for
+ * update and writing it back) and @c advance for every block transferred. The latter also
+ * implements the cooperative cancellation: Once @c cancel was called from any thread, the next
+ * call to @c advance (or @c check) fails, such that the transfer loop returns early and the radio
+ * takes its regular error path.
+ *
+ * @ingroup rif */
+class TransferJob: public QObject
+{
+  Q_OBJECT
+
+public:
+  /** Specifies how uploads use the transfer journal (see @c TransferJournal). */
+  enum class Journal {
+    Off,     ///< Uploads are not journaled, e.g., when writing to several radios of the same kind.
+    Record,  ///< Uploads record the confirmed blocks, the default.
+    Resume   ///< Uploads record the confirmed blocks and resume an interrupted upload.
+  };
+
+public:
+  /** Constructs an idle job. */
+  explicit TransferJob(QObject *parent=nullptr);
+
+  /** Resets the job for a new transfer. Clears any pending cancel request. */
+  void reset();
+  /** Starts a new phase of the transfer of @c totalBytes bytes in blocks of @c blockSize. */
+  void beginPhase(const QString &name, qint64 totalBytes, unsigned blockSize);
+  /** Accounts for @c bytes transferred. Returns @c false and adds a message to the error stack if
+   * the job was cancelled. */
+  bool advance(qint64 bytes, const ErrorStack &err=ErrorStack());
+  /** Returns @c false and adds a message to the error stack if the job was cancelled. */
+  bool check(const ErrorStack &err=ErrorStack()) const;
+
+  /** Returns @c true if the job was cancelled. */
+  bool isCancelled() const;
+  /** Returns a snapshot of the current progress. */
+  TransferProgress progress() const;
+
+  /** Returns how uploads use the transfer journal. */
+  Journal journal() const;
+  /** Sets how uploads use the transfer journal. Must be set before starting the transfer, it is
+   * kept by @c reset. */
+  void setJournal(Journal mode);
+
+public slots:
+  /** Requests the transfer to stop. May be called from any thread. */
+  void cancel();
+
+signals:
+  /** Gets emitted on progress, at most every 100ms and at the end of every phase. */
+  void progressed(const TransferProgress &progress);
+
+protected:
+  /** Set if the job was cancelled. */
+  QAtomicInt _cancelled;
+  /** Protects the progress. */
+  mutable QMutex _mutex;
+  /** The current progress. */
+  TransferProgress _progress;
+  /** Block size of the current phase. */
+  unsigned _blockSize;
+  /** Measures the duration of the current phase. */
+  QElapsedTimer _phaseTimer;
+  /** Time of the last progress signal. */
+  qint64 _lastEmitted;
+  /** How uploads use the transfer journal. */
+  Journal _journal;
+};
+
+#endif // TRANSFERJOB_HH
@@ -0,0 +1,210 @@
+#include "transferjournal.hh"
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QRegExp>
+#include <QtEndian>
+#include "logger.hh"
+
+/** Minimum time between two writes of the journal in ms. */
+#define SAVE_INTERVAL 1000
+
+
+/* ********************************************************************************************* *
+ * Implementation of TransferJournal
+ * ********************************************************************************************* */
+TransferJournal::TransferJournal(const QString &key, unsigned blockSize)
+  : _key(key), _blockSize(blockSize), _hash(), _confirmed(0), _dirty(false), _lastSaved()
+{
+  // Keep key usable as a file name
+  _key.replace(QRegExp("[^A-Za-z0-9_\\-\\.]"), "_");
+}
+
+TransferJournal::~TransferJournal() {
+  ErrorStack err;
+  if (_dirty && (! flush(err)))
+    logWarn() << "Cannot update transfer journal: " << err.format();
+}
+
+const QString &
+TransferJournal::key() const {
+  return _key;
+}
+
+QString
+TransferJournal::path() {
+  return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/journals";
+}
+
+QString
+TransferJournal::filename() const {
+  return path() + "/" + _key + ".json";
+}
+
+QString
+TransferJournal::imageFilename() const {
+  return path() + "/" + _key + ".dfu";
+}
+
+QByteArray
+TransferJournal::hash(const DFUFile::Image &image) {
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  for (int i=0; i<image.numElements(); i++) {
+    uchar addr[4];
+    qToLittleEndian(image.element(i).address(), addr);
+    hash.addData((const char *)addr, sizeof(addr));
+    hash.addData(image.element(i).data());
+  }
+  return hash.result();
+}
+
+bool
+TransferJournal::load(const ErrorStack &err) {
+  _hash.clear(); _confirmed = 0; _dirty = false;
+
+  if (_key.isEmpty()) {
+    errMsg(err) << "Cannot load transfer journal: No radio key.";
+    return false;
+  }
+
+  QFile file(filename());
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "No transfer journal for radio '" << _key << "'.";
+    return false;
+  }
+
+  QJsonParseError parseError;
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+  if (! doc.isObject()) {
+    errMsg(err) << "Cannot parse transfer journal '" << filename() << "': "
+                << parseError.errorString() << ".";
+    return false;
+  }
+
+  QJsonObject journal = doc.object();
+  if (unsigned(journal.value("blockSize").toInt()) != _blockSize) {
+    errMsg(err) << "Transfer journal '" << filename() << "' uses a different block size.";
+    return false;
+  }
+  _hash = QByteArray::fromHex(journal.value("hash").toString().toLatin1());
+  _confirmed = journal.value("blocks").toInt();
+
+  logDebug() << "Loaded transfer journal for '" << _key << "': " << _confirmed
+             << " blocks confirmed.";
+  return true;
+}
+
+bool
+TransferJournal::matches(const QByteArray &hash) const {
+  return (! _hash.isEmpty()) && (_hash == hash);
+}
+
+unsigned
+TransferJournal::confirmed() const {
+  return _confirmed;
+}
+
+bool
+TransferJournal::loadImage(DFUFile &file, const ErrorStack &err) const {
+  if (_key.isEmpty() || (! QFile::exists(imageFilename()))) {
+    errMsg(err) << "No journaled image for radio '" << _key << "'.";
+    return false;
+  }
+  if (! file.read(imageFilename(), err)) {
+    errMsg(err) << "Cannot load journaled image for radio '" << _key << "'.";
+    return false;
+  }
+  return true;
+}
+
+bool
+TransferJournal::begin(const QByteArray &hash, const ErrorStack &err) {
+  _hash = hash; _confirmed = 0;
+  // Any image kept for a previous upload is stale now
+  QFile::remove(imageFilename());
+  if (save(err))
+    return true;
+  _hash.clear();
+  return false;
+}
+
+bool
+TransferJournal::storeImage(DFUFile &file, const ErrorStack &err) const {
+  if (_key.isEmpty()) {
+    errMsg(err) << "Cannot journal image: No radio key.";
+    return false;
+  }
+  if (! file.write(imageFilename(), err)) {
+    errMsg(err) << "Cannot journal image for radio '" << _key << "'.";
+    // Do not keep a partially written image
+    QFile::remove(imageFilename());
+    return false;
+  }
+  return true;
+}
+
+void
+TransferJournal::confirm(unsigned blocks) {
+  if (_hash.isEmpty() || (blocks <= _confirmed))
+    return;
+  _confirmed = blocks;
+  _dirty = true;
+  if ((! _lastSaved.isValid()) || _lastSaved.hasExpired(SAVE_INTERVAL)) {
+    ErrorStack err;
+    if (! save(err))
+      logWarn() << "Cannot update transfer journal: " << err.format();
+  }
+}
+
+bool
+TransferJournal::flush(const ErrorStack &err) {
+  if (! _dirty)
+    return true;
+  return save(err);
+}
+
+bool
+TransferJournal::remove() {
+  _hash.clear(); _confirmed = 0; _dirty = false;
+  if (_key.isEmpty())
+    return true;
+  QFile::remove(imageFilename());
+  return (! QFile::exists(filename())) || QFile::remove(filename());
+}
+
+bool
+TransferJournal::save(const ErrorStack &err) {
+  if (_key.isEmpty()) {
+    errMsg(err) << "Cannot write transfer journal: No radio key.";
+    return false;
+  }
+
+  QDir directory;
+  if ((! directory.exists(path())) && (! directory.mkpath(path()))) {
+    errMsg(err) << "Cannot write transfer journal: Cannot create path '" << path() << "'.";
+    return false;
+  }
+
+  QJsonObject journal;
+  journal.insert("hash", QString::fromLatin1(_hash.toHex()));
+  journal.insert("blockSize", int(_blockSize));
+  journal.insert("blocks", int(_confirmed));
+
+  // Replace the journal atomically, a torn journal must not cause blocks to be skipped
+  QSaveFile file(filename());
+  if ((! file.open(QIODevice::WriteOnly)) ||
+      (0 > file.write(QJsonDocument(journal).toJson(QJsonDocument::Compact))) ||
+      (! file.commit())) {
+    errMsg(err) << "Cannot write transfer journal '" << filename() << "': "
+                << file.errorString() << ".";
+    return false;
+  }
+
+  _dirty = false;
+  _lastSaved.start();
+  return true;
+}
@@ -0,0 +1,91 @@
+#ifndef TRANSFERJOURNAL_HH
+#define TRANSFERJOURNAL_HH
+
+#include <QString>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include "dfufile.hh"
+#include "errorstack.hh"
+
+/** Persistent journal of the blocks confirmed written during an upload to a radio.
+ *
+ * The blocks of an upload are numbered in the order they are written. The journal records the
+ * hash of the uploaded image together with the number of leading blocks, the device confirmed.
+ * If an upload fails halfway (e.g., due to an USB hiccup), a subsequent upload of the same image
+ * to the same radio can skip these blocks and resume from the first unconfirmed one. Radios, that
+ * need to erase the memory before writing, start the journal only once the memory was erased.
+ * Hence, an existing journal also implies that the erase is done. Optionally, the uploaded image
+ * itself can be kept alongside the journal, to serve as the base for updating the codeplug, as
+ * the contents of a partially written device cannot be read back.
+ *
+ * The radio is identified by a key (e.g., model and firmware version), the journals are stored
+ * within the application data directory. Once the upload completed, the journal gets removed.
+ *
+ * @ingroup util */
+class TransferJournal
+{
+public:
+  /** Constructs a journal for uploads to the radio identified by the given key, in blocks of
+   * the given size. */
+  TransferJournal(const QString &key, unsigned blockSize);
+  /** Destructor, writes pending confirmations. */
+  ~TransferJournal();
+
+  /** Returns the key identifying the radio. */
+  const QString &key() const;
+  /** Returns the file name of the journal. */
+  QString filename() const;
+  /** Returns the file name of the image kept alongside the journal. */
+  QString imageFilename() const;
+
+  /** Loads the journal of the last upload to the radio.
+   * @returns @c false if there is no journal or it cannot be read. */
+  bool load(const ErrorStack &err=ErrorStack());
+  /** Returns @c true if the loaded journal refers to an upload of an image with the given hash
+   * using the same block size. */
+  bool matches(const QByteArray &hash) const;
+  /** Returns the number of leading blocks confirmed written. */
+  unsigned confirmed() const;
+  /** Loads the image kept alongside the journal into the given DFU file.
+   * @returns @c false if there is no image or the image cannot be read. */
+  bool loadImage(DFUFile &file, const ErrorStack &err=ErrorStack()) const;
+
+  /** Starts a new journal for the upload of an image with the given hash. Replaces any previous
+   * journal of the radio. */
+  bool begin(const QByteArray &hash, const ErrorStack &err=ErrorStack());
+  /** Keeps the given image alongside the journal. */
+  bool storeImage(DFUFile &file, const ErrorStack &err=ErrorStack()) const;
+  /** Records, that the first @c blocks blocks are confirmed written. To keep the overhead low,
+   * the journal is written at most once a second. */
+  void confirm(unsigned blocks);
+  /** Writes pending confirmations. */
+  bool flush(const ErrorStack &err=ErrorStack());
+  /** Removes the journal and the image, e.g., once the upload completed. */
+  bool remove();
+
+public:
+  /** Returns the hash identifying the given image. */
+  static QByteArray hash(const DFUFile::Image &image);
+  /** Returns the directory, the journals are stored in. */
+  static QString path();
+
+protected:
+  /** Writes the journal. */
+  bool save(const ErrorStack &err=ErrorStack());
+
+protected:
+  /** The key identifying the radio. */
+  QString _key;
+  /** The block size of the upload. */
+  unsigned _blockSize;
+  /** The hash of the uploaded image. */
+  QByteArray _hash;
+  /** The number of leading blocks confirmed written. */
+  unsigned _confirmed;
+  /** If @c true, there are confirmations not written yet. */
+  bool _dirty;
+  /** Measures the time since the journal was last written. */
+  QElapsedTimer _lastSaved;
+};
+
+#endif // TRANSFERJOURNAL_HH
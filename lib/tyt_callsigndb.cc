@@ -164,12 +164,8 @@ TyTCallsignDB::encode(UserDatabase *db, const Selection &selection, const ErrorS
   // Clear DB index
   clearIndex();
 
-  // Select n users and sort them in ascending order of their IDs
-  QVector<UserDatabase::User> users;
-  for (unsigned i=0; i<n; i++)
-    users.append(db->user(i));
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
+  // Select n users closest to the selected IDs, in ascending order of their IDs
+  QVector<UserDatabase::User> users = db->closest(selection.prefixes(), n);
 
   // Store number of entries
   setNumEntries(n);
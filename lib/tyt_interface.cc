@@ -6,6 +6,8 @@
 
 #define USB_VID 0x0483
 #define USB_PID 0xdf11
+/** Size of a flash sector, the erase granularity. */
+#define SECTOR_SIZE 0x10000
 
 
 TyTInterface::TyTInterface(const USBDeviceDescriptor &descr, const ErrorStack &err, QObject *parent)
@@ -99,7 +101,7 @@ TyTInterface::md380_command(uint8_t a, uint8_t b, const ErrorStack &err)
   if (int error = download(0, cmd, 2, err))
     return error;
 
-  usleep(100000);
+  // The device executes the command once the status gets requested and tells how long to wait
   return wait_idle();
 }
 
@@ -131,10 +133,12 @@ TyTInterface::erase_block(uint32_t address, const ErrorStack &err)
     (uint8_t)(address >> 16),
     (uint8_t)(address >> 24), };
 
+  QElapsedTimer timer; timer.start();
   if (int error = download(0, cmd, 5, err))
     return error;
 
   wait_idle();
+  record(Operation::Erase, timer);
 
   return 0;
 }
@@ -155,6 +159,18 @@ TyTInterface::identify(const ErrorStack &err)
 
 bool
 TyTInterface::erase(unsigned start, unsigned size, void(*progress)(unsigned, void *), void *ctx, const ErrorStack &err) {
+  unsigned end = start+size;
+  start = align_addr(start, SECTOR_SIZE);
+  end = align_size(end, SECTOR_SIZE);
+
+  QList<uint32_t> sectors;
+  for (unsigned addr=start; addr<end; addr+=SECTOR_SIZE)
+    sectors.append(addr);
+  return eraseSectors(sectors, progress, ctx, err);
+}
+
+bool
+TyTInterface::eraseSectors(const QList<uint32_t> &sectors, void(*progress)(unsigned, void *), void *ctx, const ErrorStack &err) {
   int error;
   // Enter Programming Mode.
   if ((error = get_status(err)))
@@ -163,17 +179,11 @@ TyTInterface::erase(unsigned start, unsigned size, void(*progress)(unsigned, voi
     return false;
   if ((error = md380_command(0x91, 0x01, err)))
     return false;
-  usleep(100000);
-
-  unsigned end = start+size;
-  start = align_addr(start, 0x10000);
-  end = align_size(end, 0x10000);
-  size = end-start;
 
-  for (unsigned i=0; i<size; i+=0x10000) {
-    erase_block(start+i, err);
+  for (int i=0; i<sectors.size(); i++) {
+    erase_block(sectors[i], err);
     if (progress)
-      progress((i*100)/size, ctx);
+      progress((i*100)/sectors.size(), ctx);
   }
 
   // Zero address.
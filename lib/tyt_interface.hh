@@ -85,6 +85,9 @@ public:
 
   /** Erases a memory section at @c start of size @c size. */
   bool erase(unsigned start, unsigned size, void (*progress)(unsigned, void *)=nullptr, void *ctx=nullptr, const ErrorStack &err=ErrorStack());
+  /** Erases the 64kb sectors at the given addresses. Enters the programming mode only once for
+   * all sectors. */
+  bool eraseSectors(const QList<uint32_t> &sectors, void (*progress)(unsigned, void *)=nullptr, void *ctx=nullptr, const ErrorStack &err=ErrorStack());
 
 public:
   /** Returns some information about the interface. */
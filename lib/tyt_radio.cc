@@ -2,8 +2,13 @@
 #include "config.hh"
 #include "logger.hh"
 #include "utils.hh"
+#include "codeplugcache.hh"
+#include "transferjournal.hh"
+#include <QSet>
+#include <cstring>
 
 #define BSIZE 1024
+#define ESIZE 0x10000
 
 
 TyTRadio::TyTRadio(TyTInterface *device, QObject *parent)
@@ -33,6 +38,7 @@ TyTRadio::startDownload(bool blocking, const ErrorStack &err) {
 
   _task = StatusDownload;
   _errorStack = err;
+  _job.reset();
 
   if (blocking) {
     run();
@@ -53,6 +59,7 @@ TyTRadio::startUpload(Config *config, bool blocking, const Codeplug::Flags &flag
 
   _task = StatusUpload;
   _errorStack = err;
+  _job.reset();
   _codeplugFlags = flags;
 
   if (blocking) {
@@ -73,6 +80,8 @@ TyTRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignD
     errMsg(err) << "Cannot upload callsign DB. DB not created.";
     return false;
   }
+  // Reset the job before encoding, a cancel request during the encoding must not get lost.
+  _job.reset();
   callsignDB()->encode(db, selection);
 
   _task = StatusUploadCallsigns;
@@ -168,6 +177,8 @@ TyTRadio::download() {
 
   // Then download codeplug
   size_t bcount = 0;
+  _dev->resetStatistics();
+  _job.beginPhase(tr("Read codeplug"), totb*BSIZE, BSIZE);
   for (int n=0; n<codeplug().image(0).numElements(); n++) {
     unsigned addr = codeplug().image(0).element(n).address();
     unsigned size = codeplug().image(0).element(n).data().size();
@@ -177,10 +188,14 @@ TyTRadio::download() {
         errMsg(_errorStack) << "Cannot download codeplug.";
         return false;
       }
+      if (! _job.advance(BSIZE, _errorStack))
+        return false;
       emit downloadProgress(float(bcount*100)/totb);
     }
   }
 
+  logDebug() << "Codeplug download timing:\n" << _dev->statistics().format();
+
   return true;
 }
 
@@ -196,10 +211,31 @@ TyTRadio::upload() {
   }
 
   size_t totb = codeplug().memSize();
+  _dev->resetStatistics();
+
+  // Delta uploads erase and write only some sectors, hence they are neither journaled nor resumed.
+  bool delta = _codeplugFlags.updateCodePlug && _codeplugFlags.deltaUpload;
+  bool journaled = (TransferJob::Journal::Off != _job.journal()) && (! delta);
+  QString key = _dev->identifier().key();
+  TransferJournal journal(key.isEmpty() ? key : ("tyt-" + key), BSIZE);
+  bool resumable = false;
+  if (TransferJob::Journal::Resume == _job.journal()) {
+    ErrorStack err;
+    if (delta)
+      logWarn() << "Delta uploads cannot be resumed, perform regular upload.";
+    else if (! (resumable = journal.load(err)))
+      logInfo() << "Cannot resume codeplug upload: " << err.format();
+  }
 
   size_t bcount = 0;
+  // A partially written device cannot be read back, the image of the interrupted upload serves as
+  // the base for the update instead. If that image cannot be used, the upload is not resumed.
+  bool restored = resumable && _codeplugFlags.updateCodePlug && restoreFromJournal(journal);
+  if (_codeplugFlags.updateCodePlug)
+    resumable = restored;
   // If codeplug gets updated, download codeplug from device first:
-  if (_codeplugFlags.updateCodePlug) {
+  if (_codeplugFlags.updateCodePlug && (! restored)) {
+    _job.beginPhase(tr("Read codeplug"), totb, BSIZE);
     for (int n=0; n<codeplug().image(0).numElements(); n++) {
       unsigned addr = codeplug().image(0).element(n).address();
       unsigned size = codeplug().image(0).element(n).data().size();
@@ -209,36 +245,198 @@ TyTRadio::upload() {
           errMsg(_errorStack) << "Cannot upload codeplug.";
           return false;
         }
+        if (! _job.advance(BSIZE, _errorStack))
+          return false;
         emit uploadProgress(float(bcount*50)/totb);
       }
     }
   }
 
+  // Keep a copy of the codeplug read from the device for delta uploads. The element data is
+  // implicitly shared, hence this is cheap until the encoder modifies an element.
+  DFUFile::Image original;
+  if (delta)
+    original = codeplug().image(0);
+
   // Encode config into codeplug
   logDebug() << "Encode codeplug.";
   codeplug().encode(_config, _codeplugFlags);
 
-  // then erase memory
-  for (int i=0; i<codeplug().image(0).numElements(); i++)
-    _dev->erase(codeplug().image(0).element(i).address(), codeplug().image(0).element(i).memSize(),
-                nullptr, nullptr, _errorStack);
+  // Resume, if the interrupted upload wrote the very same codeplug
+  QByteArray hash = TransferJournal::hash(codeplug().image(0));
+  size_t resumeAt = 0;
+  bool resume = resumable && journal.matches(hash) && (journal.confirmed() <= totb/BSIZE);
+  // When updating, the device was already checked against the journaled image
+  if (resume && (! _codeplugFlags.updateCodePlug))
+    resume = verifyResume(codeplug().image(0), journal.confirmed());
+  if (resume) {
+    resumeAt = journal.confirmed();
+    logInfo() << "Resume codeplug upload at block " << resumeAt << " of " << totb/BSIZE << ".";
+  } else if (resumable) {
+    logInfo() << "Cannot resume codeplug upload: Journal does not match codeplug.";
+  }
+
+  // Last chance to cancel before the device gets modified
+  if (! _job.check(_errorStack))
+    return false;
+
+  // then erase memory, unless the interrupted upload did that already. Every sector covered by the
+  // codeplug gets erased once. For delta uploads, a sector must be erased and re-written entirely,
+  // if any block within it has been modified.
+  QSet<unsigned> modifiedSectors;
+  size_t wtotal = totb;
+  if (resume) {
+    logDebug() << "Skip erase, memory was erased by the interrupted upload.";
+  } else {
+    // Any journal is stale once the memory gets erased
+    journal.remove();
+    QList<uint32_t> sectors = codeplug().image(0).sectors(ESIZE, delta ? &original : nullptr);
+    logDebug() << "Erase " << sectors.size() << " sectors.";
+    if (! sectors.isEmpty())
+      _dev->eraseSectors(sectors, nullptr, nullptr, _errorStack);
+    if (delta) {
+      foreach (uint32_t sector, sectors)
+        modifiedSectors.insert(sector/ESIZE);
+      // Only blocks within modified sectors get written
+      wtotal = 0;
+      for (int n=0; n<codeplug().image(0).numElements(); n++) {
+        unsigned addr = codeplug().image(0).element(n).address();
+        unsigned size = codeplug().image(0).element(n).memSize();
+        for (unsigned b=addr/BSIZE; b<(addr+size)/BSIZE; b++)
+          if (modifiedSectors.contains((b*BSIZE)/ESIZE))
+            wtotal += BSIZE;
+      }
+    }
+  }
+
+  // Start the journal once the memory is erased, keep the image as the base for a later update
+  if (journaled && (! resume)) {
+    ErrorStack err;
+    if ((! journal.begin(hash, err)) ||
+        (_codeplugFlags.updateCodePlug && (! journal.storeImage(codeplug(), err))))
+      logWarn() << "Cannot journal codeplug upload: " << err.format();
+  }
 
   logDebug() << "Upload " << codeplug().image(0).numElements() << " elements.";
   // then, upload modified codeplug
+  _job.beginPhase(tr("Write codeplug"), wtotal - resumeAt*BSIZE, BSIZE);
   bcount = 0;
+  size_t skipped = 0;
   for (int n=0; n<codeplug().image(0).numElements(); n++) {
     unsigned addr = codeplug().image(0).element(n).address();
     unsigned size = codeplug().image(0).element(n).memSize();
     unsigned b0 = addr/BSIZE, nb = size/BSIZE;
     for (size_t b=0; b<nb; b++,bcount+=BSIZE) {
+      if (delta && (! modifiedSectors.contains(((b0+b)*BSIZE)/ESIZE))) {
+        skipped++;
+        continue;
+      }
+      // Skip blocks confirmed by the interrupted upload
+      if ((bcount/BSIZE) < resumeAt)
+        continue;
       if (! _dev->write(0, (b0+b)*BSIZE, codeplug().data((b0+b)*BSIZE), BSIZE, _errorStack)) {
         errMsg(_errorStack) << "Cannot upload codeplug.";
         return false;
       }
+      journal.confirm(bcount/BSIZE+1);
+      if (! _job.advance(BSIZE, _errorStack))
+        return false;
       emit uploadProgress(50+float(bcount*50)/totb);
     }
   }
 
+  if (delta) {
+    logInfo() << "Delta upload skipped " << skipped << " of " << bcount/BSIZE
+              << " unchanged blocks, erased " << modifiedSectors.size() << " sectors.";
+  }
+
+  journal.remove();
+  logDebug() << "Codeplug upload timing:\n" << _dev->statistics().format();
+
+  return true;
+}
+
+bool
+TyTRadio::restoreFromJournal(const TransferJournal &journal) {
+  DFUFile journaled; ErrorStack err;
+  if ((! journal.loadImage(journaled, err)) || (1 > journaled.numImages())) {
+    logInfo() << "Cannot restore codeplug of interrupted upload: " << err.format();
+    return false;
+  }
+
+  if (! verifyResume(journaled.image(0), journal.confirmed()))
+    return false;
+
+  DFUFile::Image &image = codeplug().image(0);
+  for (int n=0; n<image.numElements(); n++) {
+    unsigned addr = image.element(n).address();
+    unsigned size = image.element(n).data().size();
+    if (! CodeplugCache::copy(image, journaled.image(0), addr, size, BSIZE)) {
+      logInfo() << "Cannot restore codeplug of interrupted upload: Memory section at "
+                << QString::number(addr, 16) << "h not journaled.";
+      return false;
+    }
+  }
+
+  logInfo() << "Using codeplug of interrupted upload '" << journal.imageFilename()
+            << "' as update base.";
+  return true;
+}
+
+/** Returns the address of the n-th block of the given image or -1 if there is none. */
+static qint64
+blockAddress(const DFUFile::Image &image, size_t n) {
+  for (int i=0; i<image.numElements(); i++) {
+    size_t nb = image.element(i).memSize()/BSIZE;
+    if (n < nb)
+      return image.element(i).address() + n*BSIZE;
+    n -= nb;
+  }
+  return -1;
+}
+
+bool
+TyTRadio::verifyResume(const DFUFile::Image &image, size_t confirmed) {
+  size_t nblocks = 0;
+  for (int i=0; i<image.numElements(); i++)
+    nblocks += image.element(i).memSize()/BSIZE;
+  if ((0 == confirmed) || (confirmed > nblocks)) {
+    logInfo() << "Cannot resume codeplug upload: No blocks confirmed.";
+    return false;
+  }
+
+  uint8_t block[BSIZE]; ErrorStack err;
+  // The last confirmed block must hold the image
+  qint64 addr = blockAddress(image, confirmed-1);
+  if ((0 > addr) || (! _dev->read(0, addr, block, BSIZE, err))) {
+    logInfo() << "Cannot resume codeplug upload: Cannot read confirmed block: " << err.format();
+    return false;
+  }
+  if (0 != memcmp(block, image.data(addr), BSIZE)) {
+    logInfo() << "Cannot resume codeplug upload: Device does not hold the confirmed blocks.";
+    return false;
+  }
+
+  // The remaining blocks were erased by the interrupted upload, the first may be written partially
+  QList<size_t> remaining;
+  if (confirmed < nblocks)
+    remaining << confirmed << (nblocks-1);
+  foreach (size_t n, remaining) {
+    addr = blockAddress(image, n);
+    if ((0 > addr) || (! _dev->read(0, addr, block, BSIZE, err))) {
+      logInfo() << "Cannot resume codeplug upload: Cannot read block: " << err.format();
+      return false;
+    }
+    const uint8_t *expected = image.data(addr);
+    for (unsigned i=0; i<BSIZE; i++) {
+      if ((0xff != block[i]) && (expected[i] != block[i])) {
+        logInfo() << "Cannot resume codeplug upload: Memory at " << QString::number(addr, 16)
+                  << "h was not erased by the interrupted upload.";
+        return false;
+      }
+    }
+  }
+
   return true;
 }
 
@@ -254,7 +452,11 @@ TyTRadio::uploadCallsigns() {
     return false;
   }
 
+  if (! _job.check(_errorStack))
+    return false;
+
   // then erase memory
+  _dev->resetStatistics();
   logDebug() << "Erase memory section for call-sign DB.";
   _dev->erase(callsignDB()->image(0).element(0).address(),
               callsignDB()->image(0).element(0).memSize(),
@@ -268,13 +470,18 @@ TyTRadio::uploadCallsigns() {
   unsigned addr = callsignDB()->image(0).element(0).address();
   unsigned size = callsignDB()->image(0).element(0).memSize();
   unsigned b0 = addr/BSIZE, nb = size/BSIZE;
+  _job.beginPhase(tr("Write call-sign DB"), size, BSIZE);
   for (size_t b=0, bcount=0; b<nb; b++,bcount+=BSIZE) {
     if (! _dev->write(0, (b0+b)*BSIZE, callsignDB()->data((b0+b)*BSIZE), BSIZE, _errorStack)) {
       errMsg(_errorStack) << "Cannot upload codeplug.";
       return false;
     }
+    if (! _job.advance(BSIZE, _errorStack))
+      return false;
     emit uploadProgress(50+float(bcount*50)/totb);
   }
 
+  logDebug() << "Call-sign DB upload timing:\n" << _dev->statistics().format();
+
   return true;
 }
@@ -8,6 +8,8 @@
 #include "radio.hh"
 #include "tyt_interface.hh"
 
+class TransferJournal;
+
 /** Implements an USB interface to TYT & Retevis radios.
  *
  * @ingroup tyt */
@@ -43,6 +45,16 @@ private:
   virtual bool upload();
   virtual bool uploadCallsigns();
 
+  /** Restores the codeplug from the image kept by the journal of an interrupted upload.
+   * @returns @c false if there is no such image or it does not cover the codeplug. */
+  bool restoreFromJournal(const TransferJournal &journal);
+  /** Checks, whether the device holds an interrupted upload of the given image, that confirmed
+   * @c confirmed blocks. The radios do not expose a unit-specific ID, hence a journal may also
+   * stem from another radio of the same model. To this end, the last confirmed block must match
+   * the image and the first unconfirmed as well as the final block must be erased or hold a
+   * partial write of the image. */
+  bool verifyResume(const DFUFile::Image &image, size_t confirmed);
+
 protected:
   /** The interface to the radio. */
   TyTInterface *_dev;
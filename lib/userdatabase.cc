@@ -1,13 +1,156 @@
 #include "userdatabase.hh"
-#include <QJsonDocument>
-#include <QJsonArray>
+#include "jsonstreamparser.hh"
+#include "backgroundtask.hh"
 #include <QStandardPaths>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QDir>
 #include <QNetworkReply>
 #include <algorithm>
 #include "logger.hh"
 #include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+/** Magic number of the binary user database ("UDB1"), also detects byte-order mismatches. */
+#define USERDB_MAGIC 0x31424455
+/** Number of strings per user. */
+#define USERDB_STRINGS 7
+
+/** Header of the binary user database. */
+struct __attribute__((packed)) UserDBHeader {
+  /** Magic number. */
+  quint32 magic;
+  /** Number of users. */
+  quint32 count;
+  /** Size of the string pool in bytes. */
+  quint32 poolSize;
+  /** Reserved, set to 0. */
+  quint32 reserved;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of UserDatabase::Ingest
+ * ********************************************************************************************* */
+/** Collects the user entries while parsing the JSON user database, either from a file or from
+ * the running download. Malformed entries are skipped and counted.
+ * The document is expected as @c {"users":[{...},{...},...]}. */
+class UserDatabase::Ingest: public JsonStreamParser::Handler
+{
+public:
+  /** Constructor. */
+  Ingest()
+    : parser(this), users(), skipped(0), found(false), ok(true), err(), file(),
+      _level(0), _inUsers(false), _key(), _user(), _valid(false)
+  {
+    // pass...
+  }
+
+  void beginObject() {
+    _level++;
+    if (_inUsers && (3 == _level)) {
+      _user = User(); _valid = true;
+    }
+  }
+
+  void endObject() {
+    if (_inUsers && (3 == _level)) {
+      if (_valid && _user.isValid())
+        users.append(_user);
+      else
+        skipped++;
+    }
+    _level--;
+  }
+
+  void beginArray() {
+    _level++;
+    if ((2 == _level) && ("users" == _key))
+      _inUsers = found = true;
+  }
+
+  void endArray() {
+    if (2 == _level)
+      _inUsers = false;
+    _level--;
+  }
+
+  void key(const QString &key) {
+    if ((1 == _level) || (_inUsers && (3 == _level)))
+      _key = key;
+  }
+
+  void value(const QJsonValue &value) {
+    if (_inUsers && (2 == _level)) {
+      // Entry is not an object
+      skipped++;
+      return;
+    }
+    if ((! _inUsers) || (3 != _level))
+      return;
+
+    if ("id" == _key) {
+      bool isNumber = value.isDouble();
+      double id = isNumber ? value.toDouble() : value.toString().toDouble(&isNumber);
+      if ((! isNumber) || (id < 1) || (id > 0xffffffff) || (id != std::floor(id)))
+        _valid = false;
+      else
+        _user.id = id;
+      return;
+    }
+
+    QString str;
+    if (value.isString())
+      str = value.toString();
+    else if (value.isDouble())
+      str = QString::number(value.toDouble());
+    if ("callsign" == _key)
+      _user.call = str;
+    else if ("fname" == _key)
+      _user.name = str;
+    else if ("surname" == _key)
+      _user.surname = str;
+    else if ("city" == _key)
+      _user.city = str;
+    else if ("state" == _key)
+      _user.state = str;
+    else if ("country" == _key)
+      _user.country = str;
+    else if ("remarks" == _key)
+      _user.comment = str;
+  }
+
+public:
+  /** The parser feeding this handler. */
+  JsonStreamParser parser;
+  /** The collected users. */
+  QVector<User> users;
+  /** Number of skipped, malformed entries. */
+  unsigned skipped;
+  /** If @c true, the users array was found. */
+  bool found;
+  /** If @c false, the parser failed. Used while downloading. */
+  bool ok;
+  /** Holds the parser errors. */
+  ErrorStack err;
+  /** The file, the downloaded document is written to. */
+  QSaveFile file;
+
+protected:
+  /** Current nesting level. */
+  unsigned _level;
+  /** If @c true, the parser is within the users array. */
+  bool _inUsers;
+  /** The last key. */
+  QString _key;
+  /** The current user entry. */
+  User _user;
+  /** If @c false, the current entry is malformed. */
+  bool _valid;
+};
 
 
 /* ********************************************************************************************* *
@@ -30,37 +173,63 @@ UserDatabase::User::User(const QJsonObject &obj)
 
 unsigned
 UserDatabase::User::distance(unsigned id) const {
-  // Fix number of digits
-  int a = this->id, b = id;
-  int ad = std::ceil(std::log10(a));
-  int bd = std::ceil(std::log10(b));
-  if (ad > bd)
-    b *= std::pow(10u, (ad-bd));
-  else if (bd > ad)
-    a *= std::pow(10u, (bd-ad));
+  return distance(this->id, id);
+}
+
+unsigned
+UserDatabase::User::distance(unsigned a, unsigned b) {
+  // Fix number of digits, ceil(log10(x)) equals the number of digits of x-1
+  unsigned ad = 0, bd = 0;
+  for (unsigned x=(a ? a-1 : 0); x; x/=10) ad++;
+  for (unsigned x=(b ? b-1 : 0); x; x/=10) bd++;
+  qint64 ia = a, ib = b;
+  for (; ad > bd; bd++) ib *= 10;
+  for (; bd > ad; ad++) ia *= 10;
   // Distance is just the difference between these two numbers
   // this ensures a small distance between two numbers with the same
   // prefix.
-  return std::abs(a-b);
+  return std::min(qint64(std::numeric_limits<unsigned>::max()), std::abs(ia-ib));
 }
 
 
 /* ********************************************************************************************* *
  * Implementation of UserDatabase
  * ********************************************************************************************* */
-UserDatabase::UserDatabase(unsigned updatePeriodDays, QObject *parent)
-  : QAbstractTableModel(parent), _user(), _network()
+UserDatabase::UserDatabase(unsigned updatePeriodDays, QObject *parent, bool async)
+  : QAbstractTableModel(parent), _file(), _buffer(), _count(0), _ids(nullptr), _strings(nullptr),
+    _pool(nullptr), _index(), _network(), _ingest(nullptr), _loader(nullptr),
+    _updatePeriod(updatePeriodDays), _compiled(), _loadError()
 {
   connect(&_network, SIGNAL(finished(QNetworkReply*)),
           this, SLOT(downloadFinished(QNetworkReply*)));
 
-  if ((! load()) || (updatePeriodDays < dbAge()))
+  if (async)
+    loadAsync(updatePeriodDays);
+  else if ((! load()) || (updatePeriodDays < dbAge()))
     download();
 }
 
+UserDatabase::UserDatabase(const QString &filename, QObject *parent)
+  : QAbstractTableModel(parent), _file(), _buffer(), _count(0), _ids(nullptr), _strings(nullptr),
+    _pool(nullptr), _index(), _network(), _ingest(nullptr), _loader(nullptr),
+    _updatePeriod(0), _compiled(), _loadError()
+{
+  connect(&_network, SIGNAL(finished(QNetworkReply*)),
+          this, SLOT(downloadFinished(QNetworkReply*)));
+
+  load(filename);
+}
+
+UserDatabase::~UserDatabase() {
+  if (_loader)
+    _loader->wait();
+  if (_ingest)
+    delete _ingest;
+}
+
 qint64
 UserDatabase::count() const {
-  return _user.size();
+  return _count;
 }
 
 bool
@@ -69,78 +238,322 @@ UserDatabase::load() {
   return load(path+"/user.json");
 }
 
-const UserDatabase::User &
+UserDatabase::User
 UserDatabase::user(int idx) const {
-  return _user[idx];
+  if ((0 > idx) || (idx >= _index.size()))
+    return User();
+  return record(_index[idx]);
+}
+
+UserDatabase::User
+UserDatabase::record(quint32 i) const {
+  User user;
+  const quint32 *str = _strings + USERDB_STRINGS*i;
+  user.id      = _ids[i];
+  user.call    = QString::fromUtf8(_pool + str[0]);
+  user.name    = QString::fromUtf8(_pool + str[1]);
+  user.surname = QString::fromUtf8(_pool + str[2]);
+  user.city    = QString::fromUtf8(_pool + str[3]);
+  user.state   = QString::fromUtf8(_pool + str[4]);
+  user.country = QString::fromUtf8(_pool + str[5]);
+  user.comment = QString::fromUtf8(_pool + str[6]);
+  return user;
+}
+
+unsigned
+UserDatabase::userId(int idx) const {
+  if ((0 > idx) || (idx >= _index.size()))
+    return 0;
+  return _ids[_index[idx]];
 }
 
 bool
 UserDatabase::load(const QString &filename) {
+  QString msg;
+
+  // Check if the file itself is a binary user database
   QFile file(filename);
   if (! file.open(QIODevice::ReadOnly)) {
-    QString msg = QString("Cannot open user list '%1': %2").arg(filename).arg(file.errorString());
+    msg = QString("Cannot open user list '%1': %2").arg(filename).arg(file.errorString());
     logError() << msg;
     emit error(msg);
     return false;
   }
-  QByteArray data = file.readAll();
+  quint32 magic = 0;
+  bool isBinary = (sizeof(quint32) == file.read((char *)&magic, sizeof(quint32)))
+      && (USERDB_MAGIC == magic);
   file.close();
 
-  QJsonParseError err;
-  QJsonDocument doc = QJsonDocument::fromJson(data, &err);
-  if (doc.isEmpty()) {
-    QString msg = "Failed to load user DB: " + err.errorString();
+  // If not, check if there is an up-to-date binary user database compiled from the JSON file
+  QString binFilename = isBinary ? filename : binaryFilename(filename);
+  QFileInfo jsonInfo(filename), binInfo(binFilename);
+  if ((! isBinary) && binInfo.exists() && (binInfo.lastModified() < jsonInfo.lastModified()))
+    logDebug() << "Binary user database '" << binFilename << "' is outdated.";
+  else if (binInfo.exists()) {
+    beginResetModel();
+    detach();
+    _file.setFileName(binFilename);
+    uchar *data = nullptr;
+    if (_file.open(QIODevice::ReadOnly) && (data = _file.map(0, _file.size()))) {
+      if (attach(data, _file.size(), msg)) {
+        endResetModel();
+        logDebug() << "Mapped user database with " << _count << " entries from "
+                   << binFilename << ".";
+        emit loaded();
+        return true;
+      }
+      logDebug() << "Cannot use binary user database '" << binFilename << "': " << msg;
+    }
+    detach();
+    endResetModel();
+    if (isBinary) {
+      msg = QString("Failed to load user DB '%1': %2").arg(binFilename, msg);
+      logError() << msg;
+      emit error(msg);
+      return false;
+    }
+  }
+
+  // Parse JSON and compile binary user database
+  QVector<User> users;
+  if (! parse(filename, users, msg)) {
     logError() << msg;
     emit error(msg);
     return false;
   }
+  QByteArray buffer;
+  compile(users, buffer);
+  users.clear();
+  install(buffer, binFilename);
 
-  if (! doc.isObject()) {
-    QString msg = "Failed to load user DB: JSON document is not an object!";
-    logError() << msg;
-    emit error(msg);
+  logDebug() << "Loaded user database with " << _count << " entries from " << filename << ".";
+
+  emit loaded();
+  return true;
+}
+
+void
+UserDatabase::loadAsync(unsigned updatePeriodDays) {
+  if (_loader) {
+    logDebug() << "Loading of user database already running.";
+    return;
+  }
+
+  QString filename = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/user.json";
+  _updatePeriod = updatePeriodDays;
+  _compiled.clear();
+  _loadError.clear();
+  // Only parses and compiles the JSON file, the result gets installed by finishLoading().
+  _loader = new BackgroundTask([this, filename]() {
+    if ((! QFileInfo::exists(filename)) || isCompiled(filename))
+      return;
+    QVector<User> users;
+    if (parse(filename, users, _loadError))
+      compile(users, _compiled);
+  }, this);
+  connect(_loader, &QThread::finished, this, &UserDatabase::finishLoading);
+  _loader->start(QThread::LowPriority);
+}
+
+bool
+UserDatabase::isLoading() const {
+  return nullptr != _loader;
+}
+
+void
+UserDatabase::finishLoading() {
+  if (nullptr == _loader)
+    return;
+  _loader->wait();
+  _loader->deleteLater();
+  _loader = nullptr;
+
+  QString filename = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/user.json";
+  bool ok = true;
+  if (! _loadError.isEmpty()) {
+    logError() << _loadError;
+    emit error(_loadError);
+    ok = false;
+  } else if (! _compiled.isEmpty()) {
+    install(_compiled, binaryFilename(filename));
+    logDebug() << "Loaded user database with " << _count << " entries from " << filename << ".";
+    emit loaded();
+  } else {
+    // Binary user database is up-to-date, just map it
+    ok = load(filename);
+  }
+  _compiled.clear();
+  _loadError.clear();
+
+  if ((! ok) || (_updatePeriod < dbAge()))
+    download();
+}
+
+bool
+UserDatabase::isCompiled(const QString &filename) {
+  QFileInfo jsonInfo(filename), binInfo(binaryFilename(filename));
+  return binInfo.exists() && (binInfo.lastModified() >= jsonInfo.lastModified());
+}
+
+QString
+UserDatabase::binaryFilename(const QString &jsonFilename) {
+  QFileInfo info(jsonFilename);
+  return info.absolutePath() + "/" + info.completeBaseName() + ".bin";
+}
+
+bool
+UserDatabase::parse(const QString &filename, QVector<User> &users, QString &msg) const {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    msg = QString("Cannot open user list '%1': %2").arg(filename).arg(file.errorString());
     return false;
   }
-  if (! doc.object().contains("users")) {
-    QString msg = "Failed to load user DB: JSON object does not contain 'users' item.";
-    logError() << msg;
-    emit error(msg);
+
+  Ingest ingest;
+  if (! ingest.parser.parse(&file, ingest.err)) {
+    msg = "Failed to load user DB: " + ingest.err.format();
     return false;
   }
-  if (! doc.object()["users"].isArray()) {
-    QString msg = "Failed to load user DB: 'users' item is not an array.";
-    logError() << msg;
-    emit error(msg);
+  if (! ingest.found) {
+    msg = "Failed to load user DB: JSON object does not contain 'users' array.";
     return false;
   }
+  if (ingest.skipped)
+    logWarn() << "Skipped " << ingest.skipped << " malformed entries in user DB '" << filename << "'.";
 
+  users.swap(ingest.users);
+  return true;
+}
+
+void
+UserDatabase::compile(QVector<User> &users, QByteArray &buffer) {
+  // Sort users w.r.t. their IDs
+  std::stable_sort(users.begin(), users.end(), [](const User &a, const User &b){ return a.id < b.id; });
+
+  // Assemble string pool, equal strings are stored only once. The empty string is at offset 0.
+  QByteArray pool(1, '\0');
+  QHash<QString, quint32> offsets;
+  offsets.insert("", 0);
+  QVector<quint32> strings; strings.reserve(USERDB_STRINGS*users.size());
+  auto intern = [&pool, &offsets, &strings](const QString &str) {
+    QHash<QString, quint32>::const_iterator it = offsets.constFind(str);
+    if (offsets.constEnd() != it) {
+      strings.append(it.value());
+      return;
+    }
+    quint32 offset = pool.size();
+    pool.append(str.toUtf8()).append('\0');
+    offsets.insert(str, offset);
+    strings.append(offset);
+  };
+  foreach (const User &user, users) {
+    intern(user.call); intern(user.name); intern(user.surname); intern(user.city);
+    intern(user.state); intern(user.country); intern(user.comment);
+  }
+
+  // Assemble binary user database
+  UserDBHeader header;
+  header.magic    = USERDB_MAGIC;
+  header.count    = users.size();
+  header.poolSize = pool.size();
+  header.reserved = 0;
+  buffer.clear();
+  buffer.reserve(sizeof(UserDBHeader) + (1+USERDB_STRINGS)*sizeof(quint32)*users.size() + pool.size());
+  buffer.append((const char *)&header, sizeof(UserDBHeader));
+  foreach (const User &user, users)
+    buffer.append((const char *)&user.id, sizeof(quint32));
+  buffer.append((const char *)strings.constData(), strings.size()*sizeof(quint32));
+  buffer.append(pool);
+}
+
+void
+UserDatabase::install(QByteArray &buffer, const QString &binFilename) {
+  QString msg;
   beginResetModel();
-  _user.clear();
-
-  QJsonArray array = doc.object()["users"].toArray();
-  _user.reserve(array.size());
-  for (int i=0; i<array.size(); i++) {
-    User user(array.at(i).toObject());
-    if (user.isValid())
-      _user.append(user);
-  }
-  // Sort repeater w.r.t. their IDs
-  std::stable_sort(_user.begin(), _user.end(), [](const User &a, const User &b){ return a.id < b.id; });
-  // Done.
+  detach();
+  // Try to store the binary user database and map it, otherwise keep it in memory
+  QSaveFile binFile(binFilename);
+  if (binFile.open(QIODevice::WriteOnly) && (buffer.size() == binFile.write(buffer))
+      && binFile.commit()) {
+    _file.setFileName(binFilename);
+    uchar *data = nullptr;
+    if (_file.open(QIODevice::ReadOnly) && (data = _file.map(0, _file.size()))
+        && attach(data, _file.size(), msg)) {
+      buffer.clear();
+    } else {
+      detach();
+    }
+  } else {
+    logWarn() << "Cannot store binary user database at '" << binFilename << "': "
+              << binFile.errorString() << ".";
+  }
+  if (! buffer.isEmpty()) {
+    _buffer = buffer;
+    attach((const uchar *)_buffer.constData(), _buffer.size(), msg);
+  }
   endResetModel();
+}
 
-  logDebug() << "Loaded user database with " << _user.size() << " entries from " << filename << ".";
+bool
+UserDatabase::attach(const uchar *data, qint64 size, QString &msg) {
+  if (size < qint64(sizeof(UserDBHeader))) {
+    msg = "File too small.";
+    return false;
+  }
+  const UserDBHeader *header = (const UserDBHeader *)data;
+  if (USERDB_MAGIC != header->magic) {
+    msg = "Not a binary user database.";
+    return false;
+  }
+  qint64 expected = sizeof(UserDBHeader) + qint64(header->count)*(1+USERDB_STRINGS)*sizeof(quint32)
+      + header->poolSize;
+  if ((expected != size) || (0 == header->poolSize)) {
+    msg = QString("Invalid size %1b, expected %2b.").arg(size).arg(expected);
+    return false;
+  }
+
+  const quint32 *ids = (const quint32 *)(data + sizeof(UserDBHeader));
+  const quint32 *strings = ids + header->count;
+  const char *pool = (const char *)(strings + USERDB_STRINGS*header->count);
+  // Check string offsets, the pool must end with a 0-byte
+  if (0 != pool[header->poolSize-1]) {
+    msg = "String pool is not terminated.";
+    return false;
+  }
+  for (quint32 i=0; i<USERDB_STRINGS*header->count; i++) {
+    if (strings[i] >= header->poolSize) {
+      msg = QString("Invalid string offset %1.").arg(strings[i]);
+      return false;
+    }
+  }
+
+  _count = header->count;
+  _ids = ids;
+  _strings = strings;
+  _pool = pool;
+  _index.resize(_count);
+  for (quint32 i=0; i<_count; i++)
+    _index[i] = i;
 
-  emit loaded();
   return true;
 }
 
+void
+UserDatabase::detach() {
+  _count = 0;
+  _ids = nullptr;
+  _strings = nullptr;
+  _pool = nullptr;
+  _index.clear();
+  _buffer.clear();
+  if (_file.isOpen())
+    _file.close(); // also unmaps
+}
+
 void
 UserDatabase::sortUsers(unsigned id) {
-  // Sort repeater w.r.t. distance to ID
-  std::stable_sort(_user.begin(), _user.end(), [id](const User &a, const User &b){
-    return a.distance(id) < b.distance(id);
-  });
+  QSet<unsigned> ids; ids.insert(id);
+  sortUsers(ids);
 }
 
 void
@@ -148,37 +561,65 @@ UserDatabase::sortUsers(const QSet<unsigned> &ids) {
   if (0 == ids.count())
     return;
 
-  // Sort repeater w.r.t. distance to each ID
-  std::stable_sort(_user.begin(), _user.end(), [ids](const User &a, const User &b){
-    QSet<unsigned>::const_iterator id=ids.begin();
-    unsigned min_a = a.distance(*id), min_b = b.distance(*id);
-    id++;
-    for (; id!=ids.end(); id++) {
-      min_a = std::min(min_a, a.distance(*id));
-      min_b = std::min(min_b, b.distance(*id));
-    }
-    return min_a < min_b;
+  // Sort users w.r.t. the minimum distance to any ID, computed once per user
+  QVector<quint32> dist = distances(ids);
+  std::stable_sort(_index.begin(), _index.end(), [&dist](quint32 a, quint32 b){
+    return dist[a] < dist[b];
   });
 }
 
-void
-UserDatabase::download() {
-  QUrl url("https://database.radioid.net/static/users.json");
-  QNetworkRequest request(url);
-  _network.get(request);
+QVector<UserDatabase::User>
+UserDatabase::closest(const QSet<unsigned> &ids, unsigned k) const {
+  k = std::min(k, _count);
+
+  // Key of each user is its distance (upper 32 bits) and its index (lower 32 bits). As users are
+  // stored in ascending order of their IDs, ties are broken by ID.
+  std::vector<quint64> keys(_count);
+  if (ids.isEmpty()) {
+    for (quint32 i=0; i<_count; i++)
+      keys[i] = i;
+  } else {
+    QVector<quint32> dist = distances(ids);
+    for (quint32 i=0; i<_count; i++)
+      keys[i] = (quint64(dist[i]) << 32) | i;
+  }
+
+  // Partial selection of the k closest users
+  if (k < _count)
+    std::nth_element(keys.begin(), keys.begin()+k, keys.end());
+  keys.resize(k);
+  // Order them by ID, i.e., by index
+  std::sort(keys.begin(), keys.end(), [](quint64 a, quint64 b) {
+    return quint32(a) < quint32(b);
+  });
+
+  QVector<User> users;
+  users.reserve(k);
+  for (quint64 key : keys)
+    users.append(record(quint32(key)));
+  return users;
+}
+
+QVector<quint32>
+UserDatabase::distances(const QSet<unsigned> &ids) const {
+  QVector<quint32> dist(_count, std::numeric_limits<quint32>::max());
+  foreach (unsigned id, ids) {
+    for (quint32 i=0; i<_count; i++)
+      dist[i] = std::min(dist[i], quint32(User::distance(_ids[i], id)));
+  }
+  return dist;
 }
 
 void
-UserDatabase::downloadFinished(QNetworkReply *reply) {
-  if (reply->error()) {
-    QString msg = QString("Cannot download user database: %1").arg(reply->errorString());
-    logError() << msg;
-    emit error(msg);
+UserDatabase::download() {
+  // Apply a running background load first, it must not replace the downloaded database later.
+  finishLoading();
+  if (_ingest) {
+    logDebug() << "Download of user database already running.";
     return;
   }
 
   QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-  QFile file(path+"/user.json");
   QDir directory;
   if ((! directory.exists(path)) && (!directory.mkpath(path))) {
     QString msg = QString("Cannot create path '%1'.").arg(path);
@@ -186,19 +627,78 @@ UserDatabase::downloadFinished(QNetworkReply *reply) {
     emit error(msg);
     return;
   }
-  if (! file.open(QIODevice::WriteOnly)) {
+
+  // The document is parsed and written to disk as it arrives
+  _ingest = new Ingest();
+  _ingest->file.setFileName(path+"/user.json");
+  if (! _ingest->file.open(QIODevice::WriteOnly)) {
     QString msg = QString("Cannot save user database at '%1'.").arg(path+"/user.json");
     logError() << msg;
     emit error(msg);
+    delete _ingest; _ingest = nullptr;
     return;
   }
 
-  file.write(reply->readAll());
-  file.flush();
-  file.close();
+  QUrl url("https://database.radioid.net/static/users.json");
+  QNetworkRequest request(url);
+  QNetworkReply *reply = _network.get(request);
+  connect(reply, SIGNAL(readyRead()), this, SLOT(downloadReadyRead()));
+}
+
+void
+UserDatabase::downloadReadyRead() {
+  QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+  if ((nullptr == reply) || (nullptr == _ingest))
+    return;
+
+  QByteArray chunk = reply->readAll();
+  _ingest->file.write(chunk);
+  if (_ingest->ok)
+    _ingest->ok = _ingest->parser.feed(chunk, _ingest->err);
+}
 
-  load();
+void
+UserDatabase::downloadFinished(QNetworkReply *reply) {
   reply->deleteLater();
+  if (nullptr == _ingest)
+    return;
+
+  if (reply->error()) {
+    QString msg = QString("Cannot download user database: %1").arg(reply->errorString());
+    logError() << msg;
+    emit error(msg);
+    _ingest->file.cancelWriting();
+    delete _ingest; _ingest = nullptr;
+    return;
+  }
+
+  // Process remaining data
+  downloadReadyRead();
+  Ingest *ingest = _ingest; _ingest = nullptr;
+  if ((! ingest->ok) || (! ingest->parser.finish(ingest->err)) || (! ingest->found)) {
+    QString msg = "Downloaded user database is invalid: " +
+        (ingest->found ? ingest->err.format() : "No 'users' array.");
+    logError() << msg;
+    emit error(msg);
+    ingest->file.cancelWriting();
+    delete ingest;
+    return;
+  }
+  if (! ingest->file.commit())
+    logWarn() << "Cannot save user database at '" << ingest->file.fileName() << "': "
+              << ingest->file.errorString() << ".";
+  if (ingest->skipped)
+    logWarn() << "Skipped " << ingest->skipped << " malformed entries in downloaded user DB.";
+
+  QByteArray buffer;
+  compile(ingest->users, buffer);
+  QString binFilename = binaryFilename(ingest->file.fileName());
+  delete ingest;
+  install(buffer, binFilename);
+
+  logDebug() << "Downloaded user database with " << _count << " entries.";
+
+  emit loaded();
 }
 
 unsigned
@@ -213,7 +713,7 @@ UserDatabase::dbAge() const {
 int
 UserDatabase::rowCount(const QModelIndex &parent) const {
   Q_UNUSED(parent);
-  return _user.size();
+  return _count;
 }
 
 int
@@ -227,37 +727,39 @@ UserDatabase::data(const QModelIndex &index, int role) const {
   if ((Qt::EditRole != role) && ((Qt::DisplayRole != role)))
     return QVariant();
 
-  if (index.row() >= _user.size())
+  if (index.row() >= _index.size())
     return QVariant();
 
+  if (1 == index.column()) {
+    // ID, no need to decode the entire entry
+    return userId(index.row());
+  }
+
+  User entry = user(index.row());
   if (0 == index.column()) {
     // Call
     if (Qt::DisplayRole == role) {
-      if (_user[index.row()].surname.isEmpty()) {
-        if (_user[index.row()].name.isEmpty()) {
-          return _user[index.row()].call;
+      if (entry.surname.isEmpty()) {
+        if (entry.name.isEmpty()) {
+          return entry.call;
         } else {
           return tr("%1 (%2)")
-              .arg(_user[index.row()].call)
-              .arg(_user[index.row()].name);
+              .arg(entry.call)
+              .arg(entry.name);
         }
       } else {
         return tr("%1 (%2, %3)")
-            .arg(_user[index.row()].call)
-            .arg(_user[index.row()].name)
-            .arg(_user[index.row()].surname);
+            .arg(entry.call)
+            .arg(entry.name)
+            .arg(entry.surname);
       }
     } else {
-      return _user[index.row()].call;
+      return entry.call;
     }
-  } else if (1 == index.column()) {
-    // ID
-    return _user[index.row()].id;
   } else if (2 == index.column()) {
     // Country
-    return _user[index.column()].country;
+    return entry.country;
   }
 
   return QVariant();
 }
-
@@ -4,12 +4,15 @@
 #include <QObject>
 #include <QVector>
 #include <QHash>
+#include <QFile>
 #include <QJsonObject>
 #include <QNetworkAccessManager>
 #include <QAbstractTableModel>
 #include <QSortFilterProxyModel>
 #include <QGeoPositionInfoSource>
 
+class BackgroundTask;
+
 /** Auto-updating DMR user database.
  *
  * This class represents the complete DMR user database. The user database gets downloaded from
@@ -18,6 +21,13 @@
  * to help assemble private call contacts and to assemble so-called CSV callsign databases, that
  * are programmable to some DMR radios to resolve the DMR ID to callsigns and names.
  *
+ * Parsing the JSON file is expensive. Hence, it is parsed once after every download and compiled
+ * into a compact binary file (@c user.bin), next to the JSON file. This binary file is then
+ * memory-mapped read-only. It consists of a header, the column of all IDs in ascending order,
+ * a table of string offsets (7 per user) and a pool of zero-terminated UTF-8 strings. Equal
+ * strings (e.g., country names) are stored only once. The @c User instances are then decoded
+ * on demand from the mapped file.
+ *
  * @ingroup util */
 class UserDatabase : public QAbstractTableModel
 {
@@ -37,6 +47,8 @@ public:
 
     /** Returns the "distance" between this user and the given ID. */
     unsigned distance(unsigned id) const;
+    /** Returns the "distance" between the two given IDs. */
+    static unsigned distance(unsigned a, unsigned b);
 
     /** The DMR ID of the user. */
     unsigned id;
@@ -59,8 +71,16 @@ public:
 public:
   /** Constructs the user-database.
    * The constructor will download the current user database if it was not downloaded yet or
-   * if the downloaded version is older than @c updatePeriodDays days. */
-  explicit UserDatabase(unsigned updatePeriodDays=30, QObject *parent=nullptr);
+   * if the downloaded version is older than @c updatePeriodDays days. If @c async is @c true,
+   * the database gets loaded in the background (see @c loadAsync) and the constructor returns
+   * immediately. */
+  explicit UserDatabase(unsigned updatePeriodDays=30, QObject *parent=nullptr, bool async=false);
+  /** Constructs the user-database from the given file, either a downloaded JSON file or a
+   * compiled binary user database. In contrast to the default constructor, the database is
+   * neither loaded from the application data directory nor downloaded. */
+  explicit UserDatabase(const QString &filename, QObject *parent=nullptr);
+  /** Destructor. */
+  virtual ~UserDatabase();
 
   /** Returns the number of users. */
   qint64 count() const;
@@ -69,14 +89,30 @@ public:
   bool load();
   /** Loads all entries from the downloaded user database at the specified location. */
   bool load(const QString &filename);
+  /** Loads the downloaded user database in the background. If needed, the JSON file gets parsed
+   * and compiled on a separate thread. Once done, either @c loaded or @c error gets emitted. If
+   * the database is missing or older than @c updatePeriodDays days, it gets downloaded. */
+  void loadAsync(unsigned updatePeriodDays=30);
+  /** Returns @c true, if the database is being loaded in the background. */
+  bool isLoading() const;
+  /** Blocks until a background load is complete and applies its result. */
+  void finishLoading();
 
   /** Sorts users with respect to the distance to the given ID. */
   void sortUsers(unsigned id);
   /** Sorts users with respect to the minimum distance to the given IDs. */
   void sortUsers(const QSet<unsigned> &ids);
 
-  /** Returns the user with index @c idx. */
-  const User &user(int idx) const;
+  /** Selects the @c k users closest to the given IDs (see @c User::distance) and returns them in
+   * ascending order of their IDs. If @c ids is empty, the first @c k users w.r.t. their IDs are
+   * returned. In contrast to @c sortUsers, the order of the model is not changed. */
+  QVector<User> closest(const QSet<unsigned> &ids, unsigned k) const;
+
+  /** Returns the user with index @c idx. The entry is decoded from the binary user database. */
+  User user(int idx) const;
+  /** Returns the ID of the user with index @c idx. This is cheaper than decoding the complete
+   * user entry. */
+  unsigned userId(int idx) const;
 
   /** Returns the age of the database in days. */
   unsigned dbAge() const;
@@ -99,14 +135,65 @@ public slots:
   void download();
 
 private slots:
+  /** Gets called whenever new data of the download arrived. */
+  void downloadReadyRead();
   /** Gets called whenever the download is complete. */
   void downloadFinished(QNetworkReply *reply);
 
 private:
-  /** Holds all users sorted by their ID. */
-  QVector<User>         _user;
+  /** Forward declaration of the JSON ingest handler. */
+  class Ingest;
+
+  /** Parses the given JSON user database. Malformed entries are skipped. */
+  bool parse(const QString &filename, QVector<User> &users, QString &msg) const;
+  /** Compiles the given users into the binary representation. */
+  static void compile(QVector<User> &users, QByteArray &buffer);
+  /** Returns @c true if there is a binary user database that is up-to-date w.r.t. the given
+   * JSON file. */
+  static bool isCompiled(const QString &filename);
+  /** Stores the compiled binary user database and maps it. If it cannot be stored, it is
+   * kept in memory. */
+  void install(QByteArray &buffer, const QString &binFilename);
+  /** Decodes the user at index @c i within the binary user database. */
+  User record(quint32 i) const;
+  /** Computes the minimum distance of every user to the given IDs. */
+  QVector<quint32> distances(const QSet<unsigned> &ids) const;
+
+  /** Returns the file name of the binary user database compiled from the given JSON file. */
+  static QString binaryFilename(const QString &jsonFilename);
+  /** Checks the binary user database and sets the pointers into it. */
+  bool attach(const uchar *data, qint64 size, QString &msg);
+  /** Unmaps and resets the binary user database. */
+  void detach();
+
+private:
+  /** The file holding the binary user database, if memory-mapped. */
+  QFile                 _file;
+  /** Holds the binary user database, if it cannot be memory-mapped. */
+  QByteArray            _buffer;
+  /** Number of users in the binary user database. */
+  quint32               _count;
+  /** Column of all user IDs, in ascending order. */
+  const quint32        *_ids;
+  /** String offsets (call, name, surname, city, state, country, comment) of all users. */
+  const quint32        *_strings;
+  /** The string pool. */
+  const char           *_pool;
+  /** Maps the model row to the index within the binary user database. Changed by sorting. */
+  QVector<quint32>      _index;
   /** The network access used for downloading. */
   QNetworkAccessManager _network;
+  /** The ingest of the running download, if any. */
+  Ingest               *_ingest;
+  /** The running background load, if any. */
+  BackgroundTask       *_loader;
+  /** Update period in days, checked once the background load is complete. */
+  unsigned              _updatePeriod;
+  /** The binary user database compiled by the background load. Empty, if the binary database
+   * was up-to-date. */
+  QByteArray            _compiled;
+  /** The error message of the background load, if any. */
+  QString               _loadError;
 };
 
 
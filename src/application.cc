@@ -4,6 +4,9 @@
 #include <QDesktopServices>
 #include <QTranslator>
 #include <QStandardPaths>
+#include <QElapsedTimer>
+#include <QPushButton>
+#include <QToolBar>
 
 #include "logger.hh"
 #include "radio.hh"
@@ -57,6 +60,7 @@ Application::Application(int &argc, char *argv[])
   : QApplication(argc, argv), _config(nullptr), _mainWindow(nullptr), _translator(nullptr),
     _repeater(nullptr), _lastDevice()
 {
+  QElapsedTimer startup; startup.start();
   setApplicationName("qdmr");
   setOrganizationName("DM3MAT");
   setOrganizationDomain("hmatuschek.github.io");
@@ -84,10 +88,19 @@ Application::Application(int &argc, char *argv[])
 
   // load settings
   Settings settings;
-  // load databases
+  // load databases in the background, these are not needed to show the main window
   _repeater   = new RepeaterBookList(this);
-  _users      = new UserDatabase(30, this);
-  _talkgroups = new TalkGroupDatabase(30, this);
+  _users      = new UserDatabase(30, this, true);
+  _talkgroups = new TalkGroupDatabase(30, this, true);
+  connect(_repeater, &RepeaterBookList::loaded, this, [startup]() {
+    logInfo() << "Repeater cache ready after " << startup.elapsed() << "ms.";
+  });
+  connect(_users, &UserDatabase::loaded, this, [startup]() {
+    logInfo() << "User database ready after " << startup.elapsed() << "ms.";
+  });
+  connect(_talkgroups, &TalkGroupDatabase::loaded, this, [startup]() {
+    logInfo() << "Talk group database ready after " << startup.elapsed() << "ms.";
+  });
   // create empty codeplug
   _config     = new Config(this);
 
@@ -132,6 +145,7 @@ Application::Application(int &argc, char *argv[])
 
   logDebug() << "Last known position: " << _currentPosition.toString();
   connect(_config, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModifed()));
+  logInfo() << "Application initialized after " << startup.elapsed() << "ms.";
 }
 
 Application::~Application() {
@@ -196,6 +210,12 @@ Application::createMainWindow() {
   _mainWindow->statusBar()->addPermanentWidget(progress);
   progress->setVisible(false);
 
+  QPushButton *cancelTransfer = new QPushButton(tr("Cancel"));
+  cancelTransfer->setObjectName("cancelTransfer");
+  cancelTransfer->setToolTip(tr("Cancels the transfer. The radio gets rebooted."));
+  _mainWindow->statusBar()->addPermanentWidget(cancelTransfer);
+  cancelTransfer->setVisible(false);
+
   QAction *newCP   = _mainWindow->findChild<QAction*>("actionNewCodeplug");
   QAction *loadCP  = _mainWindow->findChild<QAction*>("actionOpenCodeplug");
   QAction *saveCP  = _mainWindow->findChild<QAction*>("actionSaveCodeplug");
@@ -560,7 +580,7 @@ Application::downloadCodeplug() {
   ErrorStack err;
   if (radio->startDownload(false, err)) {
     _mainWindow->statusBar()->showMessage(tr("Read ..."));
-    _mainWindow->setEnabled(false);
+    setTransferRadio(radio);
   } else {
     ErrorMessageView(err).show();
     progress->setVisible(false);
@@ -569,10 +589,11 @@ Application::downloadCodeplug() {
 
 void
 Application::onCodeplugDownloadError(Radio *radio) {
-  _mainWindow->statusBar()->showMessage(tr("Read error"));
+  _mainWindow->statusBar()->showMessage(
+        radio->job()->isCancelled() ? tr("Read cancelled") : tr("Read error"));
   ErrorMessageView(radio->errorStack()).show();
   _mainWindow->findChild<QProgressBar *>("progress")->setVisible(false);
-  _mainWindow->setEnabled(true);
+  setTransferRadio(nullptr);
 
   if (radio->wait(250))
     radio->deleteLater();
@@ -593,7 +614,7 @@ Application::onCodeplugDownloaded(Radio *radio, Codeplug *codeplug) {
   } else {
     ErrorMessageView(err).show();
   }
-  _mainWindow->setEnabled(true);
+  setTransferRadio(nullptr);
 
   if (radio->wait(250))
     radio->deleteLater();
@@ -628,7 +649,7 @@ Application::uploadCodeplug() {
   ErrorStack err;
   if (radio->startUpload(_config, false, settings.codePlugFlags(), err)) {
      _mainWindow->statusBar()->showMessage(tr("Upload ..."));
-     _mainWindow->setEnabled(false);
+     setTransferRadio(radio);
   } else {
     ErrorMessageView(err).show();
     progress->setVisible(false);
@@ -664,9 +685,13 @@ Application::uploadCallsignDB() {
     return;
   }
 
-  // Sort call-sign DB w.r.t. the current DMR ID in _config
+  // The user DB may still be loading in the background
+  _users->finishLoading();
+
+  // Select call-signs w.r.t. the current DMR ID in _config
   // this is part of the "auto-selection" of calls-signs for upload
   Settings settings;
+  CallsignDB::Selection css;
   if (settings.selectUsingUserDMRID()) {
     if (nullptr == _config->radioIDs()->defaultId()) {
       QMessageBox::critical(nullptr, tr("Cannot write call-sign DB."),
@@ -675,21 +700,20 @@ Application::uploadCallsignDB() {
       radio->deleteLater();
       return;
     }
-    // Sort w.r.t users DMR ID
+    // Select w.r.t users DMR ID
     unsigned id = _config->radioIDs()->defaultId()->number();
-    logDebug() << "Sort call-signs closest to ID=" << id << ".";
-    _users->sortUsers(id);
+    logDebug() << "Select call-signs closest to ID=" << id << ".";
+    css.setPrefixes(QSet<unsigned>{id});
   } else {
-    // sort w.r.t. chosen prefixes
+    // select w.r.t. chosen prefixes
     QSet<unsigned> ids=settings.callSignDBPrefixes(); QStringList prefs;
     foreach (unsigned pref, ids)
       prefs.append(QString::number(pref));
-    logDebug() << "Sort call-signs closest to IDs={" << prefs.join(", ") << "}.";
-    _users->sortUsers(ids);
+    logDebug() << "Select call-signs closest to IDs={" << prefs.join(", ") << "}.";
+    css.setPrefixes(ids);
   }
 
   // Assemble flags for callsign DB encoding
-  CallsignDB::Selection css;
   if (settings.limitCallSignDBEntries()) {
     logDebug() << "Limit callsign DB entries to " << settings.maxCallSignDBEntries() << ".";
     css.setCountLimit(settings.maxCallSignDBEntries());
@@ -707,7 +731,7 @@ Application::uploadCallsignDB() {
   if (radio->startUploadCallsignDB(_users, false, css, err)) {
     logDebug() << "Start call-sign DB write...";
     _mainWindow->statusBar()->showMessage(tr("Write call-sign DB ..."));
-    _mainWindow->setEnabled(false);
+    setTransferRadio(radio);
   } else {
     ErrorMessageView(err).show();
     progress->setVisible(false);
@@ -717,10 +741,11 @@ Application::uploadCallsignDB() {
 
 void
 Application::onCodeplugUploadError(Radio *radio) {
-  _mainWindow->statusBar()->showMessage(tr("Write error"));
+  _mainWindow->statusBar()->showMessage(
+        radio->job()->isCancelled() ? tr("Write cancelled") : tr("Write error"));
   ErrorMessageView(radio->errorStack()).show();
   _mainWindow->findChild<QProgressBar *>("progress")->setVisible(false);
-  _mainWindow->setEnabled(true);
+  setTransferRadio(nullptr);
 
   if (radio->wait(250))
     radio->deleteLater();
@@ -731,7 +756,7 @@ void
 Application::onCodeplugUploaded(Radio *radio) {
   _mainWindow->statusBar()->showMessage(tr("Write complete"));
   _mainWindow->findChild<QProgressBar *>("progress")->setVisible(false);
-  _mainWindow->setEnabled(true);
+  setTransferRadio(nullptr);
 
   logDebug() << "Write complete.";
 
@@ -740,6 +765,29 @@ Application::onCodeplugUploaded(Radio *radio) {
 }
 
 
+void
+Application::setTransferRadio(Radio *radio) {
+  bool active = (nullptr != radio);
+  _mainWindow->centralWidget()->setEnabled(! active);
+  _mainWindow->menuBar()->setEnabled(! active);
+  foreach (QToolBar *toolbar, _mainWindow->findChildren<QToolBar *>())
+    toolbar->setEnabled(! active);
+
+  QPushButton *cancel = _mainWindow->findChild<QPushButton *>("cancelTransfer");
+  cancel->disconnect();
+  cancel->setEnabled(true);
+  cancel->setVisible(active);
+  if (! active)
+    return;
+
+  connect(cancel, &QPushButton::clicked, radio, &Radio::cancel);
+  connect(cancel, &QPushButton::clicked, cancel, [cancel]() { cancel->setEnabled(false); });
+  connect(radio->job(), &TransferJob::progressed, this, [this](const TransferProgress &progress) {
+    _mainWindow->statusBar()->showMessage(progress.format());
+  });
+}
+
+
 void
 Application::showSettings() {
   SettingsDialog dialog;
@@ -80,6 +80,12 @@ private slots:
 
   void onPaletteChanged(const QPalette &palette);
 
+protected:
+  /** Disables the main window while the given radio transfers a codeplug or call-sign DB, except
+   * for the status bar showing the progress and the cancel button. Pass @c nullptr once the
+   * transfer finished. */
+  void setTransferRadio(Radio *radio);
+
 protected:
   Config *_config;
   QMainWindow *_mainWindow;
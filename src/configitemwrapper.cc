@@ -1,16 +1,105 @@
 #include "configitemwrapper.hh"
 #include <cmath>
+#include <algorithm>
 #include "logger.hh"
 #include <QColor>
 #include <QPalette>
 #include <QWidget>
+#include <QTimer>
+#include <QEvent>
+
+
+/* ********************************************************************************************* *
+ * Implementation of SearchIndex
+ * ********************************************************************************************* */
+SearchIndex::SearchIndex(const QAbstractItemModel *model)
+  : _model(model), _rows(), _generation(0)
+{
+  // pass...
+}
+
+unsigned
+SearchIndex::generation() const {
+  return _generation;
+}
+
+QModelIndexList
+SearchIndex::match(const QString &text, const QModelIndexList *within) const {
+  QString needle = text.toCaseFolded();
+  int rows = _model->rowCount(), columns = _model->columnCount();
+  if (_rows.size() != rows) {
+    // Out of sync, start over
+    _rows.clear();
+    _rows.resize(rows);
+  }
+
+  QModelIndexList matches;
+  if (within) {
+    foreach (const QModelIndex &index, *within) {
+      if ((index.row() < rows) && (index.column() < columns)
+          && cells(index.row()).at(index.column()).contains(needle))
+        matches.append(index);
+    }
+    return matches;
+  }
+
+  for (int row=0; row<rows; row++) {
+    const QStringList &texts = cells(row);
+    for (int column=0; column<columns; column++) {
+      if (texts.at(column).contains(needle))
+        matches.append(_model->index(row, column));
+    }
+  }
+  return matches;
+}
+
+void
+SearchIndex::insertRow(int row) {
+  _generation++;
+  if ((0 <= row) && (row <= _rows.size()))
+    _rows.insert(row, QStringList());
+  else
+    _rows.clear();
+}
+
+void
+SearchIndex::removeRow(int row) {
+  _generation++;
+  if ((0 <= row) && (row < _rows.size()))
+    _rows.remove(row);
+  else
+    _rows.clear();
+}
+
+void
+SearchIndex::invalidate(int first, int last) {
+  _generation++;
+  for (int row=std::max(0, first); (row<=last) && (row<_rows.size()); row++)
+    _rows[row].clear();
+}
+
+void
+SearchIndex::clear() {
+  _generation++;
+  _rows.clear();
+}
+
+const QStringList &
+SearchIndex::cells(int row) const {
+  QStringList &texts = _rows[row];
+  if (texts.isEmpty()) {
+    for (int column=0; column<_model->columnCount(); column++)
+      texts.append(_model->index(row, column).data(Qt::DisplayRole).toString().toCaseFolded());
+  }
+  return texts;
+}
 
 
 /* ********************************************************************************************* *
  * Implementation of GenericListWrapper
  * ********************************************************************************************* */
 GenericListWrapper::GenericListWrapper(AbstractConfigObjectList *list, QObject *parent)
-  : QAbstractListModel(parent), _list(list)
+  : QAbstractListModel(parent), _list(list), _searchIndex(this)
 {
   if (nullptr == _list)
     return;
@@ -19,6 +108,13 @@ GenericListWrapper::GenericListWrapper(AbstractConfigObjectList *list, QObject *
   connect(_list, SIGNAL(elementAdded(int)), this, SLOT(onItemAdded(int)));
   connect(_list, SIGNAL(elementModified(int)), this, SLOT(onItemModified(int)));
   connect(_list, SIGNAL(elementRemoved(int)), this, SLOT(onItemRemoved(int)));
+  if (const Config *config = _list->config())
+    connect(config, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModified()));
+}
+
+SearchIndex *
+GenericListWrapper::searchIndex() const {
+  return &_searchIndex;
 }
 
 int
@@ -43,6 +139,7 @@ GenericListWrapper::moveUp(int row) {
     return false;
   beginMoveRows(QModelIndex(), row, row, QModelIndex(), row-1);
   _list->moveUp(row);
+  _searchIndex.invalidate(row-1, row);
   endMoveRows();
   emit modified();
   return true;
@@ -54,6 +151,7 @@ GenericListWrapper::moveUp(int first, int last) {
     return false;
   beginMoveRows(QModelIndex(), first, last, QModelIndex(), first-1);
   _list->moveUp(first, last);
+  _searchIndex.invalidate(first-1, last);
   endMoveRows();
   emit modified();
   return true;
@@ -65,6 +163,7 @@ GenericListWrapper::moveDown(int row) {
     return false;
   beginMoveRows(QModelIndex(), row, row, QModelIndex(), row+2);
   _list->moveDown(row);
+  _searchIndex.invalidate(row, row+1);
   endMoveRows();
   emit modified();
   return true;
@@ -76,6 +175,7 @@ GenericListWrapper::moveDown(int first, int last) {
     return false;
   beginMoveRows(QModelIndex(), first, last, QModelIndex(), last+2);
   _list->moveDown(first, last);
+  _searchIndex.invalidate(first, last+1);
   endMoveRows();
   emit modified();
   return true;
@@ -86,34 +186,47 @@ void
 GenericListWrapper::onListDeleted() {
   beginResetModel();
   _list = nullptr;
+  _searchIndex.clear();
   endResetModel();
 }
 
 void
 GenericListWrapper::onItemAdded(int idx) {
   beginInsertRows(QModelIndex(), idx, idx);
+  _searchIndex.insertRow(idx);
   endInsertRows();
 }
 
 void
 GenericListWrapper::onItemRemoved(int idx) {
   beginRemoveRows(QModelIndex(), idx, idx);
+  _searchIndex.removeRow(idx);
   //logDebug() << "Signal removal of item at idx=" << idx;
   endRemoveRows();
 }
 
 void
 GenericListWrapper::onItemModified(int idx) {
+  _searchIndex.invalidate(idx, idx);
   emit dataChanged(index(idx),index(idx));
 }
 
+void
+GenericListWrapper::onConfigModified() {
+  _searchIndex.clear();
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of GenericTableWrapper
  * ********************************************************************************************* */
 GenericTableWrapper::GenericTableWrapper(AbstractConfigObjectList *list, QObject *parent)
-  : QAbstractTableModel(parent), _list(list)
+  : QAbstractTableModel(parent), _list(list), _searchIndex(this), _rendered(),
+    _changedFirst(-1), _changedLast(-1)
 {
+  if (QWidget *view = qobject_cast<QWidget *>(parent))
+    view->installEventFilter(this);
+
   if (nullptr == _list)
     return;
 
@@ -121,6 +234,82 @@ GenericTableWrapper::GenericTableWrapper(AbstractConfigObjectList *list, QObject
   connect(_list, SIGNAL(elementAdded(int)), this, SLOT(onItemAdded(int)));
   connect(_list, SIGNAL(elementModified(int)), this, SLOT(onItemModified(int)));
   connect(_list, SIGNAL(elementRemoved(int)), this, SLOT(onItemRemoved(int)));
+  if (const Config *config = _list->config())
+    connect(config, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModified()));
+}
+
+SearchIndex *
+GenericTableWrapper::searchIndex() const {
+  return &_searchIndex;
+}
+
+bool
+GenericTableWrapper::eventFilter(QObject *obj, QEvent *event) {
+  if (QEvent::PaletteChange == event->type()) {
+    _rendered.clear();
+    markChanged(0, rowCount(QModelIndex())-1);
+  }
+  return QAbstractTableModel::eventFilter(obj, event);
+}
+
+QVariant
+GenericTableWrapper::cachedData(const QModelIndex &index, int role) const {
+  int slot;
+  switch (role) {
+  case Qt::DisplayRole: slot = 0; break;
+  case Qt::EditRole: slot = 1; break;
+  case Qt::ForegroundRole: slot = 2; break;
+  default: return renderData(index, role);
+  }
+
+  int rows = rowCount(QModelIndex()), columns = columnCount();
+  if ((! index.isValid()) || (index.row() >= rows) || (index.column() >= columns))
+    return QVariant();
+  if (_rendered.size() != rows) {
+    // Out of sync, start over
+    _rendered.clear();
+    _rendered.resize(rows);
+  }
+
+  RenderedRow &row = _rendered[index.row()];
+  if (row.cells.size() != 3*columns) {
+    row.roles = 0;
+    row.cells.resize(3*columns);
+  }
+  if (0 == (row.roles & (1<<slot))) {
+    for (int column=0; column<columns; column++)
+      row.cells[slot*columns+column] = renderData(this->index(index.row(), column), role);
+    row.roles |= (1<<slot);
+  }
+  return row.cells[slot*columns+index.column()];
+}
+
+QVariant
+GenericTableWrapper::renderData(const QModelIndex &index, int role) const {
+  Q_UNUSED(index); Q_UNUSED(role);
+  return QVariant();
+}
+
+void
+GenericTableWrapper::markChanged(int first, int last) {
+  if (first > last)
+    return;
+  if (0 > _changedFirst) {
+    _changedFirst = first; _changedLast = last;
+    QTimer::singleShot(0, this, SLOT(emitPendingChanges()));
+  } else {
+    _changedFirst = std::min(_changedFirst, first);
+    _changedLast = std::max(_changedLast, last);
+  }
+}
+
+void
+GenericTableWrapper::emitPendingChanges() {
+  int first = _changedFirst, last = std::min(_changedLast, rowCount(QModelIndex())-1);
+  _changedFirst = _changedLast = -1;
+  if ((0 > first) || (first > last))
+    return;
+  emit dataChanged(index(first, 0), index(last, columnCount()-1));
 }
 
 int
@@ -137,6 +326,8 @@ GenericTableWrapper::moveUp(int row) {
     return false;
   beginMoveRows(QModelIndex(), row, row, QModelIndex(), row-1);
   _list->moveUp(row);
+  _searchIndex.invalidate(row-1, row);
+  invalidateRendered(row-1, row);
   endMoveRows();
   emit modified();
   return true;
@@ -148,6 +339,8 @@ GenericTableWrapper::moveUp(int first, int last) {
     return false;
   beginMoveRows(QModelIndex(), first, last, QModelIndex(), first-1);
   _list->moveUp(first, last);
+  _searchIndex.invalidate(first-1, last);
+  invalidateRendered(first-1, last);
   endMoveRows();
   emit modified();
   return true;
@@ -159,6 +352,8 @@ GenericTableWrapper::moveDown(int row) {
     return false;
   beginMoveRows(QModelIndex(), row, row, QModelIndex(), row+2);
   _list->moveDown(row);
+  _searchIndex.invalidate(row, row+1);
+  invalidateRendered(row, row+1);
   endMoveRows();
   emit modified();
   return true;
@@ -170,6 +365,8 @@ GenericTableWrapper::moveDown(int first, int last) {
     return false;
   beginMoveRows(QModelIndex(), first, last, QModelIndex(), last+2);
   _list->moveDown(first, last);
+  _searchIndex.invalidate(first, last+1);
+  invalidateRendered(first, last+1);
   endMoveRows();
   emit modified();
   return true;
@@ -179,25 +376,53 @@ void
 GenericTableWrapper::onListDeleted() {
   beginResetModel();
   _list = nullptr;
+  _searchIndex.clear();
+  _rendered.clear();
   endResetModel();
 }
 
 void
 GenericTableWrapper::onItemAdded(int idx) {
   beginInsertRows(QModelIndex(), idx, idx);
+  _searchIndex.insertRow(idx);
+  if (idx <= _rendered.size())
+    _rendered.insert(idx, RenderedRow());
+  else
+    _rendered.clear();
   endInsertRows();
 }
 
 void
 GenericTableWrapper::onItemRemoved(int idx) {
   beginRemoveRows(QModelIndex(), idx, idx);
+  _searchIndex.removeRow(idx);
+  if (idx < _rendered.size())
+    _rendered.remove(idx);
+  else
+    _rendered.clear();
   //logDebug() << "Signal removal of item at idx=" << idx;
   endRemoveRows();
 }
 
 void
 GenericTableWrapper::onItemModified(int idx) {
-  emit dataChanged(index(idx,0),index(idx,columnCount()-1));
+  _searchIndex.invalidate(idx, idx);
+  invalidateRendered(idx, idx);
+  markChanged(idx, idx);
+}
+
+void
+GenericTableWrapper::onConfigModified() {
+  // Cells may show properties of other objects (e.g., names of referenced contacts)
+  _searchIndex.clear();
+  _rendered.clear();
+  markChanged(0, rowCount(QModelIndex())-1);
+}
+
+void
+GenericTableWrapper::invalidateRendered(int first, int last) {
+  for (int row=std::max(0, first); (row<=last) && (row<_rendered.size()); row++)
+    _rendered[row].roles = 0;
 }
 
 
@@ -223,6 +448,11 @@ inline QString formatFrequency(float f) {
 
 QVariant
 ChannelListWrapper::data(const QModelIndex &index, int role) const {
+  return cachedData(index, role);
+}
+
+QVariant
+ChannelListWrapper::renderData(const QModelIndex &index, int role) const {
   if (nullptr == _list)
     return QVariant();
 
@@ -608,6 +838,11 @@ ContactListWrapper::columnCount(const QModelIndex &index) const {
 
 QVariant
 ContactListWrapper::data(const QModelIndex &index, int role) const {
+  return cachedData(index, role);
+}
+
+QVariant
+ContactListWrapper::renderData(const QModelIndex &index, int role) const {
   if ((!index.isValid()) || (index.row()>=_list->count()))
     return QVariant();
 
@@ -4,6 +4,49 @@
 #include "config.hh"
 #include <QAbstractTableModel>
 
+
+/** Caches the case-folded display text of every cell of a model for searching.
+ *
+ * The rows are rendered lazily on the first search and kept until they get invalidated. The
+ * owning model must keep the index in sync by calling @c insertRow, @c removeRow, @c invalidate
+ * and @c clear. */
+class SearchIndex
+{
+public:
+  /** Constructs an empty index for the given model. */
+  explicit SearchIndex(const QAbstractItemModel *model);
+
+  /** Returns a counter that gets incremented with every change of the index. Matches are only
+   * comparable if the generation did not change. */
+  unsigned generation() const;
+  /** Returns all cells containing the given text (case-insensitive), ordered by row and column.
+   * If @c within is not @c nullptr, only these cells are considered. This allows to refine the
+   * matches of a previous search, if the search text was extended. */
+  QModelIndexList match(const QString &text, const QModelIndexList *within=nullptr) const;
+
+  /** Inserts an empty row. */
+  void insertRow(int row);
+  /** Removes a row. */
+  void removeRow(int row);
+  /** Invalidates the given range of rows. */
+  void invalidate(int first, int last);
+  /** Invalidates all rows. */
+  void clear();
+
+protected:
+  /** Returns the case-folded cells of the given row, renders them if needed. */
+  const QStringList &cells(int row) const;
+
+protected:
+  /** The indexed model. */
+  const QAbstractItemModel *_model;
+  /** The cells of each row, an empty list marks a row that is not rendered yet. */
+  mutable QVector<QStringList> _rows;
+  /** The generation counter. */
+  unsigned _generation;
+};
+
+
 class GenericListWrapper: public QAbstractListModel
 {
   Q_OBJECT
@@ -21,6 +64,9 @@ public:
   /** Moves the channels one step down. */
   virtual bool moveDown(int first, int last);
 
+  /** Returns the search index of this model. */
+  SearchIndex *searchIndex() const;
+
   // QAbstractListModel interface
   /** Implements QAbstractTableModel, returns number of rows. */
   int rowCount(const QModelIndex &index) const;
@@ -40,10 +86,15 @@ protected slots:
   void onItemRemoved(int idx);
   /** Internal callback on modified channels. */
   void onItemModified(int idx);
+  /** Internal callback on any modification of the config, invalidates the search index as cells
+   * may show properties of other objects. */
+  void onConfigModified();
 
 protected:
   /** Holds a weak reference to the list object. */
   AbstractConfigObjectList *_list;
+  /** The search index over the cells. */
+  mutable SearchIndex _searchIndex;
 };
 
 
@@ -64,6 +115,12 @@ public:
   /** Moves the channels one step down. */
   virtual bool moveDown(int first, int last);
 
+  /** Returns the search index of this model. */
+  SearchIndex *searchIndex() const;
+
+  /** Filters palette changes of the view, the cached colours get invalidated. */
+  bool eventFilter(QObject *obj, QEvent *event);
+
   // QAbstractTableModel interface
   /** Implements QAbstractTableModel, returns number of rows. */
   int rowCount(const QModelIndex &index) const;
@@ -81,10 +138,43 @@ protected slots:
   void onItemRemoved(int idx);
   /** Internal callback on modified channels. */
   void onItemModified(int idx);
+  /** Internal callback on any modification of the config, invalidates the search index as cells
+   * may show properties of other objects. */
+  void onConfigModified();
+  /** Emits a single @c dataChanged signal for all rows marked as changed. */
+  void emitPendingChanges();
+
+protected:
+  /** Returns the given cell from the render cache. If the row is not cached yet, all cells of
+   * the row get rendered using @c renderData. Only the display, edit and foreground roles are
+   * cached, all other roles are passed to @c renderData directly. */
+  QVariant cachedData(const QModelIndex &index, int role) const;
+  /** Renders the given cell. The default implementation returns an invalid QVariant. */
+  virtual QVariant renderData(const QModelIndex &index, int role) const;
+  /** Marks the given rows as changed. The @c dataChanged signal is emitted once control returns
+   * to the event loop. Hence, many changes at once (e.g., a bulk import) result in a single
+   * signal. */
+  void markChanged(int first, int last);
+  /** Drops the rendered cells of the given rows. */
+  void invalidateRendered(int first, int last);
 
 protected:
+  /** The cells of a single row, rendered for the cached roles. */
+  struct RenderedRow {
+    quint8 roles;                 ///< Bitmask of the rendered roles.
+    QVector<QVariant> cells;      ///< Cells ordered by role, then by column.
+  };
+
   /** Holds a weak reference to the list object. */
   AbstractConfigObjectList *_list;
+  /** The search index over the cells. */
+  mutable SearchIndex _searchIndex;
+  /** The render cache, indexed by row. */
+  mutable QVector<RenderedRow> _rendered;
+  /** First row marked as changed, -1 if none. */
+  int _changedFirst;
+  /** Last row marked as changed. */
+  int _changedLast;
 };
 
 
@@ -103,6 +193,9 @@ public:
   QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   /** Implements QAbstractTableModel, returns header at section. */
   QVariant headerData(int section, Qt::Orientation orientation, int role=Qt::DisplayRole) const;
+
+protected:
+  QVariant renderData(const QModelIndex &index, int role) const;
 };
 
 
@@ -171,6 +264,9 @@ public:
   QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   /** Returns the header at given section, implements the QAbstractTableModel. */
   QVariant headerData(int section, Qt::Orientation orientation, int role=Qt::DisplayRole) const;
+
+protected:
+  QVariant renderData(const QModelIndex &index, int role) const;
 };
 
 
@@ -7,12 +7,16 @@
 #include "settings.hh"
 #include <stdio.h>
 #include <QSplashScreen>
+#include <QElapsedTimer>
 
 int main(int argc, char *argv[])
 {
   QTextStream out(stderr);
   Logger::get().addHandler(new StreamLogHandler(out));
+  // Write debug and info messages in the background, until the stream goes out of scope
+  AsyncLogging asyncLogging;
 
+  QElapsedTimer startup; startup.start();
   Application app(argc, argv);
 
   //QPixmap pixmap(":/icons/splash.png");
@@ -22,6 +26,7 @@ int main(int argc, char *argv[])
 
   QMainWindow *mainWindow = app.mainWindow();
   mainWindow->show();
+  logInfo() << "Main window shown after " << startup.elapsed() << "ms.";
   //splash.finish(mainWindow);
 
   Settings settings;
@@ -8,6 +8,7 @@
 
 #include "logger.hh"
 #include "utils.hh"
+#include "backgroundtask.hh"
 
 
 /* ********************************************************************************************* *
@@ -236,13 +237,19 @@ RepeaterBookEntry::toCache() const {
 RepeaterBookList::RepeaterBookList(QObject *parent)
   : QAbstractListModel(parent), _network(), _currentReply(nullptr),
     _callsignPattern(R"re(([a-z]|[a-z0-9][a-z]|[a-z][a-z0-9])[0-9]+[a-z]*)re",
-                     QRegularExpression::CaseInsensitiveOption)
+                     QRegularExpression::CaseInsensitiveOption),
+    _loader(nullptr), _loadedItems(), _loadedQueries()
 {
-  load();
+  loadAsync();
   connect(&_network, SIGNAL(finished(QNetworkReply*)),
           this, SLOT(onRequestFinished(QNetworkReply*)));
 }
 
+RepeaterBookList::~RepeaterBookList() {
+  if (_loader)
+    _loader->wait();
+}
+
 int
 RepeaterBookList::rowCount(const QModelIndex &parent) const {
   Q_UNUSED(parent)
@@ -299,7 +306,42 @@ RepeaterBookList::queryPath() const {
 
 bool
 RepeaterBookList::load() {
-  QFile file(cachePath());
+  QList<QJsonObject> entries;
+  QHash<QString, QDateTime> queries;
+  bool ok = read(cachePath(), queryPath(), entries, queries);
+  install(entries, queries);
+  return ok;
+}
+
+void
+RepeaterBookList::loadAsync() {
+  if (_loader)
+    return;
+  QString cache = cachePath(), query = queryPath();
+  _loader = new BackgroundTask([this, cache, query]() {
+    read(cache, query, _loadedItems, _loadedQueries);
+  }, this);
+  connect(_loader, &QThread::finished, this, &RepeaterBookList::finishLoading);
+  _loader->start(QThread::LowPriority);
+}
+
+void
+RepeaterBookList::finishLoading() {
+  if (nullptr == _loader)
+    return;
+  _loader->wait();
+  _loader->deleteLater();
+  _loader = nullptr;
+  install(_loadedItems, _loadedQueries);
+  _loadedItems.clear();
+  _loadedQueries.clear();
+}
+
+bool
+RepeaterBookList::read(const QString &cacheFilename, const QString &queryFilename,
+                       QList<QJsonObject> &entries, QHash<QString, QDateTime> &queries)
+{
+  QFile file(cacheFilename);
   if (! file.open(QIODevice::ReadOnly)) {
     logInfo() << "Cannot open repeater cache '" << file.fileName() << "'.";
     return false;
@@ -313,21 +355,12 @@ RepeaterBookList::load() {
   }
   file.close();
 
-  beginResetModel();
-  _items.clear();
   foreach (const QJsonValue &rep, doc.array()) {
-    RepeaterBookEntry entry;
-    if (! entry.fromCache(rep.toObject()))
-      continue;
-    if (5 < entry.age())
-      continue;
-    _items.append(entry);
+    if (rep.isObject())
+      entries.append(rep.toObject());
   }
-  endResetModel();
 
-  logDebug() << "Loaded repeater cache of " << _items.count() << " entries.";
-
-  file.setFileName(queryPath());
+  file.setFileName(queryFilename);
   if (!file.open(QIODevice::ReadOnly)) {
     logError() << "Cannot open query cache '" << file.fileName()
                << "': " << file.errorString() << ".";
@@ -352,13 +385,36 @@ RepeaterBookList::load() {
     QJsonObject obj = entry.toObject();
     if ((! obj.contains("query")) || (! obj.contains("timestamp")))
       continue;
-    _queries[obj["query"].toString()] = QDateTime::fromString(
+    queries[obj["query"].toString()] = QDateTime::fromString(
           obj["timestamp"].toString(), Qt::ISODate);
   }
 
   return true;
 }
 
+void
+RepeaterBookList::install(QList<QJsonObject> &entries, QHash<QString, QDateTime> &queries) {
+  // The entries are QObjects, hence they are created here, within the thread of the list
+  QList<RepeaterBookEntry> items;
+  foreach (const QJsonObject &obj, entries) {
+    RepeaterBookEntry entry;
+    if (! entry.fromCache(obj))
+      continue;
+    if (5 < entry.age())
+      continue;
+    items.append(entry);
+  }
+  entries.clear();
+
+  logDebug() << "Loaded repeater cache of " << items.count() << " entries.";
+
+  beginResetModel();
+  _items.swap(items);
+  endResetModel();
+  _queries.swap(queries);
+  emit loaded();
+}
+
 bool
 RepeaterBookList::store() const {
   QFile file(cachePath());
@@ -405,6 +461,8 @@ RepeaterBookList::store() const {
 
 void
 RepeaterBookList::search(const QString &text) {
+  // The cache must be complete before it gets updated
+  finishLoading();
   // Cancel running requests
   if (_currentReply)
     _currentReply->abort();
@@ -11,6 +11,8 @@
 #include "signaling.hh"
 #include "channel.hh"
 
+class BackgroundTask;
+
 
 class RepeaterBookEntry: public QObject
 {
@@ -62,6 +64,8 @@ class RepeaterBookList: public QAbstractListModel
 
 public:
   explicit RepeaterBookList(QObject *parent=nullptr);
+  /** Destructor, waits for a running background load. */
+  virtual ~RepeaterBookList();
 
   int rowCount(const QModelIndex &parent) const;
   QVariant data(const QModelIndex &index, int role) const;
@@ -72,8 +76,16 @@ public slots:
   /** Searches the repeater book for the given call (or part of it). */
   void search(const QString &call);
   bool load();
+  /** Loads the repeater cache on a separate thread, emits @c loaded once done. */
+  void loadAsync();
+  /** Blocks until a background load is complete and applies its result. */
+  void finishLoading();
   bool store() const;
 
+signals:
+  /** Gets emitted once the repeater cache has been loaded. */
+  void loaded();
+
 protected slots:
   void onRequestFinished(QNetworkReply *reply);
 
@@ -81,6 +93,13 @@ protected:
   QString cachePath() const;
   QString queryPath() const;
   bool updateEntry(const RepeaterBookEntry &entry);
+  /** Reads the repeater and query caches. The repeaters are returned as plain JSON objects, as
+   * the caches may be read on a separate thread. */
+  static bool read(const QString &cacheFilename, const QString &queryFilename,
+                   QList<QJsonObject> &entries, QHash<QString, QDateTime> &queries);
+  /** Replaces the repeaters and queries. The repeater entries get created from the given JSON
+   * objects within the thread of the list. */
+  void install(QList<QJsonObject> &entries, QHash<QString, QDateTime> &queries);
 
 protected:
   QNetworkAccessManager _network;
@@ -88,6 +107,9 @@ protected:
   QList<RepeaterBookEntry> _items;
   QHash<QString, QDateTime> _queries;
   QRegularExpression _callsignPattern;
+  BackgroundTask *_loader;
+  QList<QJsonObject> _loadedItems;
+  QHash<QString, QDateTime> _loadedQueries;
 };
 
 
@@ -5,10 +5,11 @@
 #include <QToolButton>
 #include <QLabel>
 #include "logger.hh"
+#include "configitemwrapper.hh"
 
 
 SearchPopup::SearchPopup(QAbstractItemView *parent)
-  : QFrame(parent)
+  : QFrame(parent), _currentMatch(0), _matches(), _matchText(), _matchGeneration(0)
 {
   setWindowFlags(Qt::Popup | Qt::FramelessWindowHint | Qt::NoDropShadowWindowHint);
   setFrameStyle(QFrame::Panel);
@@ -69,6 +70,7 @@ SearchPopup::onSearchChanged(const QString &text) {
   if (text.isEmpty()) {
     _currentMatch = 0;
     _matches.clear();
+    _matchText.clear();
     itemView->selectionModel()->clear();
     _label->setText("");
     return;
@@ -76,19 +78,28 @@ SearchPopup::onSearchChanged(const QString &text) {
 
   _currentMatch = 0;
   itemView->selectionModel()->clear();
-  _matches.clear();
-  for (int i=0; i<model->columnCount(); i++)
-    _matches.append(model->match(model->index(0,i), Qt::DisplayRole, text, -1,
-                                 Qt::MatchContains|Qt::MatchWrap));
-  std::sort(
-        _matches.begin(), _matches.end(),
-        [](const QModelIndex &a, const QModelIndex &b) {
-    if (a.row() < b.row())
-      return true;
-    if (a.row() > b.row())
-      return false;
-    return a.column() < b.column();
-  });
+  if (SearchIndex *index = searchIndex()) {
+    // If the text was only extended, the new matches are a subset of the previous ones
+    bool refine = (! _matchText.isEmpty()) && (_matchGeneration == index->generation())
+        && text.startsWith(_matchText, Qt::CaseInsensitive);
+    _matches = index->match(text, refine ? &_matches : nullptr);
+    _matchText = text;
+    _matchGeneration = index->generation();
+  } else {
+    _matches.clear();
+    for (int i=0; i<model->columnCount(); i++)
+      _matches.append(model->match(model->index(0,i), Qt::DisplayRole, text, -1,
+                                   Qt::MatchContains|Qt::MatchWrap));
+    std::sort(
+          _matches.begin(), _matches.end(),
+          [](const QModelIndex &a, const QModelIndex &b) {
+      if (a.row() < b.row())
+        return true;
+      if (a.row() > b.row())
+        return false;
+      return a.column() < b.column();
+    });
+  }
 
   if (_matches.count()) {
     _label->setText(tr("%1/%2").arg(_currentMatch+1).arg(_matches.count()));
@@ -123,6 +134,16 @@ SearchPopup::onPrevious() {
 }
 
 
+SearchIndex *
+SearchPopup::searchIndex() const {
+  QAbstractItemView *itemView = qobject_cast<QAbstractItemView *>(parent());
+  if (GenericTableWrapper *table = qobject_cast<GenericTableWrapper *>(itemView->model()))
+    return table->searchIndex();
+  if (GenericListWrapper *list = qobject_cast<GenericListWrapper *>(itemView->model()))
+    return list->searchIndex();
+  return nullptr;
+}
+
 void
 SearchPopup::attach(QAbstractItemView *itemview) {
   if (nullptr == itemview)
@@ -5,6 +5,7 @@
 #include <QAbstractItemView>
 
 class QLabel;
+class SearchIndex;
 
 
 class SearchPopup : public QFrame
@@ -25,11 +26,19 @@ protected slots:
   void onNext();
   void onPrevious();
 
+protected:
+  /** Returns the search index of the model, if the model provides one. */
+  SearchIndex *searchIndex() const;
+
 protected:
   QLineEdit *_search;
   QLabel *_label;
   int _currentMatch;
   QModelIndexList _matches;
+  /** The search text of the current matches. */
+  QString _matchText;
+  /** The generation of the search index, the current matches were obtained from. */
+  unsigned _matchGeneration;
 };
 
 #endif // SEARCHPOPUP_HH
@@ -0,0 +1,152 @@
+#include "anytoneinterfacetest.hh"
+#include "anytone_interface.hh"
+#include <QtEndian>
+#include <QTest>
+#include <QSet>
+#include <algorithm>
+
+/** Fake AnyTone device, answering read and write requests from memory. Responses to selected
+ * requests get dropped, to simulate a device not responding in time. */
+class FakeAnytoneInterface: public AnytoneInterface
+{
+public:
+  explicit FakeAnytoneInterface(unsigned window)
+    : AnytoneInterface(USBDeviceDescriptor()), memory(0x1000, 0), requests(0), silent(false)
+  {
+    for (int i=0; i<memory.size(); i++)
+      memory[i] = char(i*7+i/16);
+    _state = STATE_PROGRAM;
+    setWindowSize(window);
+  }
+
+  virtual ~FakeAnytoneInterface() {
+    _state = STATE_CLOSED;
+  }
+
+  /** The memory of the device. */
+  QByteArray memory;
+  /** Indices of the requests, that are not answered. */
+  QSet<unsigned> drop;
+  /** Number of requests received. */
+  unsigned requests;
+  /** If @c true, the device does not respond at all. */
+  bool silent;
+
+protected:
+  virtual bool transmit(const char *data, int len) {
+    _input.append(data, len);
+    while (! _input.isEmpty()) {
+      if (('R' == _input.at(0)) && (int(sizeof(ReadRequest)) <= _input.size())) {
+        const ReadRequest *req = (const ReadRequest *)_input.constData();
+        uint32_t addr = qFromBigEndian(req->addr);
+        ReadResponse resp;
+        resp.cmd = 'W'; resp.addr = qToBigEndian(addr); resp.size = 16;
+        memcpy(resp.data, memory.constData()+addr, 16);
+        resp.sum = 0;
+        for (unsigned i=1; i<22; i++)
+          resp.sum += ((const uint8_t *)&resp)[i];
+        resp.ack = 0x06;
+        respond((const char *)&resp, sizeof(ReadResponse));
+        _input.remove(0, sizeof(ReadRequest));
+      } else if (('W' == _input.at(0)) && (int(sizeof(WriteRequest)) <= _input.size())) {
+        const WriteRequest *req = (const WriteRequest *)_input.constData();
+        if (! drop.contains(requests))
+          memcpy(memory.data()+qFromBigEndian(req->addr), req->data, 16);
+        respond("\x06", 1);
+        _input.remove(0, sizeof(WriteRequest));
+      } else {
+        break;
+      }
+    }
+    return true;
+  }
+
+  virtual int receive(char *data, int len, int timeout) {
+    Q_UNUSED(timeout);
+    int n = std::min(len, _output.size());
+    memcpy(data, _output.constData(), n);
+    _output.remove(0, n);
+    return n;
+  }
+
+  virtual void drain() {
+    _output.clear();
+  }
+
+  void respond(const char *data, int len) {
+    if ((! silent) && (! drop.contains(requests)))
+      _output.append(data, len);
+    requests++;
+  }
+
+protected:
+  QByteArray _input;
+  QByteArray _output;
+};
+
+
+AnytoneInterfaceTest::AnytoneInterfaceTest(QObject *parent)
+  : QObject(parent)
+{
+  // pass...
+}
+
+void
+AnytoneInterfaceTest::testRead() {
+  FakeAnytoneInterface dev(8);
+  QByteArray data(0x100, 0);
+  QVERIFY(dev.read(0, 0x100, (uint8_t *)data.data(), data.size()));
+  QCOMPARE(data, dev.memory.mid(0x100, 0x100));
+  QCOMPARE(dev.statistics().retries, 0U);
+  QCOMPARE(dev.statistics().roundTrips, 2U);
+}
+
+void
+AnytoneInterfaceTest::testReadTimeout() {
+  FakeAnytoneInterface dev(8);
+  // Last response of the first batch is missing
+  dev.drop.insert(7);
+  QByteArray data(0x100, 0);
+  QVERIFY(dev.read(0, 0x100, (uint8_t *)data.data(), data.size()));
+  QCOMPARE(data, dev.memory.mid(0x100, 0x100));
+  QCOMPARE(dev.statistics().timeouts, 1U);
+  QCOMPARE(dev.statistics().retries, 1U);
+}
+
+void
+AnytoneInterfaceTest::testReadMissingResponse() {
+  FakeAnytoneInterface dev(8);
+  // A response in between is missing, the following ones are received
+  dev.drop.insert(2);
+  QByteArray data(0x80, 0);
+  QVERIFY(dev.read(0, 0x200, (uint8_t *)data.data(), data.size()));
+  QCOMPARE(data, dev.memory.mid(0x200, 0x80));
+  QCOMPARE(dev.statistics().timeouts, 1U);
+  QCOMPARE(dev.statistics().retries, 1U);
+  QCOMPARE(dev.statistics().blocks, 8U);
+}
+
+void
+AnytoneInterfaceTest::testWriteTimeout() {
+  FakeAnytoneInterface dev(8);
+  // A write request of the first batch gets lost
+  dev.drop.insert(3);
+  QByteArray data(0x100, 0);
+  for (int i=0; i<data.size(); i++)
+    data[i] = char(0xff-i);
+  QVERIFY(dev.write(0, 0x300, (uint8_t *)data.data(), data.size()));
+  QCOMPARE(dev.memory.mid(0x300, 0x100), data);
+  QCOMPARE(dev.statistics().timeouts, 1U);
+  // ACKs carry no address, hence the entire first batch is written again
+  QCOMPARE(dev.statistics().retries, 8U);
+}
+
+void
+AnytoneInterfaceTest::testNoResponse() {
+  FakeAnytoneInterface dev(8);
+  dev.silent = true;
+  QByteArray data(0x80, 0);
+  QVERIFY(! dev.read(0, 0x000, (uint8_t *)data.data(), data.size()));
+}
+
+QTEST_GUILESS_MAIN(AnytoneInterfaceTest)
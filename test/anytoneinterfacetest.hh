@@ -0,0 +1,21 @@
+#ifndef ANYTONEINTERFACETEST_HH
+#define ANYTONEINTERFACETEST_HH
+
+#include <QObject>
+
+class AnytoneInterfaceTest : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit AnytoneInterfaceTest(QObject *parent = nullptr);
+
+private slots:
+  void testRead();
+  void testReadTimeout();
+  void testReadMissingResponse();
+  void testWriteTimeout();
+  void testNoResponse();
+};
+
+#endif // ANYTONEINTERFACETEST_HH
@@ -0,0 +1,773 @@
+/** @file benchmark.cc
+ * Implements the @c dmrconf-bench tool. It generates synthetic configurations sized to the limits
+ * of every supported radio and measures the time needed to encode and decode the binary codeplugs,
+ * to index and resolve the config elements within the codeplug context, to build and clone a large
+ * config, to write and read the YAML representation, to serialize a large contact list to YAML, to
+ * parse a legacy .conf codeplug, to ingest the user database, to encode the call-sign DBs, to build
+ * a codeplug image out of order, to write and read large DFU files, the CRC32 throughput and how
+ * the config object lists scale with their size.
+ * The results are written as JSON, such that they can be compared across releases.
+ */
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QTextStream>
+#include <QFile>
+#include <QProcess>
+#include <QStandardPaths>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+
+#include "config.h"
+#include "config.hh"
+#include "logger.hh"
+#include "radioinfo.hh"
+#include "radiolimits.hh"
+#include "userdatabase.hh"
+#include "callsigndb.hh"
+#include "dfufile.hh"
+#include "crc32.hh"
+#include "openrtx_codeplug.hh"
+#include "md390.hh"
+#include "uv390.hh"
+#include "md2017.hh"
+#include "dm1701.hh"
+#include "rd5r.hh"
+#include "gd77.hh"
+#include "opengd77.hh"
+#include "d868uv.hh"
+#include "d878uv.hh"
+#include "d878uv2.hh"
+#include "d578uv.hh"
+#include "dmr6x2uv.hh"
+
+/** The DMR ID of the synthetic configuration, also used to select the call-signs. */
+#define BENCH_DMR_ID     2621370
+/** Maximum number of members of a group list, zone or scan list. */
+#define MAX_MEMBERS      16
+
+
+/** Describes a single benchmark target, that is a codeplug and optionally the limits and the
+ * call-sign DB of the corresponding radio. */
+struct Target {
+  QString key;                    ///< The radio key.
+  QString family;                 ///< The codeplug family.
+  Radio *radio;                   ///< The radio instance, owns codeplug, limits and call-sign DB.
+  Codeplug *codeplug;             ///< The codeplug to benchmark.
+};
+
+/** Table sizes of a synthetic configuration. */
+struct Sizes {
+  unsigned contacts;              ///< Number of digital contacts.
+  unsigned groupLists;            ///< Number of group lists.
+  unsigned channels;              ///< Number of channels.
+  unsigned zones;                 ///< Number of zones.
+  unsigned scanLists;             ///< Number of scan lists.
+};
+
+
+/** Returns the maximum number of elements of the given type in the specified list property. */
+static unsigned
+listLimit(const RadioLimits *limits, const QString &prop, const QMetaObject &type, unsigned fallback) {
+  if (nullptr == limits)
+    return fallback;
+  const RadioLimitList *list = qobject_cast<const RadioLimitList *>(limits->element(prop));
+  if ((nullptr == list) || (0 > list->maxCount(type)))
+    return fallback;
+  return list->maxCount(type);
+}
+
+/** Derives the table sizes from the given radio limits. If no limits are given (e.g., OpenRTX),
+ * some sizes typical for the OpenGD77 firmware are used. */
+static Sizes
+sizesFromLimits(const RadioLimits *limits) {
+  Sizes sizes;
+  sizes.contacts   = listLimit(limits, "contacts", DMRContact::staticMetaObject, 1024);
+  sizes.groupLists = listLimit(limits, "groupLists", RXGroupList::staticMetaObject, 76);
+  sizes.channels   = listLimit(limits, "channels", Channel::staticMetaObject, 1024);
+  sizes.zones      = listLimit(limits, "zones", Zone::staticMetaObject, 68);
+  sizes.scanLists  = listLimit(limits, "scanlists", ScanList::staticMetaObject, 0);
+  return sizes;
+}
+
+/** Fills the given config with synthetic elements. */
+static void
+generateConfig(Config *config, const Sizes &sizes) {
+  config->radioIDs()->addId("BENCH", BENCH_DMR_ID);
+  config->radioIDs()->setDefaultId(0);
+
+  // Every 10th contact is a talk group
+  QVector<DMRContact *> groups;
+  for (unsigned i=0; i<sizes.contacts; i++) {
+    DMRContact *contact;
+    if (0 == (i % 10)) {
+      contact = new DMRContact(DMRContact::GroupCall, QString("TG %1").arg(i/10+1), 91+i/10);
+      groups.append(contact);
+    } else {
+      contact = new DMRContact(DMRContact::PrivateCall, QString("DM%1").arg(i, 5, 10, QChar('0')),
+                               BENCH_DMR_ID+i);
+    }
+    config->contacts()->add(contact);
+  }
+
+  for (unsigned i=0; i<sizes.groupLists; i++) {
+    RXGroupList *list = new RXGroupList(QString("GL %1").arg(i+1));
+    for (int j=0; (j<MAX_MEMBERS) && (j<groups.size()); j++)
+      list->addContact(groups[(i*MAX_MEMBERS+j) % groups.size()]);
+    config->rxGroupLists()->add(list);
+  }
+
+  // Alternate between DMR and FM channels
+  for (unsigned i=0; i<sizes.channels; i++) {
+    Channel *channel;
+    if ((0 == (i % 2)) && sizes.groupLists && groups.size()) {
+      DMRChannel *dmr = new DMRChannel();
+      dmr->setColorCode(1 + i%15);
+      dmr->setTimeSlot((i/2) % 2 ? DMRChannel::TimeSlot::TS2 : DMRChannel::TimeSlot::TS1);
+      dmr->setGroupListObj(config->rxGroupLists()->list(i % sizes.groupLists));
+      dmr->setTXContactObj(groups[i % groups.size()]);
+      channel = dmr;
+    } else {
+      channel = new FMChannel();
+    }
+    channel->setName(QString("CH %1").arg(i+1));
+    channel->setRXFrequency(430.0125 + (i % 800)*0.0125);
+    channel->setTXFrequency(channel->rxFrequency());
+    config->channelList()->add(channel);
+  }
+
+  for (unsigned i=0; (i<sizes.zones) && sizes.channels; i++) {
+    Zone *zone = new Zone(QString("Zone %1").arg(i+1));
+    for (unsigned j=0; (j<MAX_MEMBERS) && (j<sizes.channels); j++)
+      zone->A()->add(config->channelList()->channel((i*MAX_MEMBERS+j) % sizes.channels));
+    config->zones()->add(zone);
+  }
+
+  for (unsigned i=0; (i<sizes.scanLists) && sizes.channels; i++) {
+    ScanList *list = new ScanList();
+    list->setName(QString("Scan %1").arg(i+1));
+    for (unsigned j=0; (j<MAX_MEMBERS) && (j<sizes.channels); j++)
+      list->addChannel(config->channelList()->channel((i*MAX_MEMBERS+j) % sizes.channels));
+    config->scanlists()->add(list);
+  }
+}
+
+/** Writes a synthetic user database with the given number of entries in the JSON format
+ * provided by radioid.net. */
+static bool
+generateUserDB(const QString &filename, unsigned count) {
+  static const char *countries[] = {"Germany", "United States", "Italy", "Spain", "Japan",
+                                    "Brazil", "Canada", "Australia"};
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly))
+    return false;
+  QTextStream stream(&file);
+  stream << "{\"users\":[";
+  // Simple LCG to spread the IDs over all prefixes reproducibly
+  quint32 state = 1;
+  for (unsigned i=0; i<count; i++) {
+    state = state*1664525u + 1013904223u;
+    unsigned id = 1000000 + (state % 8000000);
+    stream << (i ? "," : "") << "{\"id\":" << id
+           << ",\"callsign\":\"BN" << i << "\",\"fname\":\"Name" << (i % 997)
+           << "\",\"surname\":\"Surname" << (i % 4999) << "\",\"city\":\"City" << (i % 331)
+           << "\",\"state\":\"State" << (i % 53) << "\",\"country\":\"" << countries[i % 8]
+           << "\",\"remarks\":\"\"}";
+  }
+  stream << "]}";
+  stream.flush();
+  return QFile::NoError == file.error();
+}
+
+/** Assembles a legacy .conf codeplug with the given number of channels. Half of the channels are
+ * digital, the other half analog. */
+static QString
+generateConf(unsigned channels) {
+  unsigned contacts = std::max(1u, channels/4), groupLists = std::max(1u, channels/16);
+  QString text;
+  QTextStream stream(&text);
+  stream << "ID: " << BENCH_DMR_ID << "\n"
+         << "Name: \"BENCH\"\n"
+         << "IntroLine1: \"\"\n"
+         << "IntroLine2: \"\"\n"
+         << "MICLevel: 2\n"
+         << "Speech: Off\n\n";
+
+  stream << "Digital Name                Receive    Transmit   Power Scan TOT RO Admit  CC TS RxGL TxC GPS Roam\n";
+  for (unsigned i=1; i<=channels; i+=2)
+    stream << i << " \"CH " << i << "\" " << QString::number(430.0125 + (i % 800)*0.0125, 'f', 5)
+           << " -7.60000 High - - - - 1 " << (1 + (i/2) % 2) << " " << (1 + i % groupLists) << " "
+           << (1 + i % contacts) << " - - # digital\n";
+  stream << "\nAnalog  Name                Receive   Transmit   Power Scan TOT RO Admit  Squelch RxTone TxTone Width APRS\n";
+  for (unsigned i=2; i<=channels; i+=2)
+    stream << i << " \"CH " << i << "\" " << QString::number(430.0125 + (i % 800)*0.0125, 'f', 5)
+           << " +0 High - - - - 1 67.0 67.0 12.5 -\n";
+
+  stream << "\nZone    Name                VFO Channels\n";
+  for (unsigned i=1; i<=channels/MAX_MEMBERS; i++) {
+    stream << i << " \"Zone " << i << "\" A ";
+    for (unsigned j=0; j<MAX_MEMBERS; j++)
+      stream << (j ? "," : "") << ((i-1)*MAX_MEMBERS + j + 1);
+    stream << "\n";
+  }
+
+  stream << "\nContact Name                Type    ID          RxTone\n";
+  for (unsigned i=1; i<=contacts; i++)
+    stream << i << " \"TG " << i << "\" Group " << (90+i) << " -\n";
+
+  stream << "\nGrouplist Name                Contacts\n";
+  for (unsigned i=1; i<=groupLists; i++) {
+    stream << i << " \"GL " << i << "\" ";
+    for (unsigned j=0; (j<MAX_MEMBERS) && (j<contacts); j++)
+      stream << (j ? "," : "") << (((i-1)*MAX_MEMBERS + j) % contacts + 1);
+    stream << "\n";
+  }
+  stream.flush();
+  return text;
+}
+
+/** Returns the given memory entry (e.g., "VmHWM") of the process status in kB or -1 if unknown. */
+static qint64
+memoryStatus(const QByteArray &key) {
+  QFile status("/proc/self/status");
+  if (! status.open(QIODevice::ReadOnly))
+    return -1;
+  foreach (QByteArray line, status.readAll().split('\n')) {
+    if (line.startsWith(key + ":"))
+      return line.mid(key.size()+1).trimmed().split(' ').first().toLongLong();
+  }
+  return -1;
+}
+
+/** Returns the peak resident set size of the process in kB or -1 if unknown. */
+static qint64
+peakRSS() {
+  return memoryStatus("VmHWM");
+}
+
+/** Returns the current resident set size of the process in kB or -1 if unknown. */
+static qint64
+currentRSS() {
+  return memoryStatus("VmRSS");
+}
+
+/** Ingests the given user database @c n times within a child process and returns the timing
+ * together with the peak resident set size of the child. Hence, the memory footprint of loading
+ * the JSON and the binary user database can be told apart. */
+static QJsonObject
+ingestUserDB(const QString &filename, unsigned n) {
+  QProcess child;
+  child.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+  child.start(QCoreApplication::applicationFilePath(),
+              {"--ingest-user-db", filename, "--iterations", QString::number(n)});
+  if ((! child.waitForFinished(-1)) || (QProcess::NormalExit != child.exitStatus()) ||
+      (0 != child.exitCode()))
+    return QJsonObject{{"error", QString("Ingest failed: %1").arg(child.errorString())}};
+  return QJsonDocument::fromJson(child.readAllStandardOutput()).object();
+}
+
+/** Runs the given operation @c n times and stores the minimum and mean time in ms into a JSON
+ * object. Returns an object with an "error" entry, if the operation fails. */
+static QJsonObject
+measure(unsigned n, const std::function<bool(const ErrorStack &err)> &op) {
+  QJsonObject res;
+  double min = -1, sum = 0;
+  for (unsigned i=0; i<n; i++) {
+    ErrorStack err;
+    QElapsedTimer timer; timer.start();
+    if (! op(err)) {
+      res.insert("error", err.format(""));
+      return res;
+    }
+    double dt = timer.nsecsElapsed()/1e6;
+    min = ((0 > min) || (dt < min)) ? dt : min;
+    sum += dt;
+  }
+  res.insert("min_ms", min);
+  res.insert("mean_ms", sum/n);
+  return res;
+}
+
+/** Measures adding, looking up and removing @c count contacts to the owning contact list and to
+ * the reference list of a single group list. The times are reported in ns per object, such that
+ * linear scaling results in constant numbers across list sizes. */
+static QJsonObject
+listScaling(unsigned count, unsigned n) {
+  QJsonObject res;
+  res.insert("objects", int(count));
+  double add = -1, lookup = -1, take = -1;
+  for (unsigned i=0; i<n; i++) {
+    Config config;
+    RXGroupList *list = new RXGroupList("GL");
+    config.rxGroupLists()->add(list);
+    QVector<DMRContact *> contacts; contacts.reserve(count);
+    for (unsigned j=0; j<count; j++)
+      contacts.append(new DMRContact(DMRContact::PrivateCall, QString("DM%1").arg(j), BENCH_DMR_ID+j));
+
+    QElapsedTimer timer; timer.start();
+    foreach (DMRContact *contact, contacts) {
+      config.contacts()->add(contact);
+      list->addContact(contact);
+    }
+    double dt = timer.nsecsElapsed();
+    add = ((0 > add) || (dt < add)) ? dt : add;
+
+    qint64 sum = 0;
+    timer.restart();
+    foreach (DMRContact *contact, contacts)
+      sum += config.contacts()->indexOf(contact) + list->contacts()->indexOf(contact);
+    dt = timer.nsecsElapsed();
+    lookup = ((0 > lookup) || (dt < lookup)) ? dt : lookup;
+    if (sum != qint64(count)*(count-1))
+      logWarn() << "List index mismatch.";
+
+    timer.restart();
+    for (int j=contacts.size()-1; j>=0; j--)
+      list->contacts()->take(contacts[j]);
+    dt = timer.nsecsElapsed();
+    take = ((0 > take) || (dt < take)) ? dt : take;
+  }
+  res.insert("add_ns", add/count);
+  res.insert("indexOf_ns", lookup/count);
+  res.insert("take_ns", take/count);
+  return res;
+}
+
+/** Creates the radio instance for the given key or @c nullptr if there is none. */
+static Radio *
+createRadio(RadioInfo::Radio radio) {
+  switch (radio) {
+  case RadioInfo::MD390: return new MD390();
+  case RadioInfo::UV390: return new UV390();
+  case RadioInfo::MD2017: return new MD2017();
+  case RadioInfo::DM1701: return new DM1701();
+  case RadioInfo::RD5R: return new RD5R();
+  case RadioInfo::GD77: return new GD77();
+  case RadioInfo::OpenGD77: return new OpenGD77();
+  case RadioInfo::D868UVE: return new D868UV();
+  case RadioInfo::D878UV: return new D878UV();
+  case RadioInfo::D878UVII: return new D878UV2();
+  case RadioInfo::D578UV: return new D578UV();
+  case RadioInfo::DMR6X2UV: return new DMR6X2UV();
+  default: break;
+  }
+  return nullptr;
+}
+
+/** Assembles the list of all benchmark targets. */
+static QList<Target>
+targets(const QStringList &filter) {
+  static const QList<QPair<RadioInfo::Radio, QString>> radios = {
+    {RadioInfo::D868UVE, "AnyTone"}, {RadioInfo::D878UV, "AnyTone"},
+    {RadioInfo::D878UVII, "AnyTone"}, {RadioInfo::D578UV, "AnyTone"},
+    {RadioInfo::DMR6X2UV, "AnyTone"},
+    {RadioInfo::MD390, "TyT"}, {RadioInfo::UV390, "TyT"}, {RadioInfo::MD2017, "TyT"},
+    {RadioInfo::DM1701, "TyT"},
+    {RadioInfo::RD5R, "Radioddity"}, {RadioInfo::GD77, "Radioddity"},
+    {RadioInfo::OpenGD77, "OpenGD77"}, {RadioInfo::OpenRTX, "OpenRTX"}
+  };
+
+  QList<Target> list;
+  for (auto radio: radios) {
+    QString key = RadioInfo::byID(radio.first).key();
+    if ((! filter.isEmpty()) && (! filter.contains(key)))
+      continue;
+    Target target = {key, radio.second, createRadio(radio.first), nullptr};
+    if (target.radio)
+      target.codeplug = &target.radio->codeplug();
+    else if (RadioInfo::OpenRTX == radio.first)
+      target.codeplug = new OpenRTXCodeplug();
+    if (target.codeplug)
+      list.append(target);
+  }
+  return list;
+}
+
+/** Benchmarks a single target. */
+static QJsonObject
+benchmark(const Target &target, unsigned n, UserDatabase *userdb) {
+  const RadioLimits *limits = target.radio ? &target.radio->limits() : nullptr;
+  Sizes sizes = sizesFromLimits(limits);
+  Config config;
+  generateConfig(&config, sizes);
+
+  QJsonObject res;
+  res.insert("radio", target.key);
+  res.insert("family", target.family);
+  res.insert("sizes", QJsonObject{
+               {"contacts", int(sizes.contacts)}, {"groupLists", int(sizes.groupLists)},
+               {"channels", int(sizes.channels)}, {"zones", int(sizes.zones)},
+               {"scanLists", int(sizes.scanLists)} });
+
+  Codeplug::Flags flags; flags.updateCodePlug = false;
+  res.insert("encode", measure(n, [&](const ErrorStack &err) {
+    return target.codeplug->encode(&config, flags, err);
+  }));
+  res.insert("context", measure(n, [&](const ErrorStack &err) {
+    Q_UNUSED(err);
+    // Index all elements and resolve them the way the encoders do
+    Codeplug::Context ctx(&config);
+    for (int i=0; i<config.contacts()->count(); i++)
+      ctx.add(config.contacts()->contact(i), i+1);
+    for (int i=0; i<config.channelList()->count(); i++)
+      ctx.add(config.channelList()->channel(i), i+1);
+    for (int i=0; i<config.zones()->count(); i++)
+      ctx.add(config.zones()->zone(i), i+1);
+    unsigned found = 0;
+    for (int i=0; i<config.zones()->count(); i++) {
+      Zone *zone = config.zones()->zone(i);
+      for (int j=0; j<zone->A()->count(); j++)
+        found += (0 <= ctx.index(zone->A()->get(j)->as<Channel>()));
+    }
+    for (int i=0; i<config.channelList()->count(); i++) {
+      Channel *channel = ctx.get<Channel>(i+1);
+      if (DigitalChannel *digi = channel->as<DigitalChannel>())
+        found += (0 <= ctx.index(digi->txContactObj()));
+    }
+    return 0 < found;
+  }));
+  res.insert("decode", measure(n, [&](const ErrorStack &err) {
+    Config decoded;
+    return target.codeplug->decode(&decoded, err);
+  }));
+
+  QString yaml;
+  res.insert("yamlWrite", measure(n, [&](const ErrorStack &err) {
+    yaml.clear();
+    QTextStream stream(&yaml);
+    return config.toYAML(stream, err);
+  }));
+  QTemporaryDir dir;
+  QFile file(dir.filePath("config.yaml"));
+  if (file.open(QIODevice::WriteOnly)) {
+    file.write(yaml.toUtf8()); file.close();
+    res.insert("yamlRead", measure(n, [&](const ErrorStack &err) {
+      Config parsed;
+      return parsed.readYAML(file.fileName(), err);
+    }));
+  }
+
+  CallsignDB *callsigns = target.radio ? target.radio->callsignDB() : nullptr;
+  if (userdb && callsigns && limits->callSignDBImplemented()) {
+    CallsignDB::Selection selection(limits->numCallSignDBEntries());
+    selection.setPrefixes({BENCH_DMR_ID});
+    res.insert("callsignDB", measure(n, [&](const ErrorStack &err) {
+      return callsigns->encode(userdb, selection, err);
+    }));
+  }
+
+  return res;
+}
+
+
+int
+main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  app.setApplicationName("dmrconf-bench");
+  app.setOrganizationName("DM3MAT");
+  app.setOrganizationDomain("dm3mat.darc.de");
+  app.setApplicationVersion(VERSION_STRING);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+        QCoreApplication::translate("main", "Benchmarks codeplug encoding and decoding using "
+                                            "synthetic configurations at the limits of every "
+                                            "radio."));
+  parser.addHelpOption();
+  parser.addVersionOption();
+  parser.addOption({{"o", "output"},
+                    QCoreApplication::translate("main", "Writes the JSON results to the given "
+                                                        "file instead of stdout."),
+                    QCoreApplication::translate("main", "FILENAME")});
+  parser.addOption({{"n", "iterations"},
+                    QCoreApplication::translate("main", "Number of repetitions of every "
+                                                        "measurement. Default 3."),
+                    QCoreApplication::translate("main", "N"), "3"});
+  parser.addOption({{"R", "radio"},
+                    QCoreApplication::translate("main", "Only benchmarks the specified radio, "
+                                                        "may be given several times."),
+                    QCoreApplication::translate("main", "RADIO")});
+  parser.addOption({{"u", "users"},
+                    QCoreApplication::translate("main", "Size of the synthetic user database. "
+                                                        "0 disables the user database benchmark. "
+                                                        "Default 250000."),
+                    QCoreApplication::translate("main", "N"), "250000"});
+  parser.addOption({{"c", "conf-channels"},
+                    QCoreApplication::translate("main", "Number of channels of the synthetic legacy "
+                                                        ".conf codeplug. 0 disables the .conf "
+                                                        "benchmark. Default 4000."),
+                    QCoreApplication::translate("main", "N"), "4000"});
+  parser.addOption({{"Y", "yaml-contacts"},
+                    QCoreApplication::translate("main", "Number of contacts of the synthetic "
+                                                        "configuration serialized to YAML. 0 "
+                                                        "disables the benchmark. Default 10000."),
+                    QCoreApplication::translate("main", "N"), "10000"});
+  parser.addOption({{"k", "clone-channels"},
+                    QCoreApplication::translate("main", "Number of channels of the synthetic "
+                                                        "configuration to build and clone, it also "
+                                                        "holds as many contacts as given by "
+                                                        "--yaml-contacts. 0 disables the benchmark. "
+                                                        "Default 4000."),
+                    QCoreApplication::translate("main", "N"), "4000"});
+  parser.addOption({{"D", "dfu-size"},
+                    QCoreApplication::translate("main", "Size of the synthetic DFU file and of the "
+                                                        "CRC32 buffer in MiB. 0 disables the DFU "
+                                                        "file and CRC32 benchmarks. Default 32."),
+                    QCoreApplication::translate("main", "MiB"), "32"});
+  parser.addOption({{"E", "image-elements"},
+                    QCoreApplication::translate("main", "Number of elements of the synthetic "
+                                                        "codeplug image, that gets built out of "
+                                                        "order, resolved and thinned out. 0 "
+                                                        "disables the benchmark. Default 20000."),
+                    QCoreApplication::translate("main", "N"), "20000"});
+  parser.addOption({{"L", "list-objects"},
+                    QCoreApplication::translate("main", "Largest number of objects of the config "
+                                                        "object list scaling benchmark. 0 disables "
+                                                        "the benchmark. Default 100000."),
+                    QCoreApplication::translate("main", "N"), "100000"});
+  parser.addOption({{"V", "verbose"},
+                    QCoreApplication::translate("main", "Prints debug messages to stderr.")});
+  QCommandLineOption ingestOption("ingest-user-db",
+                                  QCoreApplication::translate("main", "Internal: Ingests the given "
+                                                                      "user database and exits."),
+                                  QCoreApplication::translate("main", "FILENAME"));
+  ingestOption.setFlags(QCommandLineOption::HiddenFromHelp);
+  parser.addOption(ingestOption);
+  parser.process(app);
+
+  // Never touch the user's application data, nor download anything
+  QStandardPaths::setTestModeEnabled(true);
+
+  QTextStream logStream(stderr);
+  Logger::get().addHandler(new StreamLogHandler(
+                             logStream, parser.isSet("verbose") ? LogMessage::DEBUG : LogMessage::WARNING));
+
+  unsigned n = std::max(1u, parser.value("iterations").toUInt());
+  unsigned users = parser.value("users").toUInt();
+  unsigned confChannels = parser.value("conf-channels").toUInt();
+  unsigned yamlContacts = parser.value("yaml-contacts").toUInt();
+  unsigned listObjects = parser.value("list-objects").toUInt();
+  unsigned cloneChannels = parser.value("clone-channels").toUInt();
+  unsigned dfuSize = parser.value("dfu-size").toUInt();
+  unsigned imageElements = parser.value("image-elements").toUInt();
+
+  // Child process measuring a single user database ingest
+  if (parser.isSet("ingest-user-db")) {
+    QString filename = parser.value("ingest-user-db");
+    QJsonObject res = measure(n, [&](const ErrorStack &err) {
+      UserDatabase db(filename);
+      if (0 < db.count())
+        return true;
+      errMsg(err) << "Cannot load user database '" << filename << "'.";
+      return false;
+    });
+    res.insert("peakRSS_kB", double(peakRSS()));
+    std::cout << QJsonDocument(res).toJson(QJsonDocument::Compact).constData();
+    return 0;
+  }
+
+  QJsonObject result;
+  result.insert("version", VERSION_STRING);
+  result.insert("iterations", int(n));
+
+  // Ingest the synthetic user database, once from JSON and once from the compiled binary
+  QTemporaryDir dir;
+  UserDatabase *userdb = nullptr;
+  if (users) {
+    QString filename = dir.filePath("user.json");
+    if (! generateUserDB(filename, users)) {
+      logError() << "Cannot write synthetic user DB to '" << filename << "'.";
+      return -1;
+    }
+    QJsonObject res;
+    res.insert("users", int(users));
+    // The first ingest parses the JSON file and compiles the binary database next to it, all
+    // subsequent ones map the binary database.
+    res.insert("json", ingestUserDB(filename, 1));
+    res.insert("binary", ingestUserDB(filename, n));
+    result.insert("userDB", res);
+    userdb = new UserDatabase(filename);
+  }
+
+  // Parse a large legacy .conf codeplug
+  if (confChannels) {
+    QString conf = generateConf(confChannels);
+    QJsonObject res;
+    res.insert("channels", int(confChannels));
+    res.insert("bytes", conf.size());
+    res.insert("read", measure(n, [&](const ErrorStack &err) {
+      Config config;
+      QString msg;
+      QTextStream stream(&conf);
+      if (config.readCSV(stream, msg))
+        return true;
+      errMsg(err) << msg;
+      return false;
+    }));
+    result.insert("conf", res);
+  }
+
+  // Serialize a config with many contacts to YAML, dominated by labeling for large configs
+  if (yamlContacts) {
+    Config config;
+    Sizes sizes = {yamlContacts, 0, 0, 0, 0};
+    generateConfig(&config, sizes);
+    QJsonObject res;
+    res.insert("contacts", int(yamlContacts));
+    res.insert("write", measure(n, [&](const ErrorStack &err) {
+      QString yaml;
+      QTextStream stream(&yaml);
+      return config.toYAML(stream, err);
+    }));
+    result.insert("yaml", res);
+  }
+
+  // Build and clone a large config, dominated by the config objects and their references
+  if (cloneChannels) {
+    Sizes sizes = {std::max(1u, yamlContacts), 250, cloneChannels, 250, 0};
+    QJsonObject res;
+    res.insert("channels", int(cloneChannels));
+    res.insert("contacts", int(sizes.contacts));
+    qint64 rss = currentRSS();
+    Config *config = new Config();
+    res.insert("build", measure(1, [&](const ErrorStack &err) {
+      Q_UNUSED(err);
+      generateConfig(config, sizes);
+      return true;
+    }));
+    if ((0 <= rss) && (0 <= currentRSS()))
+      res.insert("RSS_kB", double(currentRSS()-rss));
+    res.insert("clone", measure(n, [&](const ErrorStack &err) {
+      ConfigItem *clone = config->clone();
+      if (nullptr == clone) {
+        errMsg(err) << "Cannot clone config.";
+        return false;
+      }
+      delete clone;
+      return true;
+    }));
+    delete config;
+    result.insert("clone", res);
+  }
+
+  // Build an image of many small elements out of order, like the AnyTone codeplugs do
+  if (imageElements) {
+    QJsonObject res;
+    res.insert("elements", int(imageElements));
+    res.insert("build", measure(n, [&](const ErrorStack &err) {
+      DFUFile::Image image;
+      for (unsigned i=0; i<imageElements; i++)
+        image.addElement((imageElements-i-1)*0x40, 0x40);
+      for (unsigned i=0; i<imageElements; i++) {
+        if (! image.isAllocated(i*0x40+0x3f)) {
+          errMsg(err) << "Address " << QString::number(i*0x40+0x3f, 16) << "h not allocated.";
+          return false;
+        }
+      }
+      return true;
+    }));
+    res.insert("remove", measure(n, [&](const ErrorStack &err) {
+      Q_UNUSED(err);
+      DFUFile::Image image;
+      for (unsigned i=0; i<imageElements; i++)
+        image.addElement(i*0x40, 0x40);
+      for (int i=image.numElements()-1; i>=0; i-=2)
+        image.remElement(i);
+      return true;
+    }));
+    result.insert("image", res);
+  }
+
+  // Write and read a large DFU file, like a call-sign DB image
+  if (dfuSize) {
+    DFUFile dfu;
+    dfu.addImage("Image 0");
+    for (unsigned i=0; i<dfuSize; i++) {
+      dfu.image(0).addElement(i*0x100000, 0x100000);
+      QByteArray &data = dfu.image(0).element(i).data();
+      for (int j=0; j<data.size(); j++)
+        data[j] = char((i+j)*31);
+    }
+    QString filename = dir.filePath("bench.dfu");
+    QJsonObject res;
+    res.insert("MiB", int(dfuSize));
+    res.insert("write", measure(n, [&](const ErrorStack &err) {
+      return dfu.write(filename, err);
+    }));
+    res.insert("read", measure(n, [&](const ErrorStack &err) {
+      DFUFile read;
+      return read.read(filename, err);
+    }));
+    result.insert("dfu", res);
+  }
+
+  // Throughput of all CRC32 implementations supported by the host
+  if (dfuSize) {
+    QByteArray data(dfuSize*0x100000, 0);
+    for (int i=0; i<data.size(); i++)
+      data[i] = char(i*31);
+    QJsonObject res;
+    res.insert("MiB", int(dfuSize));
+    res.insert("selected", CRC32::name(CRC32::implementation()));
+    QList<CRC32::Implementation> impls = {
+      CRC32::Implementation::Bytewise, CRC32::Implementation::SliceBy8,
+      CRC32::Implementation::CLMUL, CRC32::Implementation::ARMv8 };
+    foreach (CRC32::Implementation impl, impls) {
+      if (! CRC32::isSupported(impl))
+        continue;
+      uint32_t crc = 0;
+      QJsonObject timing = measure(n, [&](const ErrorStack &err) {
+        Q_UNUSED(err);
+        crc = CRC32::process(0xffffffff, (const uint8_t *)data.constData(), data.size(), impl);
+        return true;
+      });
+      timing.insert("crc", QString::number(crc, 16));
+      timing.insert("MiB_per_s", dfuSize*1000.0/std::max(1e-3, timing.value("min_ms").toDouble()));
+      res.insert(CRC32::name(impl), timing);
+    }
+    result.insert("crc32", res);
+  }
+
+  // Scaling of the config object lists
+  if (listObjects) {
+    QJsonArray res;
+    for (unsigned count=std::min(1000u, listObjects); count<=listObjects; count*=10)
+      res.append(listScaling(count, n));
+    result.insert("lists", res);
+  }
+
+  QJsonArray radios;
+  foreach (Target target, targets(parser.values("radio"))) {
+    logInfo() << "Benchmark " << target.key << "...";
+    radios.append(benchmark(target, n, userdb));
+    if (target.radio)
+      delete target.radio;
+    else
+      delete target.codeplug;
+  }
+  result.insert("radios", radios);
+  result.insert("peakRSS_kB", double(peakRSS()));
+
+  if (userdb)
+    delete userdb;
+
+  QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Indented);
+  if (parser.isSet("output")) {
+    QFile out(parser.value("output"));
+    if (! out.open(QIODevice::WriteOnly)) {
+      logError() << "Cannot write results to '" << out.fileName() << "': " << out.errorString();
+      return -1;
+    }
+    out.write(json);
+    out.close();
+  } else {
+    std::cout << json.constData();
+  }
+
+  return 0;
+}
@@ -2,8 +2,10 @@
 #include "config.hh"
 #include "errorstack.hh"
 #include "melody.hh"
+#include "rd5r_codeplug.hh"
 #include <iostream>
 #include <QTest>
+#include <QSignalSpy>
 
 
 ConfigTest::ConfigTest(QObject *parent) : QObject(parent)
@@ -34,6 +36,123 @@ ConfigTest::testCloneChannelBasic() {
   QCOMPARE(clone->compare(*_config.channelList()->channel(0)), 0);
 }
 
+void
+ConfigTest::testCloneConfig() {
+  Config *clone = qobject_cast<Config *>(_config.clone());
+  QVERIFY(nullptr != clone);
+  QCOMPARE(clone->channelList()->count(), _config.channelList()->count());
+
+  // References must point to the elements of the clone
+  for (int i=0; i<clone->channelList()->count(); i++) {
+    DMRChannel *channel = clone->channelList()->channel(i)->as<DMRChannel>();
+    if (nullptr == channel)
+      continue;
+    if (channel->txContactObj())
+      QVERIFY(clone->contacts()->has(channel->txContactObj()));
+    if (channel->groupListObj())
+      QVERIFY(clone->rxGroupLists()->has(channel->groupListObj()));
+  }
+  for (int i=0; i<clone->zones()->count(); i++) {
+    Zone *zone = clone->zones()->zone(i);
+    for (int j=0; j<zone->A()->count(); j++)
+      QVERIFY(clone->channelList()->has(zone->A()->get(j)));
+  }
+
+  // The clone must encode to the same codeplug
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug = false;
+  RD5RCodeplug original, cloned;
+  if (! original.encode(&_config, flags, err))
+    QFAIL(QString("Cannot encode original codeplug: %1").arg(err.format()).toStdString().c_str());
+  if (! cloned.encode(clone, flags, err))
+    QFAIL(QString("Cannot encode cloned codeplug: %1").arg(err.format()).toStdString().c_str());
+  QCOMPARE(cloned.numImages(), original.numImages());
+  for (int i=0; i<original.numImages(); i++) {
+    QCOMPARE(cloned.image(i).numElements(), original.image(i).numElements());
+    for (int j=0; j<original.image(i).numElements(); j++)
+      QVERIFY(cloned.image(i).element(j).data() == original.image(i).element(j).data());
+  }
+
+  delete clone;
+}
+
+void
+ConfigTest::testListIndex() {
+  Config config;
+  RXGroupList *list = new RXGroupList("GL");
+  config.rxGroupLists()->add(list);
+  QVector<DMRContact *> contacts;
+  for (int i=0; i<5; i++) {
+    contacts.append(new DMRContact(DMRContact::GroupCall, QString("TG %1").arg(i), 91+i));
+    config.contacts()->add(contacts.last());
+    list->addContact(contacts.last());
+  }
+
+  // Duplicates are rejected
+  QCOMPARE(list->addContact(contacts[0]), -1);
+  // Insert in front, move and remove, check that the index matches the position in the list
+  DMRContact *front = new DMRContact(DMRContact::GroupCall, "TG", 90);
+  config.contacts()->add(front);
+  QCOMPARE(list->addContact(front, 0), 0);
+  QVERIFY(list->contacts()->moveDown(1, 2));
+  QVERIFY(list->contacts()->moveUp(4));
+  QVERIFY(list->contacts()->take(contacts[1]));
+  QVERIFY(! list->contacts()->has(contacts[1]));
+  delete contacts[3];
+  QCOMPARE(list->count(), 4);
+  for (int i=0; i<list->count(); i++)
+    QCOMPARE(list->contacts()->indexOf(list->contacts()->get(i)), i);
+  for (int i=0; i<config.contacts()->count(); i++)
+    QCOMPARE(config.contacts()->indexOf(config.contacts()->get(i)), i);
+  // Clearing removes all
+  list->contacts()->clear();
+  QVERIFY(! list->contacts()->has(contacts[0]));
+  QCOMPARE(list->contacts()->indexOf(front), -1);
+}
+
+void
+ConfigTest::testReferences() {
+  DMRContact *contact = new DMRContact(DMRContact::GroupCall, "TG", 91);
+  DTMFContact *dtmf = new DTMFContact("DTMF", "123");
+  DMRChannel *a = new DMRChannel(), *b = new DMRChannel();
+
+  // Type check
+  QVERIFY(! a->contact()->set(dtmf));
+  QVERIFY(a->contact()->isNull());
+  QVERIFY(a->contact()->set(contact));
+  QVERIFY(b->contact()->set(contact));
+  QCOMPARE(a->contact()->as<DMRContact>(), contact);
+
+  // A deleted reference is removed from the index
+  delete b;
+  // Deleting the referenced object clears the remaining references
+  QSignalSpy spy(a->contact(), SIGNAL(modified()));
+  delete contact;
+  QVERIFY(a->contact()->isNull());
+  QCOMPARE(spy.count(), 1);
+
+  delete a;
+  delete dtmf;
+}
+
+void
+ConfigTest::testLabeling() {
+  Config config;
+  DMRContact *taken = new DMRContact(DMRContact::GroupCall, "TG 0", 90);
+  for (int i=0; i<3; i++)
+    config.contacts()->add(new DMRContact(DMRContact::GroupCall, QString("TG %1").arg(i+1), 91+i));
+
+  // Labels already taken are skipped
+  ConfigItem::Context context;
+  QVERIFY(context.add("cont2", taken));
+  QVERIFY(config.label(context));
+  QCOMPARE(context.getId(config.contacts()->get(0)), QString("cont1"));
+  QCOMPARE(context.getId(config.contacts()->get(1)), QString("cont3"));
+  QCOMPARE(context.getId(config.contacts()->get(2)), QString("cont4"));
+  QCOMPARE(context.newId("cont"), QString("cont5"));
+  delete taken;
+}
+
 void
 ConfigTest::testMelodyLilypond() {
   QString lilypond = "a8 b e2 cis4 d";
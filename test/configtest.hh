@@ -17,6 +17,10 @@ private slots:
   void cleanupTestCase();
 
   void testCloneChannelBasic();
+  void testCloneConfig();
+  void testListIndex();
+  void testReferences();
+  void testLabeling();
 
   void testMelodyLilypond();
   void testMelodyEncoding();
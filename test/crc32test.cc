@@ -15,4 +15,28 @@ CRC32Test::testCRC32() {
   QCOMPARE(crc.get(), 0x414FA339U^0xFFFFFFFF);
 }
 
+void
+CRC32Test::testImplementations() {
+  QByteArray data(0x10000, 0);
+  for (int i=0; i<data.size(); i++)
+    data[i] = char((i*2654435761U) >> 13);
+  const uint8_t *buf = (const uint8_t *)data.constData();
+
+  QList<CRC32::Implementation> impls = {
+    CRC32::Implementation::SliceBy8, CRC32::Implementation::CLMUL, CRC32::Implementation::ARMv8 };
+  foreach (CRC32::Implementation impl, impls) {
+    if (! CRC32::isSupported(impl))
+      continue;
+    // All lengths and alignments around the block sizes
+    for (int offset=0; offset<16; offset++) {
+      for (int n=0; n<300; n++) {
+        QCOMPARE(CRC32::process(0xffffffff, buf+offset, n, impl),
+                 CRC32::process(0xffffffff, buf+offset, n, CRC32::Implementation::Bytewise));
+      }
+    }
+    QCOMPARE(CRC32::process(0x12345678, buf+1, data.size()-1, impl),
+             CRC32::process(0x12345678, buf+1, data.size()-1, CRC32::Implementation::Bytewise));
+  }
+}
+
 QTEST_GUILESS_MAIN(CRC32Test)
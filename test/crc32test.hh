@@ -12,6 +12,7 @@ public:
 
 private slots:
   void testCRC32();
+  void testImplementations();
 };
 
 #endif // CRC32TEST_H
@@ -159,5 +159,42 @@ D878UVTest::testHangTime() {
 
 }
 
+void
+D878UVTest::testParallelEncoding() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+
+  QList<Config *> configs = {&_basicConfig, &_roamingConfig};
+  foreach (Config *config, configs) {
+    // Encode serially
+    D878UVCodeplug serial;
+    flags.parallelEncode = false;
+    if (! serial.encode(config, flags, err)) {
+      QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+            .arg(err.format()).toStdString().c_str());
+    }
+
+    // Encode concurrently
+    D878UVCodeplug parallel;
+    flags.parallelEncode = true;
+    if (! parallel.encode(config, flags, err)) {
+      QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: %1")
+            .arg(err.format()).toStdString().c_str());
+    }
+
+    // Both must be identical
+    QCOMPARE(parallel.numImages(), serial.numImages());
+    for (int i=0; i<serial.numImages(); i++) {
+      QCOMPARE(parallel.image(i).numElements(), serial.image(i).numElements());
+      for (int j=0; j<serial.image(i).numElements(); j++) {
+        QCOMPARE(parallel.image(i).element(j).address(), serial.image(i).element(j).address());
+        QVERIFY2(parallel.image(i).element(j).data() == serial.image(i).element(j).data(),
+                 QString("Element at %1h differs.")
+                 .arg(serial.image(i).element(j).address(), 0, 16).toStdString().c_str());
+      }
+    }
+  }
+}
+
 QTEST_GUILESS_MAIN(D878UVTest)
 
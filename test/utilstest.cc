@@ -1,8 +1,16 @@
 #include "utilstest.hh"
 
 #include <QTest>
+#include <QTemporaryDir>
 #include "utils.hh"
 #include "frequency.hh"
+#include "addressmap.hh"
+#include "jsonstreamparser.hh"
+#include "csvreader.hh"
+#include "dfufile.hh"
+#include "transferjournal.hh"
+#include "logger.hh"
+#include <QStandardPaths>
 
 UtilsTest::UtilsTest(QObject *parent) : QObject(parent)
 {
@@ -87,5 +95,292 @@ UtilsTest::testFrequencyParser() {
   QCOMPARE(Frequency::fromString("100.0").inHz(), 100000000ULL);
 }
 
+void
+UtilsTest::testAddressMap() {
+  AddressMap map;
+  map.add(0x2000, 0x10);
+  map.add(0x0000, 0x1800); // out of order
+  map.add(0x2010, 0x3000); // spans several pages
+  map.add(0x04000000, 0x10);
+
+  QCOMPARE(map.find(0x0000), 1);
+  QCOMPARE(map.find(0x17ff), 1);
+  QCOMPARE(map.find(0x1800), -1);
+  QCOMPARE(map.find(0x2000), 0);
+  QCOMPARE(map.find(0x200f), 0);
+  QCOMPARE(map.find(0x2010), 2);
+  QCOMPARE(map.find(0x500f), 2);
+  QCOMPARE(map.find(0x5010), -1);
+  QCOMPARE(map.find(0x04000008), 3);
+  QCOMPARE(map.find(0x04000010), -1);
+  QCOMPARE(map.find(0xffffffff), -1);
+
+  QVERIFY(map.rem(1));
+  QCOMPARE(map.find(0x0000), -1);
+  QCOMPARE(map.find(0x2000), 0);
+  QCOMPARE(map.find(0x04000000), 3);
+
+  // Renumber like DFUFile::Image::remElement()
+  map.shiftIndices(2, -1);
+  QCOMPARE(map.find(0x2000), 0);
+  QCOMPARE(map.find(0x2010), 1);
+  QCOMPARE(map.find(0x04000008), 2);
+
+  // Many small regions within a page, added in reverse order
+  AddressMap small;
+  for (int i=63; i>=0; i--)
+    small.add(0x8000+i*0x40, 0x40, i);
+  QCOMPARE(small.find(0x8000), 0);
+  QCOMPARE(small.find(0x8fff), 63);
+  QVERIFY(small.rem(10));
+  QCOMPARE(small.find(0x8280), -1);
+  QCOMPARE(small.find(0x82c0), 11);
+  QCOMPARE(small.find(0x8fc0), 63);
+  QVERIFY(! small.rem(10));
+}
+
+/** Serializes the parser events into a string. */
+class JsonEventRecorder: public JsonStreamParser::Handler
+{
+public:
+  void beginObject() { events.append("{"); }
+  void endObject() { events.append("}"); }
+  void beginArray() { events.append("["); }
+  void endArray() { events.append("]"); }
+  void key(const QString &key) { events.append("k:"+key); }
+  void value(const QJsonValue &value) {
+    if (value.isString())
+      events.append("s:"+value.toString());
+    else if (value.isDouble())
+      events.append("n:"+QString::number(value.toDouble(), 'g', 10));
+    else if (value.isBool())
+      events.append(value.toBool() ? "true" : "false");
+    else
+      events.append("null");
+  }
+
+  QStringList events;
+};
+
+void
+UtilsTest::testJsonStreamParser() {
+  QByteArray doc("{\"users\": [{\"id\": 2621370, \"callsign\":\"DM3MAT\"},\n"
+                 "  {\"id\":-1.5e2, \"fname\":\"\\u00e4\\\"\\n\", \"x\":[true,false,null]}]}");
+  QStringList expected = {"{", "k:users", "[", "{", "k:id", "n:2621370", "k:callsign", "s:DM3MAT", "}",
+                          "{", "k:id", "n:-150", "k:fname", "s:ä\"\n", "k:x", "[", "true", "false",
+                          "null", "]", "}", "]", "}"};
+
+  // Parse at once
+  JsonEventRecorder all;
+  JsonStreamParser parser(&all);
+  QVERIFY(parser.feed(doc));
+  QVERIFY(parser.finish());
+  QCOMPARE(all.events, expected);
+
+  // Parse byte-by-byte, tokens get split across chunks
+  JsonEventRecorder bytes;
+  JsonStreamParser bytewise(&bytes);
+  for (int i=0; i<doc.size(); i++)
+    QVERIFY(bytewise.feed(doc.constData()+i, 1));
+  QVERIFY(bytewise.finish());
+  QCOMPARE(bytes.events, expected);
+
+  // Syntax errors and incomplete documents
+  JsonEventRecorder ignored;
+  JsonStreamParser invalid(&ignored);
+  QVERIFY(! invalid.feed("{\"a\" 1}"));
+  invalid.reset();
+  QVERIFY(invalid.feed("{\"a\": [1, 2"));
+  QVERIFY(! invalid.finish());
+  invalid.reset();
+  QVERIFY(invalid.feed("42"));
+  QVERIFY(invalid.finish());
+}
+
+void
+UtilsTest::testCSVLexer() {
+  QString text("ID: 2621370 # comment\r\n"
+               "1 \"DB0LDS\" 439.5625 -7.6 n023 i754 DM3MAT-7 + - 1,2\n"
+               "\n");
+  QTextStream stream(&text);
+  CSVLexer lexer(stream);
+
+  QStringList tokens;
+  CSVLexer::Token token = lexer.next();
+  for (; (CSVLexer::Token::T_END_OF_STREAM != token.type) &&
+       (CSVLexer::Token::T_ERROR != token.type); token = lexer.next())
+    tokens.append(QString("%1:%2").arg(token.type).arg(token.value));
+  QCOMPARE(token.type, CSVLexer::Token::T_END_OF_STREAM);
+  QCOMPARE(token.line, qint64(3));
+
+  QStringList expected = {
+    "0:ID", "6::", "3:2621370", "11:",
+    "3:1", "2:DB0LDS", "3:439.5625", "3:-7.6", "4:023", "5:754", "1:DM3MAT-7", "8:+", "7:-",
+    "3:1", "9:,", "3:2", "11:"
+  };
+  QCOMPARE(tokens, expected);
+
+  // Backtracking restores the position
+  QTextStream again(&text);
+  CSVLexer backtrack(again);
+  backtrack.push();
+  QCOMPARE(backtrack.next().value, QString("ID"));
+  QCOMPARE(backtrack.next().type, CSVLexer::Token::T_COLON);
+  backtrack.pop();
+  token = backtrack.next();
+  QCOMPARE(token.value, QString("ID"));
+  QCOMPARE(token.column, qint64(1));
+
+  // Unexpected chars
+  QString invalid("name: \"unterminated\n");
+  QTextStream invalidStream(&invalid);
+  CSVLexer errors(invalidStream);
+  QCOMPARE(errors.next().type, CSVLexer::Token::T_KEYWORD);
+  QCOMPARE(errors.next().type, CSVLexer::Token::T_COLON);
+  QCOMPARE(errors.next().type, CSVLexer::Token::T_ERROR);
+}
+
+
+void
+UtilsTest::testDFUFile() {
+  QTemporaryDir dir;
+  QString filename = dir.filePath("test.dfu");
+
+  DFUFile dfu;
+  dfu.addImage("Test");
+  dfu.image(0).addElement(0x0000, 0x20000);
+  dfu.image(0).addElement(0x40000, 0x10);
+  for (int i=0; i<0x20000; i++)
+    dfu.image(0).element(0).data()[i] = char(i);
+  dfu.image(0).element(1).data().fill(0x55);
+  QVERIFY(dfu.write(filename));
+
+  DFUFile read;
+  QVERIFY(read.read(filename));
+  QCOMPARE(read.numImages(), 1);
+  QCOMPARE(read.image(0).name(), QString("Test"));
+  QCOMPARE(read.image(0).numElements(), 2);
+  QCOMPARE(read.image(0).element(1).address(), 0x40000u);
+  QCOMPARE(read.image(0).element(0).data(), dfu.image(0).element(0).data());
+  QCOMPARE(read.image(0).element(1).data(), dfu.image(0).element(1).data());
+
+  // Modify element read from the file and overwrite the very same file
+  read.image(0).element(1).data().fill(char(0xaa));
+  QVERIFY(read.write(filename));
+  {
+    DFUFile reread;
+    QVERIFY(reread.read(filename));
+    QCOMPARE(reread.image(0).element(0).data(), dfu.image(0).element(0).data());
+    QCOMPARE(reread.image(0).element(1).data(), QByteArray(0x10, char(0xaa)));
+  }
+
+  // Data leaving the element must not refer to the mapped file
+  QByteArray copy;
+  {
+    DFUFile reread;
+    QVERIFY(reread.read(filename));
+    copy = reread.image(0).element(0).data();
+    // Mapped by another DFU file
+    QVERIFY(! read.write(filename));
+  }
+  QCOMPARE(copy, dfu.image(0).element(0).data());
+  QVERIFY(read.write(filename));
+
+  // Corrupt CRC
+  QFile file(filename);
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  char c;
+  file.seek(file.size()-1); file.getChar(&c);
+  file.seek(file.size()-1); file.putChar(~c);
+  file.close();
+  QVERIFY(! DFUFile().read(filename));
+}
+
+void
+UtilsTest::testDFUSectors() {
+  DFUFile::Image image;
+  // Two elements within the same sector, one spanning two sectors
+  image.addElement(0x00000, 0x100);
+  image.addElement(0x08000, 0x100);
+  image.addElement(0x2f000, 0x2000);
+  QCOMPARE(image.sectors(0x10000), (QList<uint32_t>{0x00000, 0x20000, 0x30000}));
+
+  // Only sectors that differ from the reference
+  DFUFile::Image reference = image;
+  image.element(1).data()[0] = 0x01;
+  image.element(2).data()[0x1fff] = 0x01;
+  QCOMPARE(image.sectors(0x10000, &reference), (QList<uint32_t>{0x00000, 0x30000}));
+}
+
+void
+UtilsTest::testTransferJournal() {
+  QStandardPaths::setTestModeEnabled(true);
+
+  DFUFile dfu;
+  dfu.addImage("Test");
+  dfu.image(0).addElement(0x0000, 0x400);
+  dfu.image(0).element(0).data().fill(0x55);
+  QByteArray hash = TransferJournal::hash(dfu.image(0));
+
+  {
+    TransferJournal journal("test-radio", 16);
+    QVERIFY(journal.begin(hash));
+    QVERIFY(journal.storeImage(dfu));
+    journal.confirm(10);
+    journal.confirm(12);
+    // Pending confirmations are written on destruction
+  }
+
+  TransferJournal journal("test-radio", 16);
+  QVERIFY(journal.load());
+  QVERIFY(journal.matches(hash));
+  QCOMPARE(journal.confirmed(), 12u);
+  {
+    DFUFile image;
+    QVERIFY(journal.loadImage(image));
+    QCOMPARE(image.image(0).element(0).data(), dfu.image(0).element(0).data());
+  }
+
+  // Any change of the image invalidates the journal
+  dfu.image(0).element(0).data()[0] = 0x00;
+  QVERIFY(! journal.matches(TransferJournal::hash(dfu.image(0))));
+  // So does a different block size
+  QVERIFY(! TransferJournal("test-radio", 32).load());
+
+  QVERIFY(journal.remove());
+  QVERIFY(! journal.load());
+}
+
+/** Log handler, that logs a message itself while handling one. */
+class ReentrantLogHandler: public LogHandler
+{
+public:
+  void handle(const LogMessage &message) {
+    messages.append(message.message());
+    if ("outer" == message.message())
+      logWarn() << "inner";
+  }
+
+  QStringList messages;
+};
+
+void
+UtilsTest::testLoggerReentrant() {
+  ReentrantLogHandler *handler = new ReentrantLogHandler();
+  Logger::get().addHandler(handler);
+
+  logWarn() << "outer";
+  QCOMPARE(handler->messages, QStringList({"outer", "inner"}));
+
+  handler->messages.clear();
+  Logger::get().setAsynchronous(true);
+  logWarn() << "outer";
+  Logger::get().flush();
+  Logger::get().setAsynchronous(false);
+  QCOMPARE(handler->messages, QStringList({"outer", "inner"}));
+
+  Logger::get().remHandler(handler);
+  delete handler;
+}
 
 QTEST_GUILESS_MAIN(UtilsTest)
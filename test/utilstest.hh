@@ -19,6 +19,13 @@ private slots:
   void testDecodeDMRID_bcd();
   void testEncodeDMRID_bcd();
   void testFrequencyParser();
+  void testAddressMap();
+  void testJsonStreamParser();
+  void testCSVLexer();
+  void testDFUFile();
+  void testDFUSectors();
+  void testTransferJournal();
+  void testLoggerReentrant();
 };
 
 #endif // UTILSTEST_HH